@@ -0,0 +1,300 @@
+"""Interleaved head-to-head perft benchmark of Water against chess-library.
+
+Both binaries are pinned to the same core and every position is run A/B/A/B, so thermal and
+frequency drift land on both engines alike and every round gives one paired sample. Each
+invocation times a single position through the fen arguments of Water's bench and the
+--position option of the chess-library harness.
+"""
+
+import argparse
+import csv
+import json
+import math
+import os
+import platform
+import statistics
+import subprocess
+import sys
+from datetime import datetime
+
+from scipy import stats
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+DEFAULT_WATER = os.path.join(REPO, "zig-out", "bin", "bench" + EXE)
+DEFAULT_CHESS = os.path.join(
+    REPO, "benchmarks", "perft", "comparisons", "chess-library", "bin", "chess" + EXE
+)
+
+# The positions of both bench steps as (fen, depth, expected nodes, frc)
+BENCH_POSITIONS = [
+    ("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 7, 3195901860, False),
+    ("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ", 5, 193690690, False),
+    ("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ", 7, 178633661, False),
+    ("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 6, 706045033, False),
+    ("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194, False),
+    (
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1",
+        5,
+        164075551,
+        False,
+    ),
+    ("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w AHah - 0 1", 6, 119060324, True),
+    ("1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", 6, 191762235, True),
+    ("rbbqn1kr/pp2p1pp/6n1/2pp1p2/2P4P/P7/BP1PPPP1/R1BQNNKR w HAha - 0 9", 6, 924181432, True),
+    ("rqbbknr1/1ppp2pp/p5n1/4pp2/P7/1PP5/1Q1PPPPP/R1BBKNRN w GAga - 0 9", 6, 308553169, True),
+    ("4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21", 6, 872323796, True),
+    ("1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14", 6, 2678022813, True),
+    ("qbbnrkr1/p1pppppp/1p4n1/8/2P5/6N1/PPNPPPPP/1BRKBRQ1 b FCge - 1 3", 6, 521301336, True),
+    ("rr6/2kpp3/1ppnb1p1/p2Q1q1p/P4P1P/1PNN2P1/2PP4/1K2RR2 b E - 2 19", 4, 2237725, True),
+    ("rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 4, 2098209, True),
+    ("rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 5, 79014522, True),
+    ("rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 6, 2998685421, True),
+]
+
+
+def parse_epd(file_path, frc, max_nodes):
+    """Reads every "fen ;D<depth> <nodes>" case of an epd file expecting at most max_nodes."""
+    positions = []
+    with open(file_path, "r") as f:
+        for line in f:
+            components = line.strip().split(";")
+            fen = components[0].strip()
+            if not fen:
+                continue
+            for entry in components[1:]:
+                parts = entry.split()
+                if len(parts) != 2 or not parts[0].startswith("D"):
+                    continue
+                depth, nodes = int(parts[0][1:]), int(parts[1])
+                if nodes <= max_nodes:
+                    positions.append((fen, depth, nodes, frc))
+    return positions
+
+
+# ================ MACHINE ================
+
+
+def cpu_model():
+    try:
+        with open("/proc/cpuinfo", "r") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or "unknown"
+
+
+def isolated_cores():
+    """The cores isolated from the scheduler with isolcpus, as a set."""
+    cores = set()
+    try:
+        with open("/sys/devices/system/cpu/isolated", "r") as f:
+            for part in f.read().strip().split(","):
+                if "-" in part:
+                    low, high = part.split("-")
+                    cores.update(range(int(low), int(high) + 1))
+                elif part:
+                    cores.add(int(part))
+    except OSError:
+        pass
+    return cores
+
+
+def pin(core):
+    """Pins this process, and so every engine it starts, to one core. Linux only."""
+    if not hasattr(os, "sched_setaffinity"):
+        return False
+    try:
+        os.sched_setaffinity(0, {core})
+        return True
+    except OSError:
+        return False
+
+
+def governor_path(core):
+    return f"/sys/devices/system/cpu/cpu{core}/cpufreq/scaling_governor"
+
+
+def set_governor(core, governor):
+    """Switches the core's frequency governor, returning the previous one or None if not allowed."""
+    try:
+        with open(governor_path(core), "r") as f:
+            previous = f.read().strip()
+        if previous != governor:
+            with open(governor_path(core), "w") as f:
+                f.write(governor)
+        return previous
+    except OSError:
+        return None
+
+
+# ================ RUNS ================
+
+
+def engine_command(engine, binary, fen, depth, frc, runs):
+    if engine == "water":
+        return [binary] + (["--frc"] if frc else []) + [fen, str(depth), str(runs)]
+    return (
+        [binary, "--position", fen, str(depth), "--runs", str(runs)]
+        + (["--frc"] if frc else [])
+    )
+
+
+def run_engine(command):
+    """Runs one invocation, returning the (nodes, nanoseconds) of every "run" line it printed."""
+    result = subprocess.run(command, capture_output=True, text=True)
+    if result.returncode != 0:
+        print(f"Error: {' '.join(command)} failed:\n{result.stderr}")
+        sys.exit(1)
+
+    runs = []
+    for line in result.stdout.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[0] == "run":
+            runs.append((int(parts[1]), int(parts[2])))
+    return runs
+
+
+def per_invocation(samples, runs):
+    """Averages the runs of every invocation, so each round stays a single pair."""
+    return [statistics.fmean(samples[i : i + runs]) for i in range(0, len(samples), runs)]
+
+
+def mean_ci(samples, confidence=0.95):
+    """The mean of the samples and the half-width of its confidence interval."""
+    mean = statistics.fmean(samples)
+    if len(samples) < 2:
+        return mean, math.inf
+    sem = statistics.stdev(samples) / math.sqrt(len(samples))
+    return mean, stats.t.ppf((1 + confidence) / 2, len(samples) - 1) * sem
+
+
+def compare_position(water_ns, chess_ns, nodes):
+    """Paired statistics of one position, speed ratios being chess-library time over Water's."""
+    log_ratios = [math.log(c / w) for w, c in zip(water_ns, chess_ns)]
+    mean, half_width = mean_ci(log_ratios)
+    if len(water_ns) > 1 and statistics.stdev(log_ratios) > 0:
+        _, p_value = stats.ttest_rel(water_ns, chess_ns)
+    else:
+        p_value = 1.0 if mean == 0 else 0.0
+
+    return {
+        "water_median_ms": statistics.median(water_ns) / 1e6,
+        "chess_median_ms": statistics.median(chess_ns) / 1e6,
+        "water_nps": nodes * 1e9 / statistics.fmean(water_ns),
+        "chess_nps": nodes * 1e9 / statistics.fmean(chess_ns),
+        "speed_ratio": math.exp(mean),
+        "ratio_ci_low": math.exp(mean - half_width),
+        "ratio_ci_high": math.exp(mean + half_width),
+        "p_value": p_value,
+    }
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--water", default=DEFAULT_WATER, help="Water's bench binary")
+    parser.add_argument("--chess", default=DEFAULT_CHESS, help="the chess-library harness")
+    parser.add_argument(
+        "--core", type=int, default=None, help="core to pin both to (default: the last)"
+    )
+    parser.add_argument("--rounds", type=int, default=10, help="A/B pairs per position")
+    parser.add_argument("--runs", type=int, default=1, help="timed runs per invocation")
+    parser.add_argument("--epd", help="run the cases of an epd file instead of the bench positions")
+    parser.add_argument("--frc", action="store_true", help="treat the epd positions as chess960")
+    parser.add_argument("--max-nodes", type=int, default=2**64, help="skip larger cases")
+    parser.add_argument("--governor", default="performance", help="governor to run under")
+    parser.add_argument("--csv", help="write the per-position report to this file")
+    parser.add_argument("--json", help="write the report with every sample to this file")
+    args = parser.parse_args()
+
+    for binary in (args.water, args.chess):
+        if not os.path.isfile(binary):
+            print(f"Error: The binary '{binary}' was not found.")
+            sys.exit(1)
+
+    if args.epd:
+        positions = parse_epd(args.epd, args.frc, args.max_nodes)
+    else:
+        positions = [p for p in BENCH_POSITIONS if p[2] <= args.max_nodes]
+
+    core = args.core if args.core is not None else (os.cpu_count() or 1) - 1
+    pinned = pin(core)
+    previous_governor = set_governor(core, args.governor)
+
+    print(f"CPU: {cpu_model()}")
+    print(f"Core: {core} ({'pinned' if pinned else 'NOT pinned'}, ", end="")
+    print(f"{'isolated' if core in isolated_cores() else 'not isolated'})")
+    if previous_governor is None:
+        print(f"Governor: unchanged, '{args.governor}' could not be set")
+    else:
+        print(f"Governor: {args.governor} (was {previous_governor})")
+    print(f"Rounds/FEN: {args.rounds} x {args.runs} run(s), order A/B = Water/chess-library\n")
+
+    report = []
+    try:
+        for fen, depth, expected, frc in positions:
+            water_ns, chess_ns = [], []
+            for _ in range(args.rounds):
+                for engine, binary, samples in (
+                    ("water", args.water, water_ns),
+                    ("chess", args.chess, chess_ns),
+                ):
+                    command = engine_command(engine, binary, fen, depth, frc, args.runs)
+                    for nodes, ns in run_engine(command):
+                        if nodes != expected:
+                            print(f"Error: {engine} counted {nodes} nodes, expected {expected}")
+                            print(f"\tFEN: {fen} (depth {depth})")
+                            sys.exit(1)
+                        samples.append(ns)
+
+            water_ns = per_invocation(water_ns, args.runs)
+            chess_ns = per_invocation(chess_ns, args.runs)
+
+            row = {"fen": fen, "depth": depth, "nodes": expected, "frc": frc}
+            row.update(compare_position(water_ns, chess_ns, expected))
+            row["water_ns"], row["chess_ns"] = water_ns, chess_ns
+            report.append(row)
+
+            print(
+                f"depth {depth:<2} | water: {row['water_median_ms']:10.3f}ms "
+                f"{row['water_nps']:>10.0f} nps | chess: {row['chess_median_ms']:10.3f}ms "
+                f"{row['chess_nps']:>10.0f} nps | water speed: {row['speed_ratio']:.3f}x "
+                f"[{row['ratio_ci_low']:.3f}, {row['ratio_ci_high']:.3f}] "
+                f"| p: {row['p_value']:.4f}{' *' if row['p_value'] < 0.05 else '  '} | fen: {fen}"
+            )
+    finally:
+        if previous_governor is not None:
+            set_governor(core, previous_governor)
+
+    if not report:
+        print("Error: No positions were run.")
+        sys.exit(1)
+
+    geometric = math.exp(statistics.fmean(math.log(row["speed_ratio"]) for row in report))
+    print(f"\nGeometric mean speed of Water over chess-library: {geometric:.3f}x")
+    print("(ratios > 1 mean Water is faster, * marks p < 0.05 in a paired t-test)")
+
+    columns = [k for k in report[0] if k not in ("water_ns", "chess_ns")]
+    if args.csv:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=columns, extrasaction="ignore")
+            writer.writeheader()
+            writer.writerows(report)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(
+                {
+                    "cpu": cpu_model(),
+                    "date": datetime.now().isoformat(timespec="seconds"),
+                    "core": core,
+                    "pinned": pinned,
+                    "governor": args.governor if previous_governor is not None else None,
+                    "rounds": args.rounds,
+                    "runs": args.runs,
+                    "positions": report,
+                },
+                f,
+                indent=2,
+            )
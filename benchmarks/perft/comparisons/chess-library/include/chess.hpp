@@ -37,12 +37,64 @@ VERSION: 0.8.2
 #include <cstdint>
 #ifdef CHESS_USE_PEXT
 #include <immintrin.h>
+#elif !defined(CHESS_NO_PEXT_DISPATCH) && (defined(__x86_64__) || defined(_M_X64))
+// Without CHESS_USE_PEXT, x86-64 builds carry both slider lookups and pick one at startup
+#define CHESS_PEXT_DISPATCH
+#include <cstring>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// The slider attack tables are built by the compiler where its default constant evaluation limits
+// allow it (GCC), so they are constant data: nothing to fill at startup, and one copy in the page
+// cache shared by every process using them. Other compilers fill them from the same functions
+// during static initialization, unless CHESS_CONSTEXPR_SLIDERS is defined along with a raised limit
+// (e.g. clang's -fconstexpr-steps=10000000).
+#if !defined(CHESS_CONSTEXPR_SLIDERS) && defined(__GNUC__) && !defined(__clang__)
+#define CHESS_CONSTEXPR_SLIDERS
+#endif
+#ifdef CHESS_CONSTEXPR_SLIDERS
+#define CHESS_SLIDER_TABLE constexpr
+#define CHESS_SLIDER_TABLE_INIT constinit
+#else
+#define CHESS_SLIDER_TABLE inline const
+#define CHESS_SLIDER_TABLE_INIT
+#endif
+
+// Building the tables adds about three seconds to every translation unit including this header at
+// -O2. Projects with many of them can define CHESS_EXTERN_SLIDER_TABLES in all of them and expand
+// CHESS_DEFINE_SLIDER_TABLES in exactly one source file, the only one that builds the tables.
+#ifdef CHESS_EXTERN_SLIDER_TABLES
+#define CHESS_DEFINE_MAGIC_SLIDER_TABLES                                                           \
+    CHESS_SLIDER_TABLE_INIT const chess::detail::SliderAttacks<chess::detail::ROOK_ATTACKS_SIZE>   \
+        chess::attacks::RookAttacks =                                                              \
+            detail::sliderAttacks<detail::ROOK_ATTACKS_SIZE, PEXT_ORDER>(true, RookTable);         \
+    CHESS_SLIDER_TABLE_INIT const chess::detail::SliderAttacks<chess::detail::BISHOP_ATTACKS_SIZE> \
+        chess::attacks::BishopAttacks =                                                            \
+            detail::sliderAttacks<detail::BISHOP_ATTACKS_SIZE, PEXT_ORDER>(false, BishopTable);
+#ifdef CHESS_PEXT_DISPATCH
+#define CHESS_DEFINE_SLIDER_TABLES                                                                 \
+    CHESS_DEFINE_MAGIC_SLIDER_TABLES                                                               \
+    CHESS_SLIDER_TABLE_INIT const chess::detail::SliderAttacks<chess::detail::ROOK_ATTACKS_SIZE>   \
+        chess::attacks::RookPextAttacks =                                                          \
+            detail::sliderAttacks<detail::ROOK_ATTACKS_SIZE, true>(true, RookTable);               \
+    CHESS_SLIDER_TABLE_INIT const chess::detail::SliderAttacks<chess::detail::BISHOP_ATTACKS_SIZE> \
+        chess::attacks::BishopPextAttacks =                                                        \
+            detail::sliderAttacks<detail::BISHOP_ATTACKS_SIZE, true>(false, BishopTable);
+#else
+#define CHESS_DEFINE_SLIDER_TABLES CHESS_DEFINE_MAGIC_SLIDER_TABLES
+#endif
 #endif
 
 #if __cpp_lib_bitops >= 201907L
 #include <bit>
 #endif
 #include <algorithm>
+#include <array>
 #include <bitset>
 #include <cassert>
 #include <iostream>
@@ -987,34 +1039,214 @@ class Piece {
 } // namespace chess
 
 namespace chess {
-class attacks {
-    using U64 = std::uint64_t;
+namespace detail {
+constexpr int lsb(std::uint64_t b) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(b);
+#else
+    int index = 0;
+    for (; !(b & 1); b >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+constexpr int msb(std::uint64_t b) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 ^ __builtin_clzll(b);
+#else
+    int index = 63;
+    for (; !(b >> 63); b <<= 1)
+        index--;
+    return index;
+#endif
+}
+
+// Every square seen from a square in one direction on an empty board. The first four directions,
+// north, east, north east and north west, raise the square index, the last four lower it.
+struct Rays {
+    std::uint64_t rays[8][64];
+};
+
+constexpr Rays makeRays() noexcept {
+    constexpr int steps[8][2] = {{0, 1},  {1, 0},  {1, 1},   {-1, 1},
+                                 {0, -1}, {-1, 0}, {-1, -1}, {1, -1}};
+
+    Rays rays{};
+    for (int d = 0; d < 8; ++d) {
+        for (int sq = 0; sq < 64; ++sq) {
+            for (int f = sq % 8 + steps[d][0], r = sq / 8 + steps[d][1];
+                 f >= 0 && f < 8 && r >= 0 && r < 8; f += steps[d][0], r += steps[d][1]) {
+                rays.rays[d][sq] |= 1ULL << (r * 8 + f);
+            }
+        }
+    }
+    return rays;
+}
+
+inline constexpr Rays RAYS = makeRays();
+
+// The attacks along one ray, up to and including the nearest blocker
+constexpr std::uint64_t rayAttacks(int d, int sq, std::uint64_t occupied) noexcept {
+    const auto blockers = occupied & RAYS.rays[d][sq];
+    if (!blockers)
+        return RAYS.rays[d][sq];
+    return RAYS.rays[d][sq] ^ RAYS.rays[d][d < 4 ? lsb(blockers) : msb(blockers)];
+}
 
+// Every occupancy of the relevant squares on one line through a square, the rays in direction d
+// and its opposite, with its attacks and its share of the PEXT index over the whole mask
+struct LineOccupancies {
+    std::uint64_t occupancies[64];
+    std::uint64_t attacks[64];
+    std::uint64_t indices[64];
+    int count;
+};
+
+constexpr LineOccupancies lineOccupancies(int d, int sq, std::uint64_t mask) noexcept {
+    const auto line_mask = mask & (RAYS.rays[d][sq] | RAYS.rays[d + 4][sq]);
+
+    LineOccupancies line{};
+    std::uint64_t occ = 0;
+    do {
+        std::uint64_t index = 0;
+        int bit = 0;
+        for (auto m = mask; m; m &= m - 1, ++bit) {
+            if (occ & m & (0 - m))
+                index |= 1ULL << bit;
+        }
+
+        line.occupancies[line.count] = occ;
+        line.attacks[line.count] = rayAttacks(d, sq, occ) | rayAttacks(d + 4, sq, occ);
+        line.indices[line.count] = index;
+        line.count++;
+        occ = (occ - line_mask) & line_mask;
+    } while (occ);
+    return line;
+}
+
+// Where a square's slider attacks start in its table, and how an occupancy indexes them
+struct SliderMagic {
+    std::uint64_t mask;
+    std::uint64_t magic;
+    std::uint64_t shift;
+    std::uint64_t offset;
+
+    std::uint64_t operator()(Bitboard b) const noexcept {
 #ifdef CHESS_USE_PEXT
-    struct Magic {
-        U64 mask;
-        Bitboard* attacks;
-        U64 operator()(Bitboard b) const noexcept { return _pext_u64(b.getBits(), mask); }
-    };
+        return offset + _pext_u64(b.getBits(), mask);
 #else
-    struct Magic {
-        U64 mask;
-        U64 magic;
-        Bitboard* attacks;
-        U64 shift;
-        U64 operator()(Bitboard b) const noexcept {
-            return (((b & mask)).getBits() * magic) >> shift;
+        return offset + (((b & mask).getBits() * magic) >> shift);
+#endif
+    }
+};
+
+constexpr std::array<SliderMagic, 64> sliderMagics(bool rook,
+                                                   const std::uint64_t (&magics)[64]) noexcept {
+    // The edges of the board are not considered for the attacks
+    // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
+    constexpr std::uint64_t ranks = 0xff000000000000ffULL;
+    constexpr std::uint64_t files = 0x8181818181818181ULL;
+
+    std::array<SliderMagic, 64> table{};
+    std::uint64_t offset = 0;
+    for (int sq = 0; sq < 64; ++sq) {
+        const std::uint64_t edges =
+            (ranks & ~(0xffULL << (sq & ~7))) | (files & ~(0x0101010101010101ULL << (sq & 7)));
+        const int d = rook ? 0 : 2;
+        const auto mask = (RAYS.rays[d][sq] | RAYS.rays[d + 1][sq] | RAYS.rays[d + 4][sq] |
+                           RAYS.rays[d + 5][sq]) &
+                          ~edges;
+
+        int bits = 0;
+        for (auto b = mask; b; b &= b - 1)
+            bits++;
+
+        table[sq] = {mask, magics[sq], static_cast<std::uint64_t>(64 - bits), offset};
+        offset += 1ULL << bits;
+    }
+    return table;
+}
+
+// The attacks of every square and relevant occupancy, indexed through the square's SliderMagic
+// either by magic or by PEXT. A plain array keeps GCC's constant evaluation of them fast.
+template <std::size_t N> struct SliderAttacks {
+    std::uint64_t attacks[N];
+};
+
+constexpr std::size_t ROOK_ATTACKS_SIZE = 0x19000;
+constexpr std::size_t BISHOP_ATTACKS_SIZE = 0x1480;
+
+template <std::size_t N, bool PEXT>
+constexpr SliderAttacks<N> sliderAttacks(bool rook, const std::array<SliderMagic, 64>& table) {
+    SliderAttacks<N> attacks{};
+    for (int sq = 0; sq < 64; ++sq) {
+        const auto magic = table[sq];
+
+        // The occupancies of one line against those of the other, so each attack set is an or
+        const int d = rook ? 0 : 2;
+        const auto a = lineOccupancies(d, sq, magic.mask);
+        const auto b = lineOccupancies(d + 1, sq, magic.mask);
+        for (int i = 0; i < a.count; ++i) {
+            for (int j = 0; j < b.count; ++j) {
+                const auto occ = a.occupancies[i] | b.occupancies[j];
+                const auto index =
+                    PEXT ? a.indices[i] + b.indices[j] : (occ * magic.magic) >> magic.shift;
+                attacks.attacks[magic.offset + index] = a.attacks[i] | b.attacks[j];
+            }
         }
-    };
+    }
+    return attacks;
+}
+
+// Each square's ray to another square it is aligned with, up to and including that square, and
+// otherwise only that square
+constexpr std::array<std::array<Bitboard, 64>, 64> squaresBetween() noexcept {
+    std::array<std::array<Bitboard, 64>, 64> between{};
+    for (int sq1 = 0; sq1 < 64; ++sq1) {
+        for (int sq2 = 0; sq2 < 64; ++sq2) {
+            between[sq1][sq2] = Bitboard(1ULL << sq2);
+        }
+        for (const auto& ray : RAYS.rays) {
+            for (auto squares = ray[sq1]; squares; squares &= squares - 1) {
+                const int sq2 = lsb(squares);
+                between[sq1][sq2] = Bitboard(ray[sq1] ^ ray[sq2]);
+            }
+        }
+    }
+    return between;
+}
+} // namespace detail
+
+class attacks {
+    using U64 = std::uint64_t;
+
+  public:
+    // How the slider tables are indexed: by multiplying the occupancy with a magic number, or by
+    // gathering its relevant bits with BMI2's PEXT
+    enum class SliderLookup : std::uint8_t { MAGIC, PEXT };
+
+  private:
+    using Magic = detail::SliderMagic;
+
+#ifdef CHESS_PEXT_DISPATCH
+    // PEXT without compiling for BMI2, so it inlines into code built for any x86-64
+    [[nodiscard]] static U64 pext(U64 bits, U64 mask) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+        return _pext_u64(bits, mask);
+#else
+        U64 result;
+        asm("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+        return result;
 #endif
+    }
 
-    // Slow function to calculate bishop and rook attacks
-    template <bool ISROOK>
-    [[nodiscard]] static Bitboard sliderAttacks(Square sq, Bitboard occupied) noexcept;
+    // Whether the CPU has PEXT, and with require_fast whether it is more than microcoded
+    [[nodiscard]] static bool cpuHasPext(bool require_fast) noexcept;
 
-    // Initializes the magic bitboard tables for sliding pieces
-    static void initSliders(Square sq, Magic table[], U64 magic,
-                            const std::function<Bitboard(Square, Bitboard)>& attacks);
+    // Both orders of the tables are always there, so lookups before this is set are fine too
+    static inline bool UsePext = cpuHasPext(true);
+#endif
 
     // clang-format off
     // pre-calculated lookup table for pawn attacks
@@ -1133,11 +1365,37 @@ class attacks {
         0xa010109502200ULL,    0x4a02012000ULL,       0x500201010098b028ULL, 0x8040002811040900ULL,
         0x28000010020204ULL,   0x6000020202d0240ULL,  0x8918844842082200ULL, 0x4010011029020020ULL};
 
-    static inline Bitboard RookAttacks[0x19000] = {};
-    static inline Bitboard BishopAttacks[0x1480] = {};
+    static constexpr std::array<Magic, 64> RookTable = detail::sliderMagics(true, RookMagics);
+    static constexpr std::array<Magic, 64> BishopTable = detail::sliderMagics(false, BishopMagics);
+
+#ifdef CHESS_USE_PEXT
+    static constexpr bool PEXT_ORDER = true;
+#else
+    static constexpr bool PEXT_ORDER = false;
+#endif
 
-    static inline Magic RookTable[64] = {};
-    static inline Magic BishopTable[64] = {};
+#ifdef CHESS_EXTERN_SLIDER_TABLES
+    // Defined by CHESS_DEFINE_SLIDER_TABLES
+    static const detail::SliderAttacks<detail::ROOK_ATTACKS_SIZE> RookAttacks;
+    static const detail::SliderAttacks<detail::BISHOP_ATTACKS_SIZE> BishopAttacks;
+#ifdef CHESS_PEXT_DISPATCH
+    static const detail::SliderAttacks<detail::ROOK_ATTACKS_SIZE> RookPextAttacks;
+    static const detail::SliderAttacks<detail::BISHOP_ATTACKS_SIZE> BishopPextAttacks;
+#endif
+#else
+    // Ordered for Magic's index
+    static CHESS_SLIDER_TABLE auto RookAttacks =
+        detail::sliderAttacks<detail::ROOK_ATTACKS_SIZE, PEXT_ORDER>(true, RookTable);
+    static CHESS_SLIDER_TABLE auto BishopAttacks =
+        detail::sliderAttacks<detail::BISHOP_ATTACKS_SIZE, PEXT_ORDER>(false, BishopTable);
+
+#ifdef CHESS_PEXT_DISPATCH
+    static CHESS_SLIDER_TABLE auto RookPextAttacks =
+        detail::sliderAttacks<detail::ROOK_ATTACKS_SIZE, true>(true, RookTable);
+    static CHESS_SLIDER_TABLE auto BishopPextAttacks =
+        detail::sliderAttacks<detail::BISHOP_ATTACKS_SIZE, true>(false, BishopTable);
+#endif
+#endif
 
   public:
     static constexpr Bitboard MASK_RANK[8] = {
@@ -1242,10 +1500,26 @@ class attacks {
     [[nodiscard]] static Bitboard slider(Square sq, Bitboard occupied) noexcept;
 
     /**
-     * @brief [Internal Usage] Initializes the attacks for the bishop and rook. Called once at
-     * startup.
+     * @brief Returns whether this CPU has a PEXT worth using: BMI2 on anything but AMD processors
+     * before Zen 3, which microcode it. Always true when built with CHESS_USE_PEXT.
+     * @return
      */
-    static inline void initAttacks();
+    [[nodiscard]] static bool fastPext() noexcept;
+
+    /**
+     * @brief Returns the slider lookup in use. Unless CHESS_USE_PEXT forces PEXT, x86-64 builds
+     * start with PEXT where fastPext() holds and with magics everywhere else.
+     * @return
+     */
+    [[nodiscard]] static SliderLookup sliderLookup() noexcept;
+
+    /**
+     * @brief Switches the slider lookup, e.g. to compare the two on one machine. Not thread safe,
+     * nothing may look up attacks meanwhile.
+     * @param lookup
+     * @return false, changing nothing, if this build or CPU cannot use the lookup
+     */
+    static bool setSliderLookup(SliderLookup lookup) noexcept;
 };
 } // namespace chess
 
@@ -1508,9 +1782,23 @@ class movegen {
                                         PieceGenType::BISHOP | PieceGenType::ROOK |
                                         PieceGenType::QUEEN | PieceGenType::KING);
 
+    /**
+     * @brief Counts the legal moves of a position without generating them. The result always
+     * equals the size of the list legalmoves would produce, e.g. for bulk counting perft leaves.
+     * @tparam mt
+     * @param board
+     * @param pieces
+     * @return
+     */
+    template <MoveGenType mt = MoveGenType::ALL>
+    [[nodiscard]] static int countLegal(const Board& board,
+                                        int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT |
+                                                     PieceGenType::BISHOP | PieceGenType::ROOK |
+                                                     PieceGenType::QUEEN | PieceGenType::KING);
+
   private:
-    static auto init_squares_between();
-    static const std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB;
+    static constexpr std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB =
+        detail::squaresBetween();
 
     // Generate the checkmask. Returns a bitboard where the attacker path between the king and enemy
     // piece is set.
@@ -1558,6 +1846,16 @@ class movegen {
     template <Color::underlying c, MoveGenType mt>
     static void legalmoves(Movelist& movelist, const Board& board, int pieces);
 
+    // Counts pawn moves, including four per promotion and any en passant captures.
+    template <Color::underlying c, MoveGenType mt>
+    [[nodiscard]] static int countPawnMoves(const Board& board, Bitboard pin_d, Bitboard pin_hv,
+                                            Bitboard checkmask, Bitboard occ_enemy);
+
+    template <typename T> [[nodiscard]] static int whileBitboardCount(Bitboard mask, T func);
+
+    template <Color::underlying c, MoveGenType mt>
+    [[nodiscard]] static int countLegal(const Board& board, int pieces);
+
     template <Color::underlying c> static bool isEpSquareValid(const Board& board, Square ep);
 
     [[nodiscard]] static Bitboard between(Square sq1, Square sq2) noexcept;
@@ -3468,11 +3766,21 @@ template <Color::underlying c>
 }
 
 [[nodiscard]] inline Bitboard attacks::bishop(Square sq, Bitboard occupied) noexcept {
-    return BishopTable[sq.index()].attacks[BishopTable[sq.index()](occupied)];
+    const auto& magic = BishopTable[sq.index()];
+#ifdef CHESS_PEXT_DISPATCH
+    if (UsePext)
+        return BishopPextAttacks.attacks[magic.offset + pext(occupied.getBits(), magic.mask)];
+#endif
+    return BishopAttacks.attacks[magic(occupied)];
 }
 
 [[nodiscard]] inline Bitboard attacks::rook(Square sq, Bitboard occupied) noexcept {
-    return RookTable[sq.index()].attacks[RookTable[sq.index()](occupied)];
+    const auto& magic = RookTable[sq.index()];
+#ifdef CHESS_PEXT_DISPATCH
+    if (UsePext)
+        return RookPextAttacks.attacks[magic.offset + pext(occupied.getBits(), magic.mask)];
+#endif
+    return RookAttacks.attacks[magic(occupied)];
 }
 
 [[nodiscard]] inline Bitboard attacks::queen(Square sq, Bitboard occupied) noexcept {
@@ -3509,98 +3817,86 @@ template <PieceType::underlying pt>
         return queen(sq, occupied);
 }
 
-template <bool ISROOK>
-[[nodiscard]] inline Bitboard attacks::sliderAttacks(Square sq, Bitboard occupied) noexcept {
-    static constexpr int dirs[2][4][2] = {{{1, 1}, {1, -1}, {-1, -1}, {-1, 1}},
-                                          {{1, 0}, {0, -1}, {-1, 0}, {0, 1}}};
+#ifdef CHESS_PEXT_DISPATCH
+inline bool attacks::cpuHasPext(bool require_fast) noexcept {
+    // eax, ebx, ecx, edx
+    unsigned int regs[4] = {};
+    const auto cpuid = [&regs](unsigned int leaf) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int out[4];
+        __cpuidex(out, static_cast<int>(leaf), 0);
+        for (int i = 0; i < 4; i++)
+            regs[i] = static_cast<unsigned int>(out[i]);
+#else
+        __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    };
 
-    Bitboard attacks = 0ull;
+    cpuid(0);
+    if (regs[0] < 7)
+        return false;
 
-    File pf = sq.file();
-    Rank pr = sq.rank();
+    // ebx, edx, ecx spell the vendor
+    char vendor[13] = {};
+    std::memcpy(vendor, &regs[1], 4);
+    std::memcpy(vendor + 4, &regs[3], 4);
+    std::memcpy(vendor + 8, &regs[2], 4);
 
-    for (int i = 0; i < 4; ++i) {
-        int off_f = dirs[ISROOK][i][0];
-        int off_r = dirs[ISROOK][i][1];
+    cpuid(7);
+    const bool bmi2 = (regs[1] >> 8) & 1;
+    if (!bmi2 || !require_fast)
+        return bmi2;
 
-        File f;
-        Rank r;
-        for (f = pf + off_f, r = pr + off_r; Square::is_valid(r, f); f += off_f, r += off_r) {
-            const auto index = Square(f, r).index();
-            attacks.set(index);
-            if (occupied.check(index))
-                break;
-        }
+    // Zen 1 and 2 (families 0x17 and 0x18 for Hygon) take hundreds of cycles for a PEXT
+    const std::string_view v(vendor);
+    if (v == "AuthenticAMD" || v == "HygonGenuine") {
+        cpuid(1);
+        const auto base_family = (regs[0] >> 8) & 0xf;
+        const auto family =
+            base_family == 0xf ? base_family + ((regs[0] >> 20) & 0xff) : base_family;
+        return family >= 0x19;
     }
 
-    return attacks;
+    return true;
 }
-
-inline void attacks::initSliders(Square sq, Magic table[], U64 magic,
-                                 const std::function<Bitboard(Square, Bitboard)>& attacks) {
-    // The edges of the board are not considered for the attacks
-    // i.e. for the sq h7 edges will be a1-h1, a1-a8, a8-h8, ignoring the edge of the current square
-    const Bitboard edges =
-        ((Bitboard(Rank::RANK_1) | Bitboard(Rank::RANK_8)) & ~Bitboard(sq.rank())) |
-        ((Bitboard(File::FILE_A) | Bitboard(File::FILE_H)) & ~Bitboard(sq.file()));
-
-    U64 occ = 0ULL;
-
-    auto& table_sq = table[sq.index()];
-
-#ifndef CHESS_USE_PEXT
-    table_sq.magic = magic;
 #endif
-    table_sq.mask = (attacks(sq, occ) & ~edges).getBits();
-#ifndef CHESS_USE_PEXT
-    table_sq.shift = 64 - Bitboard(table_sq.mask).count();
-#endif
-
-    if (sq < 64 - 1) {
-        table[sq.index() + 1].attacks =
-            table_sq.attacks + (1ull << Bitboard(table_sq.mask).count());
-    }
 
-    do {
-        table_sq.attacks[table_sq(occ)] = attacks(sq, occ);
-        occ = (occ - table_sq.mask) & table_sq.mask;
-    } while (occ);
+inline bool attacks::fastPext() noexcept {
+#ifdef CHESS_USE_PEXT
+    return true;
+#elif defined(CHESS_PEXT_DISPATCH)
+    return cpuHasPext(true);
+#else
+    return false;
+#endif
 }
 
-inline void attacks::initAttacks() {
-    BishopTable[0].attacks = BishopAttacks;
-    RookTable[0].attacks = RookAttacks;
+inline attacks::SliderLookup attacks::sliderLookup() noexcept {
+#ifdef CHESS_USE_PEXT
+    return SliderLookup::PEXT;
+#elif defined(CHESS_PEXT_DISPATCH)
+    return UsePext ? SliderLookup::PEXT : SliderLookup::MAGIC;
+#else
+    return SliderLookup::MAGIC;
+#endif
+}
 
-    for (int i = 0; i < 64; i++) {
-        initSliders(static_cast<Square>(i), BishopTable, BishopMagics[i], sliderAttacks<false>);
-        initSliders(static_cast<Square>(i), RookTable, RookMagics[i], sliderAttacks<true>);
-    }
+inline bool attacks::setSliderLookup(SliderLookup lookup) noexcept {
+    if (lookup == sliderLookup())
+        return true;
+#ifdef CHESS_PEXT_DISPATCH
+    if (lookup == SliderLookup::PEXT && !cpuHasPext(false))
+        return false;
+    UsePext = lookup == SliderLookup::PEXT;
+    return true;
+#else
+    return false;
+#endif
 }
 } // namespace chess
 
 namespace chess {
 
-inline auto movegen::init_squares_between() {
-    std::array<std::array<Bitboard, 64>, 64> squares_between_bb{};
-
-    auto att = [](PieceType pt, Square sq, Bitboard occ) {
-        return (pt == PieceType::BISHOP) ? attacks::bishop(sq, occ) : attacks::rook(sq, occ);
-    };
-
-    for (int sq1 = 0; sq1 < 64; ++sq1) {
-        for (PieceType pt : {PieceType::BISHOP, PieceType::ROOK}) {
-            for (int sq2 = 0; sq2 < 64; ++sq2) {
-                if (att(pt, sq1, 0).check(sq2)) {
-                    squares_between_bb[sq1][sq2] = att(pt, sq1, Bitboard::fromSquare(sq2)) &
-                                                   att(pt, sq2, Bitboard::fromSquare(sq1));
-                }
-                squares_between_bb[sq1][sq2].set(sq2);
-            }
-        }
-    }
-
-    return squares_between_bb;
-}
 
 template <Color::underlying c>
 [[nodiscard]] inline std::pair<Bitboard, int> movegen::checkMask(const Board& board, Square sq) {
@@ -4088,6 +4384,170 @@ inline void movegen::legalmoves(Movelist& movelist, const Board& board, int piec
         legalmoves<Color::BLACK, mt>(movelist, board, pieces);
 }
 
+template <Color::underlying c, movegen::MoveGenType mt>
+[[nodiscard]] inline int movegen::countPawnMoves(const Board& board, Bitboard pin_d,
+                                                 Bitboard pin_hv, Bitboard checkmask,
+                                                 Bitboard occ_opp) {
+    // Same masks as generatePawnMoves, popcounted instead of walked
+
+    constexpr auto UP = make_direction(Direction::NORTH, c);
+    constexpr auto UP_LEFT = make_direction(Direction::NORTH_WEST, c);
+    constexpr auto UP_RIGHT = make_direction(Direction::NORTH_EAST, c);
+
+    constexpr auto RANK_PROMO = Rank::rank(Rank::RANK_8, c).bb();
+    constexpr auto DOUBLE_PUSH_RANK = Rank::rank(Rank::RANK_3, c).bb();
+
+    const auto pawns = board.pieces(PieceType::PAWN, c);
+
+    const Bitboard pawns_lr = pawns & ~pin_hv;
+    const Bitboard unpinned_pawns_lr = pawns_lr & ~pin_d;
+    const Bitboard pinned_pawns_lr = pawns_lr & pin_d;
+
+    const auto l_pawns = (attacks::shift<UP_LEFT>(unpinned_pawns_lr) |
+                          (attacks::shift<UP_LEFT>(pinned_pawns_lr) & pin_d)) &
+                         occ_opp & checkmask;
+    const auto r_pawns = (attacks::shift<UP_RIGHT>(unpinned_pawns_lr) |
+                          (attacks::shift<UP_RIGHT>(pinned_pawns_lr) & pin_d)) &
+                         occ_opp & checkmask;
+
+    const auto pawns_hv = pawns & ~pin_d;
+    const auto pawns_pinned_hv = pawns_hv & pin_hv;
+    const auto pawns_unpinned_hv = pawns_hv & ~pin_hv;
+
+    const auto single_push_unpinned = attacks::shift<UP>(pawns_unpinned_hv) & ~board.occ();
+    const auto single_push_pinned = attacks::shift<UP>(pawns_pinned_hv) & pin_hv & ~board.occ();
+
+    const Bitboard single_push = (single_push_unpinned | single_push_pinned) & checkmask;
+
+    const Bitboard double_push =
+        ((attacks::shift<UP>(single_push_unpinned & DOUBLE_PUSH_RANK) & ~board.occ()) |
+         (attacks::shift<UP>(single_push_pinned & DOUBLE_PUSH_RANK) & ~board.occ())) &
+        checkmask;
+
+    int count = 0;
+
+    // Every promotion is four moves, one per piece
+    if constexpr (mt != MoveGenType::QUIET) {
+        count += (l_pawns & ~RANK_PROMO).count() + (r_pawns & ~RANK_PROMO).count();
+        count += 4 * ((l_pawns & RANK_PROMO).count() + (r_pawns & RANK_PROMO).count());
+    }
+
+    if constexpr (mt != MoveGenType::CAPTURE) {
+        count += (single_push & ~RANK_PROMO).count() + double_push.count();
+        count += 4 * (single_push & RANK_PROMO).count();
+    }
+
+    if constexpr (mt == MoveGenType::QUIET)
+        return count;
+
+    const Square ep = board.enpassantSq();
+
+    if (ep != Square::NO_SQ) {
+        for (const auto& move : generateEPMove(board, checkmask, pin_d, pawns_lr, ep, c)) {
+            count += move != Move::NO_MOVE;
+        }
+    }
+
+    return count;
+}
+
+template <typename T> [[nodiscard]] inline int movegen::whileBitboardCount(Bitboard mask, T func) {
+    int count = 0;
+    while (mask) {
+        count += func(mask.pop()).count();
+    }
+    return count;
+}
+
+template <Color::underlying c, movegen::MoveGenType mt>
+[[nodiscard]] inline int movegen::countLegal(const Board& board, int pieces) {
+    // Mirrors legalmoves, adding up destination bitboards instead of walking them into moves
+    auto king_sq = board.kingSq(c);
+
+    Bitboard occ_us = board.us(c);
+    Bitboard occ_opp = board.us(~c);
+    Bitboard occ_all = occ_us | occ_opp;
+
+    Bitboard opp_empty = ~occ_us;
+
+    const auto [checkmask, checks] = checkMask<c>(board, king_sq);
+    const auto pin_hv = pinMask<c, PieceType::ROOK>(board, king_sq, occ_opp, occ_us);
+    const auto pin_d = pinMask<c, PieceType::BISHOP>(board, king_sq, occ_opp, occ_us);
+
+    assert(checks <= 2);
+
+    Bitboard movable_square;
+
+    if constexpr (mt == MoveGenType::ALL)
+        movable_square = opp_empty;
+    else if constexpr (mt == MoveGenType::CAPTURE)
+        movable_square = occ_opp;
+    else // QUIET moves
+        movable_square = ~occ_all;
+
+    int count = 0;
+
+    if (pieces & PieceGenType::KING) {
+        Bitboard seen = seenSquares<~c>(board, opp_empty);
+
+        count += generateKingMoves(king_sq, seen, movable_square).count();
+
+        if (mt != MoveGenType::CAPTURE && checks == 0) {
+            count += generateCastleMoves<c>(board, king_sq, seen, pin_hv).count();
+        }
+    }
+
+    if (checks == 2)
+        return count;
+
+    movable_square &= checkmask;
+
+    if (pieces & PieceGenType::PAWN) {
+        count += countPawnMoves<c, mt>(board, pin_d, pin_hv, checkmask, occ_opp);
+    }
+
+    if (pieces & PieceGenType::KNIGHT) {
+        Bitboard knights_mask = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv);
+
+        count += whileBitboardCount(
+            knights_mask, [&](Square sq) { return generateKnightMoves(sq) & movable_square; });
+    }
+
+    if (pieces & PieceGenType::BISHOP) {
+        Bitboard bishops_mask = board.pieces(PieceType::BISHOP, c) & ~pin_hv;
+
+        count += whileBitboardCount(bishops_mask, [&](Square sq) {
+            return generateBishopMoves(sq, pin_d, occ_all) & movable_square;
+        });
+    }
+
+    if (pieces & PieceGenType::ROOK) {
+        Bitboard rooks_mask = board.pieces(PieceType::ROOK, c) & ~pin_d;
+
+        count += whileBitboardCount(rooks_mask, [&](Square sq) {
+            return generateRookMoves(sq, pin_hv, occ_all) & movable_square;
+        });
+    }
+
+    if (pieces & PieceGenType::QUEEN) {
+        Bitboard queens_mask = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv);
+
+        count += whileBitboardCount(queens_mask, [&](Square sq) {
+            return generateQueenMoves(sq, pin_d, pin_hv, occ_all) & movable_square;
+        });
+    }
+
+    return count;
+}
+
+template <movegen::MoveGenType mt>
+[[nodiscard]] inline int movegen::countLegal(const Board& board, int pieces) {
+    if (board.sideToMove() == Color::WHITE)
+        return countLegal<Color::WHITE, mt>(board, pieces);
+    else
+        return countLegal<Color::BLACK, mt>(board, pieces);
+}
+
 template <Color::underlying c> inline bool movegen::isEpSquareValid(const Board& board, Square ep) {
     const auto stm = board.sideToMove();
 
@@ -4118,11 +4578,6 @@ template <Color::underlying c> inline bool movegen::isEpSquareValid(const Board&
     return SQUARES_BETWEEN_BB[sq1.index()][sq2.index()];
 }
 
-inline const std::array<std::array<Bitboard, 64>, 64> movegen::SQUARES_BETWEEN_BB = [] {
-    attacks::initAttacks();
-    return movegen::init_squares_between();
-}();
-
 } // namespace chess
 
 #include <istream>
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+constexpr size_t PERF_COUNTER_COUNT = 6;
+
+// Indices into counter arrays, in the order of PERF_COUNTER_NAMES
+enum PerfCounter : size_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+};
+
+extern const std::array<const char*, PERF_COUNTER_COUNT> PERF_COUNTER_NAMES;
+
+// Counts, NaN for counters that were not measured
+using PerfCounts = std::array<double, PERF_COUNTER_COUNT>;
+
+PerfCounts emptyCounts();
+
+// Hardware counters of this process through Linux's perf_event_open, user space only so the
+// default perf_event_paranoid setting allows them. Threads started after the counters were
+// opened are counted too, so a pool has to be created after them. Counters the CPU or kernel
+// does not offer, like every counter inside most virtual machines, read as NaN.
+class PerfCounters {
+  private:
+    // A value with the times its counter was enabled and actually running
+    using Reading = std::array<uint64_t, 3>;
+
+    std::array<int, PERF_COUNTER_COUNT> fds_;
+    std::array<Reading, PERF_COUNTER_COUNT> started_{};
+    std::string error_;
+
+    bool readCounter(size_t counter, Reading& reading) const;
+
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(size_t counter) const { return fds_[counter] >= 0; }
+    bool anyAvailable() const;
+
+    // Why the first counter that failed could not be opened
+    const std::string& error() const { return error_; }
+
+    void start();
+    void stop();
+
+    // The counts between start and stop, scaled up when the kernel had to multiplex counters
+    PerfCounts read() const;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CorpusPosition {
+    std::string fen;
+    bool is_960;
+};
+
+// Positions from inside real trees: every position passed on a number of seeded random walks of
+// up to max_plies moves from each root, without duplicates
+std::vector<CorpusPosition> randomWalkCorpus(const std::vector<CorpusPosition>& roots,
+                                             uint64_t seed, int walks, int max_plies);
+
+struct MicroOptions {
+    // Timed passes over the whole corpus for the warm numbers
+    int passes = 20;
+    // Positions timed one by one after evicting the caches for the cold numbers
+    size_t cold_positions = 64;
+    // Bytes streamed through to evict the caches, 0 for twice the last level cache
+    size_t evict_bytes = 0;
+};
+
+// Times the components of chess.hpp that perft and search lean on, one by one over the corpus:
+// move generation of each kind, makeMove/unmakeMove, isAttacked, givesCheck, zobrist against
+// hash, getFen/setFen and the SAN conversions. Prints ns per operation with warm caches and with
+// caches evicted before every position.
+void runMicrobenchmarks(const std::vector<CorpusPosition>& corpus, const MicroOptions& options);
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chess.hpp"
+
+uint64_t perft(chess::Board& board, int depth);
+
+// Perft that only counts the moves of the last ply with movegen::countLegal. Water's perft fills a
+// movelist at every ply, so this is opt-in and never the baseline of a comparison.
+uint64_t bulkPerft(chess::Board& board, int depth);
+
+struct PerftStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+    double hitRate() const { return probes ? static_cast<double>(hits) / probes : 0.0; }
+};
+
+// A transposition table of subtree counts shared by every thread without locks. An entry is two
+// relaxed 64-bit words, the data and the key XOR the data. A reader only trusts a pair whose XOR
+// gives back its key, so a pair torn by a concurrent store reads as a miss, never a wrong count.
+class PerftTable {
+  private:
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Entry[]> entries_;
+    uint64_t mask_;
+
+    static uint64_t key(uint64_t hash, int depth);
+
+  public:
+    // Rounded down to a power of two entries of 16 bytes, at least one
+    explicit PerftTable(size_t megabytes);
+
+    size_t size() const { return static_cast<size_t>(mask_ + 1); }
+    size_t bytes() const { return size() * sizeof(Entry); }
+
+    void clear();
+    bool probe(uint64_t hash, int depth, uint64_t& nodes) const;
+    void store(uint64_t hash, int depth, uint64_t nodes);
+};
+
+// Perft that reuses the counts of transposed subtrees two or more plies deep. With count_leaves the
+// last ply is counted by bulkPerft.
+uint64_t hashPerft(chess::Board& board, int depth, PerftTable& table, PerftStats& stats,
+                   bool count_leaves = false);
+
+// A fixed set of workers that run batches of indexed tasks. Each batch is dealt round-robin into
+// per-worker deques; a worker pops from the back of its own and, once that is empty, steals from
+// the front of the others, so uneven subtrees even out without a shared queue.
+class PerftPool {
+  private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+
+    std::function<void(int, size_t)> job_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<uint64_t> steals_{0};
+
+    bool nextTask(int worker, size_t& task);
+    void workerLoop(int worker);
+
+  public:
+    explicit PerftPool(int threads);
+    ~PerftPool();
+
+    PerftPool(const PerftPool&) = delete;
+    PerftPool& operator=(const PerftPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()); }
+    uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+    // Calls job(worker, task) once for every task in [0, tasks) and returns when all are done
+    void run(size_t tasks, const std::function<void(int, size_t)>& job);
+};
+
+// Splits the tree split_depth plies below the root (1 or 2, clamped so each subtree keeps at
+// least one ply) and counts the subtrees on the pool, each worker on its own copy of the board.
+// With a table the subtrees are counted by hashPerft and the stats of every worker are added up.
+uint64_t parallelPerft(PerftPool& pool, const chess::Board& board, int depth, int split_depth,
+                       PerftTable* table = nullptr, PerftStats* stats = nullptr,
+                       bool count_leaves = false);
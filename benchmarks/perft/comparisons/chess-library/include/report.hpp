@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "counters.hpp"
+#include "stats.hpp"
+
+// The machine and build a result file was measured with
+struct Host {
+    std::string cpu;
+    // The CPU's feature flags as the kernel reports them, empty where they are unknown
+    std::string flags;
+    std::string compiler;
+    unsigned hardware_threads = 0;
+};
+
+Host detectHost();
+
+// One timed case. Result files read back only carry the summary, not the samples.
+struct CaseRecord {
+    std::string suite;
+    std::string fen;
+    int depth = 0;
+    int threads = 1;
+    // The slider lookup chess.hpp ran with, "magic" or "pext"
+    std::string sliders;
+    uint64_t nodes = 0;
+    Summary time_ns;
+    std::vector<double> samples_ns;
+    double hash_hit_rate = 0;
+    // Averages per run, NaN unless counters were measured
+    PerfCounts counters = emptyCounts();
+
+    double meanNps() const { return time_ns.mean > 0 ? nodes * 1e9 / time_ns.mean : 0.0; }
+    double medianNps() const { return time_ns.median > 0 ? nodes * 1e9 / time_ns.median : 0.0; }
+
+    double ipc() const { return counters[INSTRUCTIONS] / counters[CYCLES]; }
+    double perNode(size_t counter) const { return nodes ? counters[counter] / nodes : NAN; }
+};
+
+struct ResultFile {
+    Host host;
+    std::string date;
+    std::string command;
+    std::vector<CaseRecord> cases;
+};
+
+// The local time in ISO 8601, for stamping result files
+std::string currentDate();
+
+bool writeJson(const std::string& path, const ResultFile& results);
+
+// One row per case, preceded by "# key: value" lines describing the host
+bool writeCsv(const std::string& path, const ResultFile& results);
+bool readCsv(const std::string& path, ResultFile& results, std::string& error);
+
+// Pairs the cases of two result files by fen, depth and threads, and by slider lookup where a
+// file holds several, and prints a Welch's t-test of the run times of every pair, then a summary
+// over all of them. Differences with a p-value below alpha are reported as significant.
+void compareResults(const ResultFile& base, const ResultFile& test, double alpha = 0.05);
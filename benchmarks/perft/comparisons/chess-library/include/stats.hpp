@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Sample statistics of repeated measurements, all in the unit of the samples
+struct Summary {
+    size_t count = 0;
+    double mean = 0;
+    double median = 0;
+    double stddev = 0;
+    double min = 0;
+    double max = 0;
+    // Half-width of the 95% confidence interval of the mean, infinite below two samples
+    double ci95 = 0;
+
+    // The half-width relative to the mean, the precision a run count has reached
+    double relativeCi() const { return mean > 0 ? ci95 / mean : 0.0; }
+};
+
+Summary summarize(const std::vector<double>& samples);
+
+// Two-sided p-value of Student's t-distribution with df degrees of freedom
+double studentTPValue(double t, double df);
+
+// The t for which the two-sided p-value is 1 - confidence, e.g. 12.71 for 95% at one degree
+double studentTQuantile(double confidence, double df);
+
+struct WelchResult {
+    double t = 0;
+    double df = 0;
+    double p = 1;
+};
+
+// Welch's unequal variances t-test of the difference between the means of two samples, given as
+// their mean, standard deviation and count. Samples of fewer than two runs never differ.
+WelchResult welchTest(double mean_a, double stddev_a, size_t count_a, double mean_b,
+                      double stddev_b, size_t count_b);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Test {
+    std::string fen;
+    uint64_t expected_node_count;
+    int depth;
+};
+
+struct Suite {
+    std::string name;
+    std::vector<Test> tests;
+    bool is_960;
+};
+
+// A suite as given on the command line: a name or path followed by colon separated options,
+// e.g. "marcel:depth=5:sample=100" or "../../epd/fischer.epd:depth=3-5:frc"
+struct SuiteSpec {
+    std::string path;
+    int min_depth = 1;
+    int max_depth = 64;
+    uint64_t max_nodes = UINT64_MAX;
+    std::string match;
+    size_t sample = 0;
+    bool is_960 = false;
+};
+
+// The suites Water's perft step runs, in the same order and with the same FRC flags
+extern const std::vector<std::pair<std::string, bool>> water_suites;
+
+// Parses a suite spec, resolving bare names against the epd directory. Returns false and fills
+// the error on malformed options.
+bool parseSuiteSpec(const std::string& arg, const std::string& epd_dir, SuiteSpec& spec,
+                    std::string& error);
+
+// Reads every "fen ;D<depth> <nodes> ..." case of an epd file that passes the spec's filters,
+// keeping the order of the file. Lines with an unparsable fen are skipped, like Water does.
+bool loadSuite(const SuiteSpec& spec, uint64_t seed, Suite& suite, std::string& error);
+
+// Writes the cases back out as an epd file, one line per fen, so Water can run the same sample
+bool writeEpd(const std::string& path, const Suite& suite);
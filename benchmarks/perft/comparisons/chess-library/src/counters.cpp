@@ -0,0 +1,144 @@
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "counters.hpp"
+
+const std::array<const char*, PERF_COUNTER_COUNT> PERF_COUNTER_NAMES = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses"};
+
+PerfCounts emptyCounts() {
+    PerfCounts counts;
+    counts.fill(NAN);
+    return counts;
+}
+
+#ifdef __linux__
+
+// Cache events are encoded as cache | (operation << 8) | (result << 16)
+static constexpr uint64_t cacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int openCounter(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters() {
+    const std::array<std::pair<uint32_t, uint64_t>, PERF_COUNTER_COUNT> events = {{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB)},
+    }};
+
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        fds_[i] = openCounter(events[i].first, events[i].second);
+        if (fds_[i] < 0 && error_.empty()) {
+            error_ = std::string(PERF_COUNTER_NAMES[i]) + ": " + std::strerror(errno);
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (const auto fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::readCounter(size_t counter, Reading& reading) const {
+    return fds_[counter] >= 0 &&
+           ::read(fds_[counter], reading.data(), sizeof(Reading)) == sizeof(Reading);
+}
+
+// Resetting misses what threads that have since exited counted, so runs are told apart by the
+// difference to a reading taken when they start
+void PerfCounters::start() {
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (!readCounter(i, started_[i])) {
+            started_[i] = {};
+        }
+        if (fds_[i] >= 0) {
+            ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop() {
+    for (const auto fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+PerfCounts PerfCounters::read() const {
+    auto counts = emptyCounts();
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        Reading reading;
+        if (!readCounter(i, reading)) {
+            continue;
+        }
+
+        const auto value = static_cast<double>(reading[0] - started_[i][0]);
+        const auto enabled = static_cast<double>(reading[1] - started_[i][1]);
+        const auto running = static_cast<double>(reading[2] - started_[i][2]);
+
+        // A counter that never got its turn on the hardware measured nothing
+        if (running > 0) {
+            counts[i] = value * enabled / running;
+        } else if (enabled == 0) {
+            counts[i] = 0;
+        }
+    }
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() : error_("perf_event_open is only available on Linux") {
+    fds_.fill(-1);
+}
+
+bool PerfCounters::readCounter(size_t, Reading&) const { return false; }
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+PerfCounts PerfCounters::read() const { return emptyCounts(); }
+
+#endif
+
+bool PerfCounters::anyAvailable() const {
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (available(i)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -2,47 +2,133 @@
 #include <cassert>
 #include <chrono>
 #include <cmath>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "chess.hpp"
+#include "counters.hpp"
+#include "micro.hpp"
+#include "perft.hpp"
+#include "report.hpp"
+#include "stats.hpp"
+#include "suite.hpp"
 
 using namespace chess;
 using namespace std::chrono;
 
+// The positions of Water's bench step, run when no suite is given
+const std::vector<Test> classical_positions = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3195901860, 7},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ", 193690690, 5},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ", 178633661, 7},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 706045033, 6},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 89941194, 5},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1", 164075551, 5}};
+
+const std::vector<Test> frc_positions = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w AHah - 0 1", 119060324ull, 6},
+    {"1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", 191762235ull, 6},
+    {"rbbqn1kr/pp2p1pp/6n1/2pp1p2/2P4P/P7/BP1PPPP1/R1BQNNKR w HAha - 0 9", 924181432ull, 6},
+    {"rqbbknr1/1ppp2pp/p5n1/4pp2/P7/1PP5/1Q1PPPPP/R1BBKNRN w GAga - 0 9", 308553169ull, 6},
+    {"4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21", 872323796ull, 6},
+    {"1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14", 2678022813ull, 6},
+    {"qbbnrkr1/p1pppppp/1p4n1/8/2P5/6N1/PPNPPPPP/1BRKBRQ1 b FCge - 1 3", 521301336ull, 6},
+    {"rr6/2kpp3/1ppnb1p1/p2Q1q1p/P4P1P/1PNN2P1/2PP4/1K2RR2 b E - 2 19", 2237725ull, 4},
+    {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 2098209ull, 4},
+    {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 79014522ull, 5},
+    {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 2998685421ull, 6}};
+
 struct RunResult {
-    uint64_t elapsed_ms;
+    uint64_t elapsed_ns;
     uint64_t nodes;
+    PerfCounts counts;
 };
 
-uint64_t perft(Board& board, int depth) {
-    Movelist moves;
-    movegen::legalmoves(moves, board);
+struct Options {
+    std::vector<std::string> suites;
+    std::string epd_dir = "../../epd";
+    std::string write_epd;
+    uint64_t seed = 1;
+    int min_runs = 5;
+    int max_runs = 30;
+    double target_ci = 0.01;
+    double max_seconds = 20.0;
+    int threads = 1;
+    int split_depth = 2;
+    bool scaling = false;
+    bool counters = false;
+    bool count_leaves = false;
+    size_t hash_mb = 0;
+    std::string json;
+    std::string csv;
+    std::vector<std::string> compare;
+    std::string position_fen;
+    int position_depth = 0;
+    bool frc = false;
+    bool micro = false;
+    size_t evict_mb = 0;
+    // Empty keeps the lookup chess.hpp picked at startup
+    std::vector<attacks::SliderLookup> sliders;
+};
+
+const char* sliderName(attacks::SliderLookup lookup) {
+    return lookup == attacks::SliderLookup::PEXT ? "pext" : "magic";
+}
 
-    if (depth == 1) {
-        return moves.size();
+std::vector<attacks::SliderLookup> sliderLookups(const Options& options) {
+    if (options.sliders.empty()) {
+        return {attacks::sliderLookup()};
     }
+    return options.sliders;
+}
 
-    uint64_t nodes = 0;
+// How a run counts. Without a pool or a table the plain single-threaded perft runs, which is also
+// the baseline for scaling. Counters, when given, measure only the perft itself.
+struct PerftSetup {
+    PerftPool* pool;
+    PerftTable* table;
+    int split_depth;
+    bool count_leaves;
+    PerfCounters* counters = nullptr;
+};
 
-    for (const auto& move : moves) {
-        board.makeMove<true>(move);
-        nodes += perft(board, depth - 1);
-        board.unmakeMove(move);
+RunResult runPerftOnce(Board& board, int depth, uint64_t expected_node_count,
+                       const PerftSetup& setup, PerftStats& stats) {
+    // Every run starts cold, or all but the first would be a single probe
+    if (setup.table) {
+        setup.table->clear();
     }
 
-    return nodes;
-}
+    if (setup.counters) {
+        setup.counters->start();
+    }
 
-RunResult runPerftOnce(Board& board, int depth, uint64_t expected_node_count) {
-    const auto t1 = high_resolution_clock::now();
-    const auto nodes = perft(board, depth);
-    const auto t2 = high_resolution_clock::now();
-    const auto ms = duration_cast<milliseconds>(t2 - t1).count();
+    const auto t1 = steady_clock::now();
+    uint64_t nodes;
+    if (setup.pool) {
+        nodes = parallelPerft(*setup.pool, board, depth, setup.split_depth, setup.table, &stats,
+                              setup.count_leaves);
+    } else if (setup.table) {
+        nodes = hashPerft(board, depth, *setup.table, stats, setup.count_leaves);
+    } else if (setup.count_leaves) {
+        nodes = bulkPerft(board, depth);
+    } else {
+        nodes = perft(board, depth);
+    }
+    const auto t2 = steady_clock::now();
+    const auto ns = duration_cast<nanoseconds>(t2 - t1).count();
+
+    auto counts = emptyCounts();
+    if (setup.counters) {
+        setup.counters->stop();
+        counts = setup.counters->read();
+    }
 
     if (nodes != expected_node_count) {
         std::cerr << "Perft error on FEN \"" << board.getFen() << "\"!\n"
@@ -51,87 +137,617 @@ RunResult runPerftOnce(Board& board, int depth, uint64_t expected_node_count) {
     }
     assert(nodes == expected_node_count);
 
-    return {static_cast<uint64_t>(ms), nodes};
+    return {static_cast<uint64_t>(ns), nodes, counts};
 }
 
-struct Test {
-    std::string fen;
-    uint64_t expected_node_count;
-    int depth;
+struct CaseTiming {
+    std::vector<double> samples_ns;
+    Summary time_ns;
+    uint64_t nodes;
+    PerftStats stats;
+    // Averaged over the runs
+    PerfCounts counters;
+
+    double avgMs() const { return time_ns.mean / 1e6; }
 };
 
-void benchmark(const std::vector<Test>& test_cases, bool is_960) {
-    const int num_runs = 5;
+// Runs a case at least min_runs times, then again until the 95% confidence interval of the mean
+// is within target_ci of it, stopping early at max_runs or once max_seconds have been spent
+CaseTiming timeCase(const Test& tc, bool is_960, const Options& options,
+                    const PerftSetup& setup) {
+    CaseTiming timing{{}, {}, 0, {}, {}};
+    const double budget_ns = options.max_seconds * 1e9;
+    double spent_ns = 0;
+
+    while (true) {
+        Board board(tc.fen);
+        if (is_960) {
+            board.set960(true);
+        }
+        RunResult res = runPerftOnce(board, tc.depth, tc.expected_node_count, setup, timing.stats);
+        timing.samples_ns.push_back(static_cast<double>(res.elapsed_ns));
+        timing.nodes = res.nodes;
+        spent_ns += static_cast<double>(res.elapsed_ns);
+        for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            timing.counters[i] += res.counts[i];
+        }
+
+        const int runs = static_cast<int>(timing.samples_ns.size());
+        if (runs < options.min_runs) {
+            continue;
+        }
+        timing.time_ns = summarize(timing.samples_ns);
+        if (runs >= options.max_runs || spent_ns >= budget_ns ||
+            timing.time_ns.relativeCi() <= options.target_ci) {
+            break;
+        }
+    }
 
+    for (auto& count : timing.counters) {
+        count /= static_cast<double>(timing.samples_ns.size());
+    }
+    return timing;
+}
+
+CaseRecord makeRecord(const std::string& suite, const Test& tc, int threads,
+                      const CaseTiming& timing) {
+    CaseRecord record;
+    record.suite = suite;
+    record.fen = tc.fen;
+    record.depth = tc.depth;
+    record.threads = threads;
+    record.sliders = sliderName(attacks::sliderLookup());
+    record.nodes = timing.nodes;
+    record.time_ns = timing.time_ns;
+    record.samples_ns = timing.samples_ns;
+    record.hash_hit_rate = timing.stats.hitRate();
+    record.counters = timing.counters;
+    return record;
+}
+
+// Counters have to be opened before any pool starts its threads, or those go uncounted
+std::unique_ptr<PerfCounters> openCounters(const Options& options) {
+    if (!options.counters) {
+        return nullptr;
+    }
+
+    auto counters = std::make_unique<PerfCounters>();
+    if (!counters->anyAvailable()) {
+        std::cerr << "No hardware counters could be opened (" << counters->error()
+                  << "), check /proc/sys/kernel/perf_event_paranoid" << std::endl;
+        return nullptr;
+    }
+    if (!counters->error().empty()) {
+        std::cerr << "Some hardware counters are unavailable (" << counters->error() << ")"
+                  << std::endl;
+    }
+    return counters;
+}
+
+std::string formatCount(double value, int precision) {
+    if (std::isnan(value)) {
+        return "n/a";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(precision) << value;
+    return out.str();
+}
+
+// The counters of a case on a line of their own, below the line of its timings
+void printCounters(const CaseRecord& record) {
+    std::cout << "    ipc: " << formatCount(record.ipc(), 2);
+    for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        std::cout << " | " << PERF_COUNTER_NAMES[i] << "/node: "
+                  << formatCount(record.perNode(i), i < BRANCH_MISSES ? 1 : 4);
+    }
+    std::cout << std::endl;
+}
+
+void benchmark(const std::string& suite, const std::vector<Test>& test_cases, bool is_960,
+               const Options& options, std::vector<CaseRecord>& records) {
+    const auto counters = openCounters(options);
+    std::unique_ptr<PerftPool> pool;
+    if (options.threads > 1) {
+        pool = std::make_unique<PerftPool>(options.threads);
+    }
+    std::unique_ptr<PerftTable> table;
+    if (options.hash_mb > 0) {
+        table = std::make_unique<PerftTable>(options.hash_mb);
+    }
+    const PerftSetup setup{pool.get(), table.get(), options.split_depth, options.count_leaves,
+                           counters.get()};
+
+    // With both slider lookups, each case runs under one right after the other, so drift in the
+    // machine's speed affects both alike
+    const auto lookups = sliderLookups(options);
     for (const auto& tc : test_cases) {
-        std::vector<RunResult> results;
-        results.reserve(num_runs);
+        for (const auto lookup : lookups) {
+            attacks::setSliderLookup(lookup);
+            const auto timing = timeCase(tc, is_960, options, setup);
+            const auto& time = timing.time_ns;
+            records.push_back(makeRecord(suite, tc, options.threads, timing));
 
-        uint64_t nodes = 0;
+            // Everything before the nps keeps the layout benchmarks/ttest.py reads
+            std::cout << "depth " << std::left << std::setw(2) << tc.depth << " nodes "
+                      << std::left << std::setw(12) << timing.nodes << " | runs: " << std::right
+                      << std::setw(3) << time.count << " | median: " << std::setw(10)
+                      << std::fixed << std::setprecision(3) << time.median / 1e6 << "ms"
+                      << " | avg time: " << std::setw(10) << time.mean / 1e6 << "ms"
+                      << " (min: " << time.min / 1e6 << ", max: " << time.max / 1e6
+                      << ", sd: " << time.stddev / 1e6 << ", ci: " << std::setprecision(1)
+                      << time.relativeCi() * 100.0 << "%)";
+            if (lookups.size() > 1) {
+                std::cout << " | sliders: " << std::left << std::setw(5) << sliderName(lookup)
+                          << std::right;
+            }
+            if (table) {
+                std::cout << " | hash hits: " << std::setw(5) << std::setprecision(1)
+                          << timing.stats.hitRate() * 100.0 << "%";
+            }
+            // benchmarks/ttest.py expects the fen right after the nps
+            std::cout << " | avg nps: " << std::setw(9) << std::setprecision(0)
+                      << records.back().meanNps() << " | fen: " << tc.fen << std::endl;
+            if (counters) {
+                printCounters(records.back());
+            }
+        }
+
+        if (lookups.size() > 1) {
+            const auto& a = records[records.size() - 2].time_ns;
+            const auto& b = records.back().time_ns;
+            const auto welch = welchTest(a.mean, a.stddev, a.count, b.mean, b.stddev, b.count);
+            std::cout << "    " << sliderName(lookups[1]) << " vs " << sliderName(lookups[0])
+                      << ": " << std::showpos << std::setprecision(2)
+                      << (a.mean / b.mean - 1.0) * 100.0 << "%" << std::noshowpos
+                      << " | p: " << std::setprecision(4) << welch.p << std::endl;
+        }
+    }
+}
 
-        for (int i = 0; i < num_runs; ++i) {
-            Board board(tc.fen);
-            if (is_960) {
-                board.set960(true);
+// Thread counts doubling from one up to the maximum, which is always included
+std::vector<int> scalingSteps(int max_threads) {
+    std::vector<int> steps;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        steps.push_back(threads);
+    }
+    steps.push_back(std::max(1, max_threads));
+    return steps;
+}
+
+// Runs every case at each thread count, reporting the speedup over the single-threaded perft and
+// the efficiency, the speedup divided by the thread count
+void scaling(const std::string& suite, const std::vector<Test>& test_cases, bool is_960,
+             const Options& options, std::vector<CaseRecord>& records) {
+    const auto steps = scalingSteps(options.threads);
+    std::vector<double> total_ms(steps.size(), 0);
+    uint64_t total_nodes = 0;
+    const auto counters = openCounters(options);
+    std::unique_ptr<PerftTable> table;
+    if (options.hash_mb > 0) {
+        table = std::make_unique<PerftTable>(options.hash_mb);
+    }
+
+    // Efficiency past the hardware's thread count only measures oversubscription
+    std::cout << "(" << std::thread::hardware_concurrency() << " hardware threads, split at ply "
+              << options.split_depth << ")" << std::endl;
+
+    auto report = [](int threads, double avg_ms, uint64_t nodes, double base_ms) {
+        const double nps = avg_ms > 0 ? static_cast<double>(nodes) * 1000.0 / avg_ms : 0.0;
+        const double speedup = avg_ms > 0 ? base_ms / avg_ms : 0.0;
+        std::cout << "  threads " << std::left << std::setw(3) << threads
+                  << " | avg time: " << std::right << std::setw(10) << std::fixed
+                  << std::setprecision(3) << avg_ms << "ms | avg nps: " << std::setw(10)
+                  << std::setprecision(0) << nps << " | speedup: " << std::setw(5)
+                  << std::setprecision(2) << speedup << " | efficiency: " << std::setw(5)
+                  << std::setprecision(1) << speedup / threads * 100.0 << "%" << std::endl;
+    };
+
+    for (const auto& tc : test_cases) {
+        std::cout << "depth " << std::left << std::setw(2) << tc.depth << " nodes " << std::left
+                  << std::setw(12) << tc.expected_node_count << " | fen: " << tc.fen << std::endl;
+
+        double base_ms = 0;
+        for (size_t i = 0; i < steps.size(); ++i) {
+            std::unique_ptr<PerftPool> pool;
+            if (steps[i] > 1) {
+                pool = std::make_unique<PerftPool>(steps[i]);
+            }
+
+            const auto timing = timeCase(tc, is_960, options,
+                                         {pool.get(), table.get(), options.split_depth,
+                                          options.count_leaves, counters.get()});
+            records.push_back(makeRecord(suite, tc, steps[i], timing));
+            base_ms = i == 0 ? timing.avgMs() : base_ms;
+            total_ms[i] += timing.avgMs();
+            report(steps[i], timing.avgMs(), timing.nodes, base_ms);
+            if (counters) {
+                printCounters(records.back());
             }
-            RunResult res = runPerftOnce(board, tc.depth, tc.expected_node_count);
-            results.push_back(res);
-            nodes = res.nodes;
         }
+        total_nodes += tc.expected_node_count;
+    }
 
-        uint64_t total_ms = 0;
-        uint64_t min_ms = std::numeric_limits<uint64_t>::max();
-        uint64_t max_ms = 0;
+    std::cout << "all cases" << std::endl;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        report(steps[i], total_ms[i], total_nodes, total_ms[0]);
+    }
+}
 
-        for (const auto& r : results) {
-            total_ms += r.elapsed_ms;
-            min_ms = std::min(min_ms, r.elapsed_ms);
-            max_ms = std::max(max_ms, r.elapsed_ms);
+void runSuite(const std::string& suite, const std::vector<Test>& test_cases, bool is_960,
+              const Options& options, std::vector<CaseRecord>& records) {
+    if (options.scaling) {
+        const auto lookups = sliderLookups(options);
+        for (const auto lookup : lookups) {
+            attacks::setSliderLookup(lookup);
+            if (lookups.size() > 1) {
+                std::cout << "(sliders: " << sliderName(lookup) << ")" << std::endl;
+            }
+            scaling(suite, test_cases, is_960, options, records);
         }
+    } else {
+        benchmark(suite, test_cases, is_960, options, records);
+    }
+}
 
-        double avg_ms = static_cast<double>(total_ms) / num_runs;
-        double avg_nps = (avg_ms < 1.0) ? 0 : (static_cast<double>(nodes) * 1000.0) / avg_ms;
+void usage() {
+    std::cout
+        << "Usage: chess [options]\n"
+        << "Without --suite, the positions of Water's bench step are run.\n\n"
+        << "Options:\n"
+        << "  --suite <spec>      Run the cases of an epd suite, repeatable. A spec is a name\n"
+        << "                      looked up in the epd directory or a path, followed by any of\n"
+        << "                        :depth=N or :depth=A-B  keep cases within these depths\n"
+        << "                        :nodes=N                drop cases expecting more nodes\n"
+        << "                        :match=STR              keep fens containing STR\n"
+        << "                        :sample=N               run a random sample of N cases\n"
+        << "                        :frc                    treat the positions as chess960\n"
+        << "                      The name water expands to every suite of Water's perft step\n"
+        << "  --epd-dir <dir>     Where suite names are looked up (default: ../../epd)\n"
+        << "  --seed <n>          Seed for suite samples (default: 1)\n"
+        << "  --runs <n>          Run every case exactly n times, instead of adaptively\n"
+        << "  --min-runs <n>      Runs per case before the interval is checked (default: 5)\n"
+        << "  --max-runs <n>      Most runs per case (default: 30)\n"
+        << "  --ci <percent>      Stop once the 95% confidence interval of the mean time is\n"
+        << "                      within this percentage of it (default: 1)\n"
+        << "  --max-time <s>      Stop once a case has run this many seconds (default: 20)\n"
+        << "  --threads <n>       Split each perft across n threads (default: 1)\n"
+        << "  --split <plies>     Split the tree 1 or 2 plies below the root (default: 2)\n"
+        << "  --scaling           Run every case from 1 up to --threads threads, reporting the\n"
+        << "                      speedup and per-thread efficiency of each step\n"
+        << "  --hash <mb>         Reuse the counts of transposed subtrees through a table of\n"
+        << "                      this size shared by all threads (default: 0, disabled).\n"
+        << "                      nps then counts every node of the tree, an effective rate\n"
+        << "  --count-leaves      Count the moves of the last ply without generating them, about\n"
+        << "                      1.1-1.25x the nodes per second. Water's perft generates every\n"
+        << "                      ply, so leave this off when comparing the two\n"
+        << "  --write-epd <dir>   Write the selected cases of each suite to <dir>/<name>.epd\n"
+        << "                      instead of running them. `zig build perft --release -- <dir>`\n"
+        << "                      then runs the same sample, reading the files named after its\n"
+        << "                      suites (so select them through --suite water)\n"
+        << "  --counters          Count cycles, instructions, branch misses and L1d, LLC and\n"
+        << "                      dTLB misses of every case with perf_event_open (Linux),\n"
+        << "                      reporting the IPC and the counts per node\n"
+        << "  --json <file>       Write every case's statistics and run times as JSON, along\n"
+        << "                      with the CPU model and flags\n"
+        << "  --csv <file>        Write every case's statistics as CSV, for --compare\n"
+        << "  --position <fen> <depth>\n"
+        << "                      Time a single position --runs times (default: once), printing\n"
+        << "                      \"run <nodes> <ns>\" per run, like Water's bench with a fen\n"
+        << "  --frc               Treat the --position fen as chess960\n"
+        << "  --micro             Time the components of chess.hpp (move generation, make and\n"
+        << "                      unmake, attacks, checks, hashing, fens and SAN) in ns/op\n"
+        << "                      with warm and with evicted caches. The corpus is the fens of\n"
+        << "                      --suite, or random walks from the bench positions. Water's\n"
+        << "                      counterpart is `zig build micro`\n"
+        << "  --evict-mb <mb>     Memory streamed through to evict the caches before each cold\n"
+        << "                      --micro timing (default: twice the last level cache)\n"
+        << "  --sliders <lookup>  Index the slider attack tables with magic, pext or both, each\n"
+        << "                      case running under one after the other (default: auto, pext\n"
+        << "                      where the CPU has a fast PEXT)\n"
+        << "  --compare <base> <test>\n"
+        << "                      Compare two CSV result files case by case with Welch's\n"
+        << "                      t-test instead of running anything\n"
+        << "  --help              Print this help message\n";
+}
 
-        std::cout << "depth " << std::left << std::setw(2) << tc.depth << " nodes " << std::left
-                  << std::setw(12) << nodes << " | avg time: " << std::right << std::setw(5)
-                  << std::fixed << std::setprecision(1) << avg_ms << "ms"
-                  << " (min: " << std::right << std::setw(4) << min_ms << ", max: " << std::right
-                  << std::setw(4) << max_ms << ")"
-                  << " | avg nps: " << std::right << std::setw(9) << std::fixed
-                  << std::setprecision(0) << avg_nps << " | fen: " << tc.fen << std::endl;
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help") {
+            usage();
+            std::exit(0);
+        } else if (arg == "--scaling") {
+            options.scaling = true;
+            continue;
+        } else if (arg == "--count-leaves") {
+            options.count_leaves = true;
+            continue;
+        } else if (arg == "--counters") {
+            options.counters = true;
+            continue;
+        } else if (arg == "--frc") {
+            options.frc = true;
+            continue;
+        } else if (arg == "--micro") {
+            options.micro = true;
+            continue;
+        } else if (arg == "--position") {
+            if (i + 2 >= argc) {
+                std::cerr << "--position takes a fen and a depth\n";
+                return false;
+            }
+            options.position_fen = argv[i + 1];
+            try {
+                options.position_depth = std::max(1, std::stoi(argv[i + 2]));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid depth for --position: " << argv[i + 2] << "\n";
+                return false;
+            }
+            i += 2;
+            continue;
+        } else if (arg == "--compare") {
+            if (i + 2 >= argc) {
+                std::cerr << "--compare takes a base and a test result file\n";
+                return false;
+            }
+            options.compare = {argv[i + 1], argv[i + 2]};
+            i += 2;
+            continue;
+        } else if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        try {
+            if (arg == "--suite") {
+                options.suites.push_back(value);
+            } else if (arg == "--epd-dir") {
+                options.epd_dir = value;
+            } else if (arg == "--write-epd") {
+                options.write_epd = value;
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value);
+            } else if (arg == "--runs") {
+                options.min_runs = options.max_runs = std::max(1, std::stoi(value));
+            } else if (arg == "--min-runs") {
+                options.min_runs = std::max(1, std::stoi(value));
+            } else if (arg == "--max-runs") {
+                options.max_runs = std::max(1, std::stoi(value));
+            } else if (arg == "--ci") {
+                options.target_ci = std::max(0.0, std::stod(value)) / 100.0;
+            } else if (arg == "--max-time") {
+                options.max_seconds = std::max(0.0, std::stod(value));
+            } else if (arg == "--json") {
+                options.json = value;
+            } else if (arg == "--csv") {
+                options.csv = value;
+            } else if (arg == "--evict-mb") {
+                options.evict_mb = std::stoull(value);
+            } else if (arg == "--threads") {
+                options.threads = std::max(1, std::stoi(value));
+            } else if (arg == "--hash") {
+                options.hash_mb = std::stoull(value);
+            } else if (arg == "--split") {
+                options.split_depth = std::clamp(std::stoi(value), 1, 2);
+            } else if (arg == "--sliders") {
+                using Lookup = attacks::SliderLookup;
+                if (value == "auto") {
+                    options.sliders.clear();
+                } else if (value == "magic") {
+                    options.sliders = {Lookup::MAGIC};
+                } else if (value == "pext") {
+                    options.sliders = {Lookup::PEXT};
+                } else if (value == "both") {
+                    options.sliders = {Lookup::MAGIC, Lookup::PEXT};
+                } else {
+                    throw std::invalid_argument(value);
+                }
+            } else {
+                std::cerr << "Unknown option " << arg << "\n";
+                return false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+
+    options.max_runs = std::max(options.max_runs, options.min_runs);
+    return true;
+}
+
+bool loadSuites(const Options& options, std::vector<Suite>& suites) {
+    std::vector<std::string> specs;
+    for (const auto& arg : options.suites) {
+        const auto colon = arg.find(':');
+        if (arg.substr(0, colon) == "water") {
+            const auto rest = colon == std::string::npos ? "" : arg.substr(colon);
+            for (const auto& [name, is_960] : water_suites) {
+                specs.push_back(name + rest);
+            }
+        } else {
+            specs.push_back(arg);
+        }
+    }
+
+    for (const auto& arg : specs) {
+        SuiteSpec spec;
+        Suite suite;
+        std::string error;
+        if (!parseSuiteSpec(arg, options.epd_dir, spec, error) ||
+            !loadSuite(spec, options.seed, suite, error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        suites.push_back(std::move(suite));
+    }
+
+    return true;
+}
+
+// Times the single position of --position the way Water's bench does with a fen argument, for
+// benchmarks/headtohead.py to interleave the two run by run. A perft one ply shallower warms the
+// caches, then every run prints "run <nodes> <ns>".
+bool benchmarkPosition(const Options& options) {
+    Board board(constants::STARTPOS, options.frc);
+    if (!board.setFen(options.position_fen)) {
+        std::cerr << "Invalid fen \"" << options.position_fen << "\"" << std::endl;
+        return false;
+    }
+
+    const auto count = options.count_leaves ? bulkPerft : perft;
+    if (options.position_depth > 1) {
+        count(board, options.position_depth - 1);
+    }
+
+    for (int i = 0; i < options.min_runs; ++i) {
+        const auto t1 = steady_clock::now();
+        const auto nodes = count(board, options.position_depth);
+        const auto t2 = steady_clock::now();
+        std::cout << "run " << nodes << " " << duration_cast<nanoseconds>(t2 - t1).count()
+                  << std::endl;
+    }
+    return true;
+}
+
+void runMicro(const Options& options, const std::vector<Suite>& suites) {
+    std::vector<CorpusPosition> corpus;
+    if (!suites.empty()) {
+        // Cases of one fen at several depths are one position here
+        for (const auto& suite : suites) {
+            for (size_t i = 0; i < suite.tests.size(); ++i) {
+                if (i == 0 || suite.tests[i].fen != suite.tests[i - 1].fen) {
+                    corpus.push_back({suite.tests[i].fen, suite.is_960});
+                }
+            }
+        }
+    } else {
+        std::vector<CorpusPosition> roots;
+        for (const auto& tc : classical_positions) {
+            roots.push_back({tc.fen, false});
+        }
+        for (const auto& tc : frc_positions) {
+            roots.push_back({tc.fen, true});
+        }
+        corpus = randomWalkCorpus(roots, options.seed, 8, 12);
     }
+
+    MicroOptions micro;
+    micro.evict_bytes = options.evict_mb * 1024 * 1024;
+    runMicrobenchmarks(corpus, micro);
 }
 
-int main() {
+bool writeResults(const Options& options, const ResultFile& results) {
+    if (!options.json.empty() && !writeJson(options.json, results)) {
+        std::cerr << "Failed to write " << options.json << std::endl;
+        return false;
+    }
+    if (!options.csv.empty() && !writeCsv(options.csv, results)) {
+        std::cerr << "Failed to write " << options.csv << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    // Requested lookups are checked up front, leaving the first one in use
+    for (auto it = options.sliders.rbegin(); it != options.sliders.rend(); ++it) {
+        if (!attacks::setSliderLookup(*it)) {
+            std::cerr << "This build or CPU cannot look up slider attacks with " << sliderName(*it)
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    if (!options.position_fen.empty()) {
+        if (options.sliders.size() > 1) {
+            std::cerr << "--position runs with a single slider lookup" << std::endl;
+            return 1;
+        }
+        // Adaptive runs make no sense for a driver that alternates engines itself
+        if (options.min_runs != options.max_runs) {
+            options.min_runs = 1;
+        }
+        return benchmarkPosition(options) ? 0 : 1;
+    }
+
+    if (!options.compare.empty()) {
+        ResultFile base, test;
+        std::string error;
+        if (!readCsv(options.compare[0], base, error) ||
+            !readCsv(options.compare[1], test, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        compareResults(base, test);
+        return 0;
+    }
+
+    std::vector<Suite> suites;
+    if (!loadSuites(options, suites)) {
+        return 1;
+    }
+
+    if (!options.write_epd.empty()) {
+        std::filesystem::create_directories(options.write_epd);
+        for (const auto& suite : suites) {
+            const auto path = (std::filesystem::path(options.write_epd) / (suite.name + ".epd"));
+            if (!writeEpd(path.string(), suite)) {
+                std::cerr << "Failed to write " << path.string() << std::endl;
+                return 1;
+            }
+            std::cout << "Wrote " << suite.tests.size() << " cases to " << path.string()
+                      << std::endl;
+        }
+        return 0;
+    }
+
+    if (options.micro) {
+        const auto lookups = sliderLookups(options);
+        for (size_t i = 0; i < lookups.size(); ++i) {
+            attacks::setSliderLookup(lookups[i]);
+            std::cout << (i == 0 ? "" : "\n") << "Sliders: " << sliderName(lookups[i]) << "\n"
+                      << std::endl;
+            runMicro(options, suites);
+        }
+        return 0;
+    }
+
     std::cout << "Running perft(6) to mitigate cold-start performance hit..." << std::endl;
     Board warmup_board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
     perft(warmup_board, 6);
-    std::cout << "Done. Commencing benchmark...\n" << std::endl;
+    std::cout << "Done. Commencing benchmark with "
+              << (options.sliders.size() > 1 ? "both" : sliderName(attacks::sliderLookup()))
+              << " slider lookups...\n"
+              << std::endl;
+
+    ResultFile results{detectHost(), currentDate(), "", {}};
+    for (int i = 0; i < argc; ++i) {
+        results.command += (i == 0 ? "" : " ") + std::string(argv[i]);
+    }
+
+    if (!suites.empty()) {
+        for (size_t i = 0; i < suites.size(); ++i) {
+            std::cout << (i == 0 ? "" : "\n") << "Benchmarking " << suites[i].name << " ("
+                      << suites[i].tests.size() << " cases"
+                      << (suites[i].is_960 ? ", FRC" : "") << "):" << std::endl;
+            runSuite(suites[i].name, suites[i].tests, suites[i].is_960, options, results.cases);
+        }
+        return writeResults(options, results) ? 0 : 1;
+    }
 
     std::cout << "Benchmarking Classical Positions:" << std::endl;
-    const std::vector<Test> classical_positions = {
-        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 3195901860, 7},
-        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ", 193690690, 5},
-        {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ", 178633661, 7},
-        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 706045033, 6},
-        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 89941194, 5},
-        {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 1", 164075551, 5}};
-    benchmark(classical_positions, false);
+    runSuite("classical", classical_positions, false, options, results.cases);
 
     std::cout << "\nBenchmarking FRC Positions:" << std::endl;
-    const std::vector<Test> frc_positions = {
-        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w AHah - 0 1", 119060324ull, 6},
-        {"1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", 191762235ull, 6},
-        {"rbbqn1kr/pp2p1pp/6n1/2pp1p2/2P4P/P7/BP1PPPP1/R1BQNNKR w HAha - 0 9", 924181432ull, 6},
-        {"rqbbknr1/1ppp2pp/p5n1/4pp2/P7/1PP5/1Q1PPPPP/R1BBKNRN w GAga - 0 9", 308553169ull, 6},
-        {"4rrb1/1kp3b1/1p1p4/pP1Pn2p/5p2/1PR2P2/2P1NB1P/2KR1B2 w D - 0 21", 872323796ull, 6},
-        {"1rkr3b/1ppn3p/3pB1n1/6q1/R2P4/4N1P1/1P5P/2KRQ1B1 b Dbd - 0 14", 2678022813ull, 6},
-        {"qbbnrkr1/p1pppppp/1p4n1/8/2P5/6N1/PPNPPPPP/1BRKBRQ1 b FCge - 1 3", 521301336ull, 6},
-        {"rr6/2kpp3/1ppnb1p1/p2Q1q1p/P4P1P/1PNN2P1/2PP4/1K2RR2 b E - 2 19", 2237725ull, 4},
-        {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 2098209ull, 4},
-        {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 79014522ull, 5},
-        {"rr6/2kpp3/1ppnb1p1/p4q1p/P4P1P/1PNN2P1/2PP2Q1/1K2RR2 w E - 1 19", 2998685421ull, 6}};
-    benchmark(frc_positions, true);
-
-    return 0;
+    runSuite("frc", frc_positions, true, options, results.cases);
+
+    return writeResults(options, results) ? 0 : 1;
 }
\ No newline at end of file
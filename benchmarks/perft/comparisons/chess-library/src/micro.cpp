@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "chess.hpp"
+#include "micro.hpp"
+#include "stats.hpp"
+
+using namespace chess;
+using namespace std::chrono;
+
+std::vector<CorpusPosition> randomWalkCorpus(const std::vector<CorpusPosition>& roots,
+                                             uint64_t seed, int walks, int max_plies) {
+    std::vector<CorpusPosition> corpus;
+    std::unordered_set<std::string> seen;
+    std::mt19937_64 rng(seed);
+
+    auto add = [&](const Board& board) {
+        auto fen = board.getFen();
+        if (seen.insert(fen).second) {
+            corpus.push_back({std::move(fen), board.chess960()});
+        }
+    };
+
+    for (const auto& root : roots) {
+        for (int walk = 0; walk < walks; ++walk) {
+            Board board(root.fen, root.is_960);
+            add(board);
+            for (int ply = 0; ply < max_plies; ++ply) {
+                Movelist moves;
+                movegen::legalmoves(moves, board);
+                if (moves.empty()) {
+                    break;
+                }
+                board.makeMove(moves[rng() % moves.size()]);
+                add(board);
+            }
+        }
+    }
+
+    return corpus;
+}
+
+// ================ COMPONENTS ================
+
+// Everything a component needs prepared ahead of timing, so only the component itself is timed
+struct Prepared {
+    std::string fen;
+    Board board;
+    // Takes the fens setFen is timed with
+    Board scratch;
+    Movelist moves;
+    std::vector<std::string> sans;
+};
+
+// Runs a component once on a position, returning how many operations that took. Results go into
+// the sink so the compiler cannot drop the work.
+using Component = std::function<size_t(Prepared&, uint64_t&)>;
+
+template <movegen::MoveGenType mt> size_t generate(Prepared& p, uint64_t& sink) {
+    Movelist moves;
+    movegen::legalmoves<mt>(moves, p.board);
+    sink += moves.size();
+    return 1;
+}
+
+static const std::vector<std::pair<std::string, Component>> COMPONENTS = {
+    {"legalmoves<ALL>", generate<movegen::MoveGenType::ALL>},
+    {"legalmoves<CAPTURE>", generate<movegen::MoveGenType::CAPTURE>},
+    {"legalmoves<QUIET>", generate<movegen::MoveGenType::QUIET>},
+    {"makeMove/unmakeMove",
+     [](Prepared& p, uint64_t& sink) {
+         for (const auto& move : p.moves) {
+             p.board.makeMove<true>(move);
+             sink += p.board.hash();
+             p.board.unmakeMove(move);
+         }
+         return p.moves.size();
+     }},
+    {"isAttacked",
+     [](Prepared& p, uint64_t& sink) {
+         for (int sq = 0; sq < 64; ++sq) {
+             sink += p.board.isAttacked(Square(sq), Color::WHITE);
+             sink += p.board.isAttacked(Square(sq), Color::BLACK);
+         }
+         return size_t(128);
+     }},
+    {"givesCheck",
+     [](Prepared& p, uint64_t& sink) {
+         for (const auto& move : p.moves) {
+             sink += static_cast<uint64_t>(p.board.givesCheck(move));
+         }
+         return p.moves.size();
+     }},
+    {"zobrist",
+     [](Prepared& p, uint64_t& sink) {
+         sink += p.board.zobrist();
+         return size_t(1);
+     }},
+    {"hash",
+     [](Prepared& p, uint64_t& sink) {
+         sink += p.board.hash();
+         return size_t(1);
+     }},
+    {"getFen",
+     [](Prepared& p, uint64_t& sink) {
+         sink += p.board.getFen().size();
+         return size_t(1);
+     }},
+    {"setFen",
+     [](Prepared& p, uint64_t& sink) {
+         sink += p.scratch.setFen(p.fen);
+         return size_t(1);
+     }},
+    {"parseSan",
+     [](Prepared& p, uint64_t& sink) {
+         for (const auto& san : p.sans) {
+             sink += uci::parseSan(p.board, san).move();
+         }
+         return p.sans.size();
+     }},
+    {"moveToSan",
+     [](Prepared& p, uint64_t& sink) {
+         for (const auto& move : p.moves) {
+             sink += uci::moveToSan(p.board, move).size();
+         }
+         return p.moves.size();
+     }},
+};
+
+// ================ TIMING ================
+
+static size_t lastLevelCacheBytes() {
+#if defined(__linux__) && defined(_SC_LEVEL3_CACHE_SIZE)
+    const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) {
+        return static_cast<size_t>(l3);
+    }
+    const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) {
+        return static_cast<size_t>(l2);
+    }
+#endif
+    return 32 * 1024 * 1024;
+}
+
+// Writing a buffer larger than the caches pushes out the tables, boards and code of earlier work
+static void evictCaches(std::vector<uint64_t>& buffer, uint64_t& sink) {
+    for (size_t i = 0; i < buffer.size(); i += 8) {
+        buffer[i] += sink;
+        sink ^= buffer[i];
+    }
+}
+
+// What reading the clock twice costs, taken off every cold timing
+static double clockOverheadNs() {
+    std::vector<double> samples;
+    for (int i = 0; i < 1001; ++i) {
+        const auto t1 = steady_clock::now();
+        const auto t2 = steady_clock::now();
+        samples.push_back(static_cast<double>(duration_cast<nanoseconds>(t2 - t1).count()));
+    }
+    return summarize(samples).median;
+}
+
+void runMicrobenchmarks(const std::vector<CorpusPosition>& corpus, const MicroOptions& options) {
+    std::vector<Prepared> prepared;
+    size_t total_moves = 0;
+    for (const auto& position : corpus) {
+        Prepared p{position.fen, Board(position.fen, position.is_960),
+                   Board(position.fen, position.is_960), {}, {}};
+        movegen::legalmoves(p.moves, p.board);
+        for (const auto& move : p.moves) {
+            p.sans.push_back(uci::moveToSan(p.board, move));
+        }
+        total_moves += p.moves.size();
+        prepared.push_back(std::move(p));
+    }
+
+    if (prepared.empty()) {
+        std::cerr << "The corpus holds no positions" << std::endl;
+        return;
+    }
+
+    const size_t evict_bytes =
+        options.evict_bytes ? options.evict_bytes : 2 * lastLevelCacheBytes();
+    std::vector<uint64_t> evict_buffer(evict_bytes / sizeof(uint64_t), 1);
+    const size_t cold_positions = std::min(options.cold_positions, prepared.size());
+    const double overhead_ns = clockOverheadNs();
+    uint64_t sink = 0;
+
+    std::cout << "Microbenchmarks over " << prepared.size() << " positions (" << total_moves
+              << " legal moves)\n"
+              << "warm: median of " << options.passes << " passes over every position, ci of "
+              << "the mean\n"
+              << "cold: median over " << cold_positions << " positions, each after evicting "
+              << evict_bytes / (1024 * 1024) << " MB, less " << std::fixed
+              << std::setprecision(1) << overhead_ns << "ns of clock overhead\n"
+              << std::endl;
+
+    std::cout << std::left << std::setw(22) << "component" << std::right << std::setw(10)
+              << "ops/pass" << std::setw(14) << "warm ns/op" << std::setw(8) << "ci"
+              << std::setw(14) << "cold ns/op" << std::setw(10) << "cold/warm" << std::endl;
+
+    for (const auto& [name, component] : COMPONENTS) {
+        // One untimed pass settles the caches and the branch predictors
+        size_t ops = 0;
+        for (auto& p : prepared) {
+            ops += component(p, sink);
+        }
+
+        std::vector<double> warm;
+        for (int pass = 0; pass < options.passes; ++pass) {
+            const auto t1 = steady_clock::now();
+            for (auto& p : prepared) {
+                component(p, sink);
+            }
+            const auto t2 = steady_clock::now();
+            warm.push_back(static_cast<double>(duration_cast<nanoseconds>(t2 - t1).count()) /
+                           static_cast<double>(std::max<size_t>(ops, 1)));
+        }
+
+        // Positions without moves do no work for some components and are left out of the cold run
+        std::vector<double> cold;
+        for (size_t i = 0; i < prepared.size() && cold.size() < cold_positions; ++i) {
+            evictCaches(evict_buffer, sink);
+            const auto t1 = steady_clock::now();
+            const size_t position_ops = component(prepared[i], sink);
+            const auto t2 = steady_clock::now();
+            if (position_ops == 0) {
+                continue;
+            }
+            const double ns = static_cast<double>(duration_cast<nanoseconds>(t2 - t1).count());
+            cold.push_back(std::max(0.0, ns - overhead_ns) / position_ops);
+        }
+
+        const auto warm_summary = summarize(warm);
+        const auto cold_summary = summarize(cold);
+        std::cout << std::left << std::setw(22) << name << std::right << std::setw(10) << ops
+                  << std::setw(14) << std::setprecision(2) << warm_summary.median << std::setw(7)
+                  << std::setprecision(1) << warm_summary.relativeCi() * 100.0 << "%"
+                  << std::setw(14) << std::setprecision(2) << cold_summary.median << std::setw(9)
+                  << std::setprecision(1)
+                  << (warm_summary.median > 0 ? cold_summary.median / warm_summary.median : 0.0)
+                  << "x" << std::endl;
+    }
+
+    // Printed so the sink, and with it every result, counts as used
+    std::cout << "\n(checksum " << std::hex << sink << std::dec << ")" << std::endl;
+}
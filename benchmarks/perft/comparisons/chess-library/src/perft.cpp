@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "perft.hpp"
+
+using namespace chess;
+
+uint64_t perft(Board& board, int depth) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    uint64_t nodes = 0;
+
+    for (const auto& move : moves) {
+        board.makeMove<true>(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove(move);
+    }
+
+    return nodes;
+}
+
+uint64_t bulkPerft(Board& board, int depth) {
+    // Leaves are only counted, so they never become moves
+    if (depth == 1) {
+        return static_cast<uint64_t>(movegen::countLegal(board));
+    }
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    uint64_t nodes = 0;
+
+    for (const auto& move : moves) {
+        board.makeMove<true>(move);
+        nodes += bulkPerft(board, depth - 1);
+        board.unmakeMove(move);
+    }
+
+    return nodes;
+}
+
+// ================ HASHING ================
+
+// Counts use the low 56 bits of the data word and the depth the high 8
+constexpr uint64_t NODES_MASK = (uint64_t(1) << 56) - 1;
+
+uint64_t PerftTable::key(uint64_t hash, int depth) {
+    // Counts of one position at different depths land in different slots
+    return hash ^ (static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ull);
+}
+
+PerftTable::PerftTable(size_t megabytes) {
+    const uint64_t entries = std::max<uint64_t>(1, megabytes * 1024 * 1024 / sizeof(Entry));
+    mask_ = std::bit_floor(entries) - 1;
+    entries_ = std::make_unique<Entry[]>(size());
+    clear();
+}
+
+void PerftTable::clear() {
+    for (size_t i = 0; i < size(); ++i) {
+        entries_[i].check.store(0, std::memory_order_relaxed);
+        entries_[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool PerftTable::probe(uint64_t hash, int depth, uint64_t& nodes) const {
+    const auto k = key(hash, depth);
+    const auto& entry = entries_[k & mask_];
+    const auto data = entry.data.load(std::memory_order_relaxed);
+    const auto check = entry.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != k || static_cast<int>(data >> 56) != depth) {
+        return false;
+    }
+
+    nodes = data & NODES_MASK;
+    return true;
+}
+
+void PerftTable::store(uint64_t hash, int depth, uint64_t nodes) {
+    const auto k = key(hash, depth);
+    const auto data = (static_cast<uint64_t>(depth) << 56) | (nodes & NODES_MASK);
+    auto& entry = entries_[k & mask_];
+    entry.check.store(k ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+uint64_t hashPerft(Board& board, int depth, PerftTable& table, PerftStats& stats,
+                   bool count_leaves) {
+    // Depth one is only a move count, cheaper to redo than to store
+    if (depth <= 1) {
+        return count_leaves ? bulkPerft(board, depth) : perft(board, depth);
+    }
+
+    uint64_t nodes = 0;
+    stats.probes++;
+    if (table.probe(board.hash(), depth, nodes)) {
+        stats.hits++;
+        return nodes;
+    }
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    for (const auto& move : moves) {
+        board.makeMove<true>(move);
+        nodes += hashPerft(board, depth - 1, table, stats, count_leaves);
+        board.unmakeMove(move);
+    }
+
+    table.store(board.hash(), depth, nodes);
+    return nodes;
+}
+
+// ================ POOL ================
+
+PerftPool::PerftPool(int threads) {
+    const int count = std::max(1, threads);
+    for (int i = 0; i < count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < count; ++i) {
+        threads_.emplace_back(&PerftPool::workerLoop, this, i);
+    }
+}
+
+PerftPool::~PerftPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+bool PerftPool::nextTask(int worker, size_t& task) {
+    {
+        auto& own = *workers_[worker];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Victims are visited starting from the next worker so thieves spread out
+    for (int i = 1; i < size(); ++i) {
+        auto& victim = *workers_[(worker + i) % size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PerftPool::workerLoop(int worker) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        size_t task;
+        while (nextTask(worker, task)) {
+            job_(worker, task);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard lock(mutex_);
+                done_cv_.notify_all();
+            }
+        }
+    }
+}
+
+void PerftPool::run(size_t tasks, const std::function<void(int, size_t)>& job) {
+    if (tasks == 0) {
+        return;
+    }
+
+    std::unique_lock lock(mutex_);
+    job_ = job;
+    pending_.store(tasks, std::memory_order_relaxed);
+    for (size_t i = 0; i < tasks; ++i) {
+        auto& worker = *workers_[i % workers_.size()];
+        std::lock_guard worker_lock(worker.mutex);
+        worker.tasks.push_back(i);
+    }
+
+    ++generation_;
+    start_cv_.notify_all();
+    done_cv_.wait(lock, [&] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+// ================ ROOT SPLIT ================
+
+struct Subtree {
+    std::array<Move, 2> path;
+    int length;
+    uint64_t nodes;
+};
+
+uint64_t parallelPerft(PerftPool& pool, const Board& board, int depth, int split_depth,
+                       PerftTable* table, PerftStats* stats, bool count_leaves) {
+    const auto count = count_leaves ? bulkPerft : perft;
+    split_depth = std::clamp(split_depth, 1, std::max(1, depth - 1));
+    if (depth <= 1) {
+        Board copy = board;
+        return count(copy, depth);
+    }
+
+    Board root = board;
+    std::vector<Subtree> subtrees;
+    Movelist moves;
+    movegen::legalmoves(moves, root);
+    for (const auto& move : moves) {
+        if (split_depth == 1) {
+            subtrees.push_back({{move, Move{}}, 1, 0});
+            continue;
+        }
+
+        root.makeMove<true>(move);
+        Movelist replies;
+        movegen::legalmoves(replies, root);
+        for (const auto& reply : replies) {
+            subtrees.push_back({{move, reply}, 2, 0});
+        }
+        root.unmakeMove(move);
+    }
+
+    std::vector<Board> boards(pool.size(), board);
+    std::vector<PerftStats> worker_stats(pool.size());
+    pool.run(subtrees.size(), [&](int worker, size_t task) {
+        auto& subtree = subtrees[task];
+        auto& local = boards[worker];
+        for (int i = 0; i < subtree.length; ++i) {
+            local.makeMove<true>(subtree.path[i]);
+        }
+        if (table) {
+            // Counted on the stack, as the workers' stats share cache lines
+            PerftStats counted;
+            subtree.nodes =
+                hashPerft(local, depth - subtree.length, *table, counted, count_leaves);
+            worker_stats[worker].probes += counted.probes;
+            worker_stats[worker].hits += counted.hits;
+        } else {
+            subtree.nodes = count(local, depth - subtree.length);
+        }
+        for (int i = subtree.length - 1; i >= 0; --i) {
+            local.unmakeMove(subtree.path[i]);
+        }
+    });
+
+    if (stats) {
+        for (const auto& local : worker_stats) {
+            stats->probes += local.probes;
+            stats->hits += local.hits;
+        }
+    }
+
+    uint64_t nodes = 0;
+    for (const auto& subtree : subtrees) {
+        nodes += subtree.nodes;
+    }
+    return nodes;
+}
@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "report.hpp"
+
+static std::string trim(const std::string& str) {
+    const auto first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return "";
+    }
+    const auto last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+// ================ HOST ================
+
+// The brand string of x86 processors, for platforms without /proc/cpuinfo
+static std::string cpuBrand() {
+    unsigned int regs[12] = {};
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0x80000000);
+    if (static_cast<unsigned int>(info[0]) < 0x80000004) {
+        return "";
+    }
+    for (unsigned int i = 0; i < 3; ++i) {
+        __cpuid(reinterpret_cast<int*>(regs + 4 * i), 0x80000002 + i);
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004) {
+        return "";
+    }
+    for (unsigned int i = 0; i < 3; ++i) {
+        __get_cpuid(0x80000002 + i, &regs[4 * i], &regs[4 * i + 1], &regs[4 * i + 2],
+                    &regs[4 * i + 3]);
+    }
+#else
+    return "";
+#endif
+    return trim(std::string(reinterpret_cast<const char*>(regs), sizeof(regs)).c_str());
+}
+
+Host detectHost() {
+    Host host;
+    host.hardware_threads = std::thread::hardware_concurrency();
+
+    // x86 kernels list "model name" and "flags", arm ones "Features"
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        const auto colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        const auto key = trim(line.substr(0, colon));
+        const auto value = trim(line.substr(colon + 1));
+        if (key == "model name" && host.cpu.empty()) {
+            host.cpu = value;
+        } else if ((key == "flags" || key == "Features") && host.flags.empty()) {
+            host.flags = value;
+        }
+    }
+
+    if (host.cpu.empty()) {
+        host.cpu = cpuBrand();
+    }
+    if (host.cpu.empty()) {
+        host.cpu = "unknown";
+    }
+
+#if defined(__clang__)
+    host.compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    host.compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    host.compiler = "msvc " + std::to_string(_MSC_VER);
+#else
+    host.compiler = "unknown";
+#endif
+
+    return host;
+}
+
+std::string currentDate() {
+    const auto now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S%z", &local);
+    return buffer;
+}
+
+// ================ JSON ================
+
+static std::string jsonString(const std::string& str) {
+    std::ostringstream out;
+    out << '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                << std::dec << std::setfill(' ');
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+// JSON has no infinity, which an interval of a single run is, nor NaN, an unmeasured counter
+static std::string jsonNumber(double value, int precision = 1) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(precision) << value;
+    return out.str();
+}
+
+// Counters are only written for cases that measured at least one
+static bool hasCounters(const CaseRecord& record) {
+    for (const auto count : record.counters) {
+        if (!std::isnan(count)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool writeJson(const std::string& path, const ResultFile& results) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    const auto& host = results.host;
+    file << "{\n"
+         << "  \"host\": {\n"
+         << "    \"cpu\": " << jsonString(host.cpu) << ",\n"
+         << "    \"flags\": " << jsonString(host.flags) << ",\n"
+         << "    \"compiler\": " << jsonString(host.compiler) << ",\n"
+         << "    \"hardware_threads\": " << host.hardware_threads << "\n"
+         << "  },\n"
+         << "  \"date\": " << jsonString(results.date) << ",\n"
+         << "  \"command\": " << jsonString(results.command) << ",\n"
+         << "  \"cases\": [";
+
+    for (size_t i = 0; i < results.cases.size(); ++i) {
+        const auto& record = results.cases[i];
+        const auto& time = record.time_ns;
+        file << (i == 0 ? "\n" : ",\n") << "    {\n"
+             << "      \"suite\": " << jsonString(record.suite) << ",\n"
+             << "      \"fen\": " << jsonString(record.fen) << ",\n"
+             << "      \"depth\": " << record.depth << ",\n"
+             << "      \"threads\": " << record.threads << ",\n"
+             << "      \"sliders\": " << jsonString(record.sliders) << ",\n"
+             << "      \"nodes\": " << record.nodes << ",\n"
+             << "      \"runs\": " << time.count << ",\n"
+             << "      \"time_ns\": {\"mean\": " << jsonNumber(time.mean)
+             << ", \"median\": " << jsonNumber(time.median)
+             << ", \"stddev\": " << jsonNumber(time.stddev)
+             << ", \"ci95\": " << jsonNumber(time.ci95) << ", \"min\": " << jsonNumber(time.min)
+             << ", \"max\": " << jsonNumber(time.max) << "},\n"
+             << "      \"nps\": {\"mean\": " << jsonNumber(record.meanNps())
+             << ", \"median\": " << jsonNumber(record.medianNps()) << "},\n"
+             << "      \"hash_hit_rate\": " << std::setprecision(6) << record.hash_hit_rate
+             << ",\n";
+        if (hasCounters(record)) {
+            file << "      \"counters\": {";
+            for (size_t j = 0; j < PERF_COUNTER_COUNT; ++j) {
+                file << "\"" << PERF_COUNTER_NAMES[j]
+                     << "\": " << jsonNumber(record.counters[j]) << ", ";
+            }
+            file << "\"ipc\": " << jsonNumber(record.ipc(), 3) << "},\n"
+                 << "      \"per_node\": {";
+            for (size_t j = 0; j < PERF_COUNTER_COUNT; ++j) {
+                file << (j == 0 ? "\"" : ", \"") << PERF_COUNTER_NAMES[j]
+                     << "\": " << jsonNumber(record.perNode(j), 4);
+            }
+            file << "},\n";
+        }
+        file << "      \"samples_ns\": [";
+        for (size_t j = 0; j < record.samples_ns.size(); ++j) {
+            file << (j == 0 ? "" : ", ") << jsonNumber(record.samples_ns[j]);
+        }
+        file << "]\n    }";
+    }
+
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file.flush());
+}
+
+// ================ CSV ================
+
+static const char* CSV_HEADER = "suite,fen,depth,threads,sliders,nodes,runs,mean_ns,median_ns,"
+                                "stddev_ns,ci95_ns,min_ns,max_ns,mean_nps,median_nps,hash_hit_rate";
+
+// Unmeasured values are left empty
+static std::string csvNumber(double value, int precision = 1) {
+    return std::isfinite(value) ? jsonNumber(value, precision) : "";
+}
+
+// Fields are quoted when they hold a comma or a quote, which fens and suite names never do
+static std::string csvField(const std::string& str) {
+    if (str.find_first_of(",\"") == std::string::npos) {
+        return str;
+    }
+    std::string quoted = "\"";
+    for (const char c : str) {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+static std::vector<std::string> splitCsv(const std::string& line) {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if (quoted && c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+            fields.back() += '"';
+            ++i;
+        } else if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+bool writeCsv(const std::string& path, const ResultFile& results) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "# cpu: " << results.host.cpu << "\n"
+         << "# flags: " << results.host.flags << "\n"
+         << "# compiler: " << results.host.compiler << "\n"
+         << "# hardware_threads: " << results.host.hardware_threads << "\n"
+         << "# date: " << results.date << "\n"
+         << "# command: " << results.command << "\n"
+         << CSV_HEADER;
+    for (const auto name : PERF_COUNTER_NAMES) {
+        file << "," << name;
+    }
+    file << ",ipc";
+    for (const auto name : PERF_COUNTER_NAMES) {
+        file << "," << name << "_per_node";
+    }
+    file << "\n";
+
+    for (const auto& record : results.cases) {
+        const auto& time = record.time_ns;
+        file << csvField(record.suite) << "," << csvField(record.fen) << "," << record.depth << ","
+             << record.threads << "," << record.sliders << "," << record.nodes << ","
+             << time.count << "," << jsonNumber(time.mean) << "," << jsonNumber(time.median) << ","
+             << jsonNumber(time.stddev) << "," << csvNumber(time.ci95) << ","
+             << jsonNumber(time.min) << "," << jsonNumber(time.max) << ","
+             << jsonNumber(record.meanNps()) << "," << jsonNumber(record.medianNps()) << ","
+             << std::setprecision(6) << record.hash_hit_rate;
+        for (const auto count : record.counters) {
+            file << "," << csvNumber(count);
+        }
+        file << "," << csvNumber(record.ipc(), 3);
+        for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            file << "," << csvNumber(record.perNode(i), 4);
+        }
+        file << "\n";
+    }
+
+    return static_cast<bool>(file.flush());
+}
+
+bool readCsv(const std::string& path, ResultFile& results, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Failed to open " + path;
+        return false;
+    }
+
+    results = ResultFile{};
+    std::map<std::string, std::string*> host_fields = {{"cpu", &results.host.cpu},
+                                                       {"flags", &results.host.flags},
+                                                       {"compiler", &results.host.compiler},
+                                                       {"date", &results.date},
+                                                       {"command", &results.command}};
+
+    std::string line;
+    std::vector<std::string> header;
+    for (size_t line_number = 1; std::getline(file, line); ++line_number) {
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        } else if (line[0] == '#') {
+            const auto colon = line.find(':');
+            const auto key = trim(line.substr(1, colon - 1));
+            if (colon != std::string::npos && host_fields.count(key)) {
+                *host_fields[key] = trim(line.substr(colon + 1));
+            }
+            continue;
+        } else if (header.empty()) {
+            header = splitCsv(line);
+            continue;
+        }
+
+        // Columns are looked up by name, so files with extra columns still read
+        const auto fields = splitCsv(line);
+        std::map<std::string, std::string> row;
+        for (size_t i = 0; i < header.size() && i < fields.size(); ++i) {
+            row[header[i]] = fields[i];
+        }
+
+        CaseRecord record;
+        try {
+            record.suite = row["suite"];
+            record.fen = row["fen"];
+            record.depth = std::stoi(row.at("depth"));
+            record.threads = std::stoi(row.at("threads"));
+            record.sliders = row["sliders"];
+            record.nodes = std::stoull(row.at("nodes"));
+            record.time_ns.count = std::stoull(row.at("runs"));
+            record.time_ns.mean = std::stod(row.at("mean_ns"));
+            record.time_ns.median = std::stod(row.at("median_ns"));
+            record.time_ns.stddev = std::stod(row.at("stddev_ns"));
+            record.time_ns.ci95 = row["ci95_ns"].empty() ? INFINITY : std::stod(row["ci95_ns"]);
+            record.time_ns.min = std::stod(row.at("min_ns"));
+            record.time_ns.max = std::stod(row.at("max_ns"));
+            record.hash_hit_rate = row["hash_hit_rate"].empty() ? 0.0
+                                                                : std::stod(row["hash_hit_rate"]);
+            for (size_t i = 0; i < PERF_COUNTER_COUNT; ++i) {
+                const auto& count = row[PERF_COUNTER_NAMES[i]];
+                record.counters[i] = count.empty() ? NAN : std::stod(count);
+            }
+        } catch (const std::exception&) {
+            error = path + ":" + std::to_string(line_number) + ": malformed result row";
+            return false;
+        }
+        results.cases.push_back(std::move(record));
+    }
+
+    if (header.empty()) {
+        error = path + " holds no results";
+        return false;
+    }
+    return true;
+}
+
+// ================ COMPARISON ================
+
+static bool mixesSliders(const ResultFile& results) {
+    return std::any_of(results.cases.begin(), results.cases.end(), [&](const CaseRecord& record) {
+        return record.sliders != results.cases.front().sliders;
+    });
+}
+
+void compareResults(const ResultFile& base, const ResultFile& test, double alpha) {
+    // Files of one slider lookup each are compared across lookups, as a run with magics against
+    // one with PEXT
+    const bool by_sliders = mixesSliders(base) || mixesSliders(test);
+    using Key = std::tuple<std::string, int, int, std::string>;
+    const auto key = [by_sliders](const CaseRecord& record) {
+        return Key{record.fen, record.depth, record.threads, by_sliders ? record.sliders : ""};
+    };
+
+    std::map<Key, const CaseRecord*> base_cases;
+    for (const auto& record : base.cases) {
+        base_cases[key(record)] = &record;
+    }
+
+    std::cout << "base: " << base.host.cpu << ", " << base.date << "\n"
+              << "test: " << test.host.cpu << ", " << test.date << "\n"
+              << std::endl;
+    if (base.host.cpu != test.host.cpu) {
+        std::cout << "Warning: the files were measured on different CPUs\n" << std::endl;
+    }
+
+    size_t matched = 0, faster = 0, slower = 0;
+    double log_speedup = 0;
+    for (const auto& record : test.cases) {
+        const auto found = base_cases.find(key(record));
+        if (found == base_cases.end()) {
+            continue;
+        }
+
+        const auto& a = found->second->time_ns;
+        const auto& b = record.time_ns;
+        if (a.mean <= 0 || b.mean <= 0) {
+            continue;
+        }
+
+        // A positive change means the test ran faster, as with nps
+        const double speedup = a.mean / b.mean;
+        const auto welch = welchTest(a.mean, a.stddev, a.count, b.mean, b.stddev, b.count);
+        const bool significant = welch.p < alpha;
+
+        ++matched;
+        log_speedup += std::log(speedup);
+        if (significant) {
+            (speedup > 1.0 ? faster : slower)++;
+        }
+
+        std::cout << "depth " << std::left << std::setw(2) << record.depth << " threads "
+                  << std::setw(3) << record.threads << " | base: " << std::right << std::setw(11)
+                  << std::fixed << std::setprecision(3) << a.mean / 1e6
+                  << "ms | test: " << std::setw(11) << b.mean / 1e6
+                  << "ms | change: " << std::showpos << std::setw(7) << std::setprecision(2)
+                  << (speedup - 1.0) * 100.0 << "%" << std::noshowpos
+                  << " | t: " << std::setw(7) << welch.t << " | p: " << std::setprecision(4)
+                  << welch.p << (significant ? " *" : "  ") << " | fen: " << record.fen
+                  << std::endl;
+    }
+
+    if (matched == 0) {
+        std::cout << "No matching cases (fen, depth, threads and sliders) were found" << std::endl;
+        return;
+    }
+
+    std::cout << "\n"
+              << matched << " matching cases, " << faster << " significantly faster, " << slower
+              << " significantly slower (* p < " << std::fixed << std::setprecision(2) << alpha
+              << ")\n"
+              << "Geometric mean change: " << std::showpos << std::fixed << std::setprecision(2)
+              << (std::exp(log_speedup / matched) - 1.0) * 100.0 << "%" << std::noshowpos
+              << std::endl;
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "stats.hpp"
+
+Summary summarize(const std::vector<double>& samples) {
+    Summary summary;
+    summary.count = samples.size();
+    if (samples.empty()) {
+        return summary;
+    }
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+
+    summary.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+    summary.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    summary.min = sorted.front();
+    summary.max = sorted.back();
+
+    if (n < 2) {
+        summary.ci95 = std::numeric_limits<double>::infinity();
+        return summary;
+    }
+
+    double squares = 0;
+    for (const auto sample : sorted) {
+        squares += (sample - summary.mean) * (sample - summary.mean);
+    }
+    summary.stddev = std::sqrt(squares / (n - 1));
+    summary.ci95 = studentTQuantile(0.95, n - 1.0) * summary.stddev / std::sqrt(n);
+    return summary;
+}
+
+// Continued fraction of the regularized incomplete beta function, evaluated with Lentz's method
+static double betaContinuedFraction(double a, double b, double x) {
+    constexpr int MAX_ITERATIONS = 300;
+    constexpr double EPSILON = 1e-15;
+    constexpr double TINY = 1e-300;
+
+    auto guard = [](double value) { return std::abs(value) < TINY ? TINY : value; };
+
+    double c = 1.0;
+    double d = 1.0 / guard(1.0 - (a + b) * x / (a + 1.0));
+    double h = d;
+    for (int m = 1; m <= MAX_ITERATIONS; ++m) {
+        const double m2 = 2.0 * m;
+
+        double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 / guard(1.0 + aa * d);
+        c = guard(1.0 + aa / c);
+        h *= d * c;
+
+        aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 / guard(1.0 + aa * d);
+        c = guard(1.0 + aa / c);
+        const double delta = d * c;
+        h *= delta;
+
+        if (std::abs(delta - 1.0) < EPSILON) {
+            break;
+        }
+    }
+    return h;
+}
+
+static double incompleteBeta(double a, double b, double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    } else if (x >= 1.0) {
+        return 1.0;
+    }
+
+    const double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                                  a * std::log(x) + b * std::log(1.0 - x));
+
+    // The fraction converges quickly only on one side of the mean, the symmetry covers the other
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return front * betaContinuedFraction(a, b, x) / a;
+    }
+    return 1.0 - front * betaContinuedFraction(b, a, 1.0 - x) / b;
+}
+
+double studentTPValue(double t, double df) {
+    if (std::isnan(t) || df <= 0) {
+        return 1.0;
+    } else if (std::isinf(t)) {
+        return 0.0;
+    }
+    return incompleteBeta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+double studentTQuantile(double confidence, double df) {
+    const double alpha = 1.0 - confidence;
+
+    // The p-value falls as t grows, so bisection converges on any degrees of freedom
+    double low = 0.0, high = 1.0;
+    while (studentTPValue(high, df) > alpha && high < 1e6) {
+        high *= 2.0;
+    }
+    for (int i = 0; i < 100; ++i) {
+        const double mid = (low + high) / 2.0;
+        (studentTPValue(mid, df) > alpha ? low : high) = mid;
+    }
+    return (low + high) / 2.0;
+}
+
+WelchResult welchTest(double mean_a, double stddev_a, size_t count_a, double mean_b,
+                      double stddev_b, size_t count_b) {
+    WelchResult result;
+    if (count_a < 2 || count_b < 2) {
+        return result;
+    }
+
+    const double var_a = stddev_a * stddev_a / count_a;
+    const double var_b = stddev_b * stddev_b / count_b;
+    const double se = std::sqrt(var_a + var_b);
+
+    // Without any spread the means are either identical or certainly different
+    if (se == 0.0) {
+        result.df = count_a + count_b - 2.0;
+        result.p = mean_a == mean_b ? 1.0 : 0.0;
+        result.t = mean_a == mean_b ? 0.0 : std::copysign(INFINITY, mean_b - mean_a);
+        return result;
+    }
+
+    result.t = (mean_b - mean_a) / se;
+    result.df = (var_a + var_b) * (var_a + var_b) /
+                (var_a * var_a / (count_a - 1.0) + var_b * var_b / (count_b - 1.0));
+    result.p = studentTPValue(result.t, result.df);
+    return result;
+}
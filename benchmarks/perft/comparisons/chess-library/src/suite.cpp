@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+#include "chess.hpp"
+#include "suite.hpp"
+
+using namespace chess;
+
+const std::vector<std::pair<std::string, bool>> water_suites = {
+    {"fischer", true}, {"marcel", false},  {"medium", false},
+    {"reduced", false}, {"standard", false}, {"terje_frc", true}};
+
+static std::string trim(const std::string& str) {
+    const auto first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return "";
+    }
+    const auto last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, last - first + 1);
+}
+
+static std::vector<std::string> split(const std::string& str, char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream stream(str);
+    std::string part;
+    while (std::getline(stream, part, delimiter)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+static bool parseNumber(const std::string& str, uint64_t& value) {
+    if (str.empty() || !std::all_of(str.begin(), str.end(), ::isdigit)) {
+        return false;
+    }
+    try {
+        value = std::stoull(str);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool parseSuiteSpec(const std::string& arg, const std::string& epd_dir, SuiteSpec& spec,
+                    std::string& error) {
+    // Windows paths can carry a drive letter, so options only start after the first separator
+    const auto options_start = arg.find(':', arg.size() > 2 && arg[1] == ':' ? 2 : 0);
+    const auto name = arg.substr(0, options_start);
+    spec = SuiteSpec{};
+
+    spec.path = name;
+    if (name.find('/') == std::string::npos && name.find('\\') == std::string::npos &&
+        std::filesystem::path(name).extension() != ".epd") {
+        spec.path = (std::filesystem::path(epd_dir) / (name + ".epd")).string();
+    }
+
+    const auto stem = std::filesystem::path(spec.path).stem().string();
+    for (const auto& [suite, is_960] : water_suites) {
+        if (suite == stem) {
+            spec.is_960 = is_960;
+        }
+    }
+
+    if (options_start == std::string::npos) {
+        return true;
+    }
+
+    for (const auto& option : split(arg.substr(options_start + 1), ':')) {
+        const auto eq = option.find('=');
+        const auto key = option.substr(0, eq);
+        const auto value = eq == std::string::npos ? "" : option.substr(eq + 1);
+
+        uint64_t number = 0;
+        if (key == "frc" && eq == std::string::npos) {
+            spec.is_960 = true;
+        } else if (key == "depth") {
+            // Either a maximum depth or an inclusive min-max range
+            const auto dash = value.find('-');
+            uint64_t low = 1, high = 0;
+            if (dash == std::string::npos ? !parseNumber(value, high)
+                                          : !parseNumber(value.substr(0, dash), low) ||
+                                                !parseNumber(value.substr(dash + 1), high)) {
+                error = "Invalid depth range \"" + value + "\"";
+                return false;
+            }
+            spec.min_depth = static_cast<int>(std::min<uint64_t>(low, 64));
+            spec.max_depth = static_cast<int>(std::min<uint64_t>(high, 64));
+        } else if (key == "nodes" && parseNumber(value, number)) {
+            spec.max_nodes = number;
+        } else if (key == "sample" && parseNumber(value, number)) {
+            spec.sample = static_cast<size_t>(number);
+        } else if (key == "match" && !value.empty()) {
+            spec.match = value;
+        } else {
+            error = "Invalid suite option \"" + option + "\"";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool loadSuite(const SuiteSpec& spec, uint64_t seed, Suite& suite, std::string& error) {
+    std::ifstream file(spec.path);
+    if (!file) {
+        error = "Failed to open " + spec.path;
+        return false;
+    }
+
+    suite.name = std::filesystem::path(spec.path).stem().string();
+    suite.is_960 = spec.is_960;
+    suite.tests.clear();
+
+    Board board(constants::STARTPOS, spec.is_960);
+    std::string line;
+    while (std::getline(file, line)) {
+        const auto components = split(line, ';');
+        if (components.empty()) {
+            continue;
+        }
+
+        const auto fen = trim(components[0]);
+        if (fen.empty() || !board.setFen(fen)) {
+            continue;
+        }
+        if (!spec.match.empty() && fen.find(spec.match) == std::string::npos) {
+            continue;
+        }
+
+        // Depth entries are formatted as "D<depth> <expected>"
+        for (size_t i = 1; i < components.size(); ++i) {
+            std::istringstream entry(components[i]);
+            std::string depth_str;
+            uint64_t depth = 0, expected = 0;
+            if (!(entry >> depth_str) || depth_str.size() < 2 || depth_str[0] != 'D' ||
+                !parseNumber(depth_str.substr(1), depth) || !(entry >> expected)) {
+                continue;
+            }
+
+            if (static_cast<int>(depth) < spec.min_depth ||
+                static_cast<int>(depth) > spec.max_depth || expected > spec.max_nodes) {
+                continue;
+            }
+            suite.tests.push_back({fen, expected, static_cast<int>(depth)});
+        }
+    }
+
+    // A partial Fisher-Yates draw, put back in file order so runs read like the file
+    if (spec.sample > 0 && spec.sample < suite.tests.size()) {
+        std::mt19937_64 rng(seed);
+        std::vector<size_t> order(suite.tests.size());
+        std::iota(order.begin(), order.end(), 0);
+        for (size_t i = 0; i < spec.sample; ++i) {
+            std::swap(order[i], order[i + rng() % (order.size() - i)]);
+        }
+        order.resize(spec.sample);
+        std::sort(order.begin(), order.end());
+
+        std::vector<Test> sampled;
+        sampled.reserve(order.size());
+        for (const auto index : order) {
+            sampled.push_back(suite.tests[index]);
+        }
+        suite.tests = std::move(sampled);
+    }
+
+    return true;
+}
+
+bool writeEpd(const std::string& path, const Suite& suite) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    // Cases of one fen are adjacent in a loaded suite, so each run of them becomes one line
+    for (size_t i = 0; i < suite.tests.size();) {
+        file << suite.tests[i].fen;
+        size_t j = i;
+        for (; j < suite.tests.size() && suite.tests[j].fen == suite.tests[i].fen; ++j) {
+            file << " ;D" << suite.tests[j].depth << " " << suite.tests[j].expected_node_count;
+        }
+        file << "\n";
+        i = j;
+    }
+
+    return static_cast<bool>(file.flush());
+}
@@ -0,0 +1,5 @@
+#include "chess.hpp"
+
+// The Makefile builds every other file with CHESS_EXTERN_SLIDER_TABLES, so the slider attack
+// tables are evaluated here alone
+CHESS_DEFINE_SLIDER_TABLES
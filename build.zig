@@ -60,6 +60,7 @@ pub fn build(b: *std.Build) !void {
     addRunStep(b, engine, "run", "Run the engine");
     addPerftStep(b, mod);
     addBenchStep(b, mod);
+    addMicroStep(b, mod);
     addSearchStep(b, mod);
 
     // Utils
@@ -196,6 +197,10 @@ fn addPerftStep(b: *std.Build, module: *std.Build.Module) void {
     const run_perft = b.addRunArtifact(perft_exe);
     run_perft.step.dependOn(b.getInstallStep());
 
+    if (b.args) |args| {
+        run_perft.addArgs(args);
+    }
+
     const perft_step = b.step("perft", "Run the comprehensive perft suite");
     perft_step.dependOn(&run_perft.step);
     perft_step.dependOn(&b.addInstallArtifact(perft_exe, .{}).step);
@@ -217,11 +222,40 @@ fn addBenchStep(b: *std.Build, module: *std.Build.Module) void {
     const run_bench = b.addRunArtifact(bench_exe);
     run_bench.step.dependOn(b.getInstallStep());
 
+    if (b.args) |args| {
+        run_bench.addArgs(args);
+    }
+
     const bench_step = b.step("bench", "Run the movegen benchmarking suite");
     bench_step.dependOn(&run_bench.step);
     bench_step.dependOn(&b.addInstallArtifact(bench_exe, .{}).step);
 }
 
+fn addMicroStep(b: *std.Build, module: *std.Build.Module) void {
+    const micro_exe = b.addExecutable(.{
+        .name = "micro",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/water/micro.zig"),
+            .target = module.resolved_target,
+            .optimize = module.optimize,
+            .imports = &.{
+                .{ .name = "water", .module = module },
+            },
+        }),
+    });
+
+    const run_micro = b.addRunArtifact(micro_exe);
+    run_micro.step.dependOn(b.getInstallStep());
+
+    if (b.args) |args| {
+        run_micro.addArgs(args);
+    }
+
+    const micro_step = b.step("micro", "Run the component microbenchmarks");
+    micro_step.dependOn(&run_micro.step);
+    micro_step.dependOn(&b.addInstallArtifact(micro_exe, .{}).step);
+}
+
 fn addSearchStep(b: *std.Build, module: *std.Build.Module) void {
     const bench_exe = b.addExecutable(.{
         .name = "search",
@@ -3,4 +3,14 @@
 std::vector<std::filesystem::path> collect_pgns(std::string pgn_parent_directory,
                                                 std::string pgn_file_extension);
 
-int make_book(int depth, const std::vector<std::filesystem::path>& files, std::string output_file);
+struct BuildReport {
+    // Seconds between progress lines, zero disables them
+    uint64_t ProgressSeconds = 0;
+    // Where to write the final run stats as json, empty disables them
+    std::string StatsFile;
+    // Write the book around the page cache where the platform allows it
+    bool DirectIO = false;
+};
+
+int make_book(int depth, const std::vector<std::filesystem::path>& files, std::string output_file,
+              const BuildReport& report = {});
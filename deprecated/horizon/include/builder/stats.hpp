@@ -0,0 +1,159 @@
+#pragma once
+
+/// A counter written by a single thread and read by any, so the owner never pays for an atomic
+/// read-modify-write on the hot path
+class StatCounter {
+  private:
+    std::atomic<uint64_t> m_Value;
+
+  public:
+    StatCounter() : m_Value(0) {}
+
+    inline void add(uint64_t amount) {
+        m_Value.store(m_Value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    inline void raise(uint64_t value) {
+        if (value > m_Value.load(std::memory_order_relaxed)) {
+            m_Value.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    inline uint64_t load() const { return m_Value.load(std::memory_order_relaxed); }
+};
+
+/// The counters of one parsing thread, aligned so threads never share a cache line
+struct alignas(64) BuildCounters {
+    StatCounter BytesRead;
+    StatCounter Games;
+    StatCounter SanParsed;
+    StatCounter LegalMoves;
+    StatCounter IllegalMoves;
+    StatCounter EntriesWritten;
+    StatCounter FlushNs;
+    StatCounter WriteNs;
+
+    // The aggregation table is drained after every game, so its peak is what matters
+    StatCounter Rehashes;
+    StatCounter PeakTablePositions;
+    StatCounter PeakTableBuckets;
+    StatCounter PeakTableBytes;
+};
+
+/// Every thread's counters merged at one point in time
+struct BuildSnapshot {
+    double Seconds = 0.0;
+    uint64_t BytesRead = 0;
+    uint64_t Games = 0;
+    uint64_t SanParsed = 0;
+    uint64_t LegalMoves = 0;
+    uint64_t IllegalMoves = 0;
+    uint64_t EntriesWritten = 0;
+    uint64_t FlushNs = 0;
+    uint64_t WriteNs = 0;
+    uint64_t Rehashes = 0;
+    uint64_t PeakTablePositions = 0;
+    uint64_t PeakTableBuckets = 0;
+    uint64_t PeakTableBytes = 0;
+
+    double rate(uint64_t count) const { return Seconds > 0.0 ? count / Seconds : 0.0; }
+    double illegal_rate() const {
+        return SanParsed > 0 ? static_cast<double>(IllegalMoves) / SanParsed : 0.0;
+    }
+    double load_factor() const {
+        return PeakTableBuckets > 0 ? static_cast<double>(PeakTablePositions) / PeakTableBuckets
+                                    : 0.0;
+    }
+};
+
+struct FileTiming {
+    std::filesystem::path Path;
+    uint64_t Bytes;
+    uint64_t Games;
+    double Seconds;
+};
+
+/// Collects the counters of every thread taking part in a build, merging them only when read
+class BuildStats {
+  private:
+    std::chrono::steady_clock::time_point m_Start;
+
+    mutable std::mutex m_Mutex;
+    std::vector<Ref<BuildCounters>> m_Threads;
+    std::vector<FileTiming> m_Files;
+
+  public:
+    BuildStats();
+
+    /// Hands out a fresh set of counters for the calling thread to own
+    Ref<BuildCounters> register_thread();
+
+    void record_file(const FileTiming& timing);
+
+    BuildSnapshot snapshot() const;
+
+    std::string progress_line() const;
+
+    bool write_json(const std::filesystem::path& path) const;
+};
+
+/// Prints a progress line from a background thread at a fixed interval until destroyed
+class ProgressReporter {
+  private:
+    const BuildStats& m_Stats;
+    std::chrono::milliseconds m_Interval;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Signal;
+    bool m_Stop;
+    std::thread m_Thread;
+
+  public:
+    ProgressReporter(const BuildStats& stats, uint64_t interval_seconds);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+};
+
+/// A file stream buffer which counts the bytes it hands out as they are read
+class CountingFileBuf : public std::streambuf {
+  private:
+    std::filebuf m_File;
+    StatCounter& m_Counter;
+    std::array<char, 4096> m_Buffer;
+
+  protected:
+    int_type underflow() override {
+        auto got = m_File.sgetn(m_Buffer.data(), static_cast<std::streamsize>(m_Buffer.size()));
+        if (got <= 0) {
+            return traits_type::eof();
+        }
+
+        m_Counter.add(static_cast<uint64_t>(got));
+        setg(m_Buffer.data(), m_Buffer.data(), m_Buffer.data() + got);
+        return traits_type::to_int_type(m_Buffer[0]);
+    }
+
+    // Bulk reads skip the small buffer entirely, which is how the pgn parser consumes the file
+    std::streamsize xsgetn(char* out, std::streamsize count) override {
+        std::streamsize buffered = std::min<std::streamsize>(count, egptr() - gptr());
+        if (buffered > 0) {
+            std::memcpy(out, gptr(), static_cast<size_t>(buffered));
+            setg(eback(), gptr() + buffered, egptr());
+        }
+
+        auto got = m_File.sgetn(out + buffered, count - buffered);
+        if (got > 0) {
+            m_Counter.add(static_cast<uint64_t>(got));
+        }
+        return buffered + std::max<std::streamsize>(got, 0);
+    }
+
+  public:
+    CountingFileBuf(const std::filesystem::path& path, StatCounter& counter) : m_Counter(counter) {
+        m_File.open(path, std::ios::in | std::ios::binary);
+    }
+
+    bool is_open() const { return m_File.is_open(); }
+};
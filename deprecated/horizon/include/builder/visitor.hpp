@@ -1,52 +1,37 @@
 #pragma once
 
-constexpr size_t MAX_BUFFER_SIZE = 64 * 1024;
+#include "builder/stats.hpp"
+#include "core/arena.hpp"
+#include "core/bulkio.hpp"
+#include "core/polyglot.hpp"
 
-#pragma pack(push, 1)
-struct PolyEntry {
-    uint64_t key;
-    uint16_t move;
-    uint16_t weight;
-    uint16_t learn;
-};
-#pragma pack(pop)
+constexpr size_t MAX_BUFFER_SIZE = 64 * 1024;
 
 class PGNVisitor : public pgn::Visitor {
   private:
+    // The table is drained at the end of every game, so its nodes and buckets come from an arena
+    // which is rewound then instead of going back and forth to the heap
+    using MoveCounts = std::pmr::unordered_map<uint16_t, uint16_t>;
+    using PositionTable = std::pmr::unordered_map<uint64_t, MoveCounts>;
+
     Board m_Board;
     uint64_t m_MaxOpeningDepth;
     std::vector<PolyEntry> m_Buffer;
-    std::unordered_map<uint64_t, std::unordered_map<uint16_t, uint16_t>> m_PositionMap;
+    BumpArena m_Arena;
+    PositionTable m_PositionMap;
 
     uint64_t m_NumHalfMovesSoFar;
 
     std::string m_OutFileName;
-    std::ofstream m_OutFile;
+    Ref<BulkBookWriter> m_OutFile;
 
-    uint64_t m_IllegalCounter;
-    uint64_t m_LegalCounter;
-    uint64_t m_GameCounter;
-    uint64_t m_TotalMoves;
+    Ref<BuildCounters> m_Counters;
 
   private:
-    static inline void write_entry(std::ofstream& out, const PolyEntry& e) {
-        auto put16 = [&](uint16_t v) {
-            unsigned char buf[2] = {static_cast<unsigned char>(v >> 8),
-                                    static_cast<unsigned char>(v & 0xFF)};
-            out.write(reinterpret_cast<const char*>(buf), 2);
-        };
-        auto put64 = [&](uint64_t v) {
-            unsigned char buf[8];
-            for (int i = 7; i >= 0; --i) {
-                buf[7 - i] = static_cast<unsigned char>((v >> (i * 8)) & 0xFF);
-            }
-            out.write(reinterpret_cast<const char*>(buf), 8);
-        };
-
-        put64(e.key);
-        put16(e.move);
-        put16(e.weight);
-        put16(e.learn);
+    static inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count());
     }
 
     inline void flush() {
@@ -55,16 +40,18 @@ class PGNVisitor : public pgn::Visitor {
             return;
         }
 
-        for (const auto& entry : m_Buffer) {
-            write_entry(m_OutFile, entry);
-        }
+        auto start = std::chrono::steady_clock::now();
+        m_OutFile->write(m_Buffer);
+        m_Counters->WriteNs.add(elapsed_ns(start));
 
-        m_TotalMoves += m_Buffer.size();
+        m_Counters->EntriesWritten.add(m_Buffer.size());
         m_Buffer.clear();
     }
 
     inline void try_flush() {
         PROFILE_FUNCTION();
+        auto start = std::chrono::steady_clock::now();
+
         for (auto it = m_PositionMap.begin(); it != m_PositionMap.end();) {
             uint64_t key = it->first;
             auto& moves = it->second;
@@ -84,24 +71,60 @@ class PGNVisitor : public pgn::Visitor {
             // If all moves for this key are processed, erase the key
             it = moves.empty() ? m_PositionMap.erase(it) : ++it;
         }
+
+        m_Counters->FlushNs.add(elapsed_ns(start));
     }
 
     inline void add_to_map(uint64_t key, uint16_t move) {
+        size_t buckets = m_PositionMap.bucket_count();
         auto& move_map = m_PositionMap[key];
+        size_t move_buckets = move_map.bucket_count();
+
         if (move_map[move] < UINT16_MAX) {
             move_map[move] += 1;
         }
+
+        if (m_PositionMap.bucket_count() != buckets) {
+            m_Counters->Rehashes.add(1);
+        }
+        if (move_map.bucket_count() != move_buckets && move_buckets > 1) {
+            m_Counters->Rehashes.add(1);
+        }
+    }
+
+    /// Records the size of the aggregation table before it is drained, approximating its memory
+    /// by the buckets and nodes of the outer and inner maps
+    inline void sample_table() {
+        using Outer = PositionTable;
+        using Inner = MoveCounts;
+
+        size_t bytes = m_PositionMap.bucket_count() * sizeof(void*) +
+                       m_PositionMap.size() * (sizeof(Outer::value_type) + sizeof(void*));
+        for (const auto& [key, moves] : m_PositionMap) {
+            bytes += moves.bucket_count() * sizeof(void*) +
+                     moves.size() * (sizeof(Inner::value_type) + sizeof(void*));
+        }
+
+        m_Counters->PeakTablePositions.raise(m_PositionMap.size());
+        m_Counters->PeakTableBuckets.raise(m_PositionMap.bucket_count());
+        m_Counters->PeakTableBytes.raise(bytes);
     }
 
   public:
-    PGNVisitor(uint64_t depth, const std::string& out_file)
-        : m_Board(), m_MaxOpeningDepth(depth), m_NumHalfMovesSoFar(0), m_OutFileName(out_file),
-          m_OutFile(out_file, std::ios::binary | std::ios::out) {
-        if (!m_OutFile.is_open()) {
+    PGNVisitor(uint64_t depth, const std::string& out_file, Ref<BuildCounters> counters,
+               bool direct_io = false)
+        : m_Board(start_board()), m_MaxOpeningDepth(depth), m_PositionMap(&m_Arena),
+          m_NumHalfMovesSoFar(0), m_OutFileName(out_file), m_Counters(std::move(counters)) {
+        auto opened = BulkBookWriter::open(out_file, {BULK_IO_BLOCK_BYTES, direct_io});
+        if (opened.is_err()) {
             throw std::runtime_error("Failed to open output file");
         }
+        m_OutFile = opened.unwrap();
+        if (direct_io && !m_OutFile->direct()) {
+            fmt::eprintln("Direct writes are unsupported for {}, using the page cache",
+                          m_OutFileName);
+        }
 
-        m_Board.setFen(constants::STARTPOS);
         m_Buffer.reserve(MAX_BUFFER_SIZE);
     }
 
@@ -109,10 +132,16 @@ class PGNVisitor : public pgn::Visitor {
         try_flush();
         flush();
 
-        fmt::println("Successfully parsed {} total games", m_GameCounter);
-        fmt::println("\tPlayed {} legal moves", m_LegalCounter);
-        fmt::println("\tSkipped {} illegal moves", m_IllegalCounter);
-        fmt::println("Compiled {} moves into {}", m_TotalMoves, m_OutFileName);
+        auto start = std::chrono::steady_clock::now();
+        if (!m_OutFile->finish()) {
+            fmt::eprintln("Failed to write {}", m_OutFileName);
+        }
+        m_Counters->WriteNs.add(elapsed_ns(start));
+
+        fmt::println("Successfully parsed {} total games", m_Counters->Games.load());
+        fmt::println("\tPlayed {} legal moves", m_Counters->LegalMoves.load());
+        fmt::println("\tSkipped {} illegal moves", m_Counters->IllegalMoves.load());
+        fmt::println("Compiled {} moves into {}", m_Counters->EntriesWritten.load(), m_OutFileName);
     }
 
     virtual void startPgn() override;
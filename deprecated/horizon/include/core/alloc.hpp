@@ -0,0 +1,12 @@
+#pragma once
+
+#ifdef COUNT_ALLOCATIONS
+constexpr bool ALLOCATIONS_COUNTED = true;
+#else
+constexpr bool ALLOCATIONS_COUNTED = false;
+#endif
+
+/// Returns the number of heap allocations the calling thread has made. Only builds defining
+/// COUNT_ALLOCATIONS (the bench build) replace the global operator new to count them, so a loop
+/// can be checked for allocations by reading this before and after it. Elsewhere it returns 0.
+uint64_t thread_allocations();
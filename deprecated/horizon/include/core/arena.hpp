@@ -0,0 +1,65 @@
+#pragma once
+
+/// A bump allocator for scratch memory which lives exactly as long as one unit of work, such as a
+/// game. Deallocation does nothing and reset() rewinds to the first block while keeping them all,
+/// so once the arena has grown to fit the largest unit it never returns to the heap.
+class BumpArena : public std::pmr::memory_resource {
+  private:
+    struct Block {
+        Scope<std::byte[]> Data;
+        size_t Size;
+    };
+
+    std::vector<Block> m_Blocks;
+    size_t m_BlockBytes;
+    size_t m_Current;
+    size_t m_Used;
+
+  protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        while (m_Current < m_Blocks.size()) {
+            auto& block = m_Blocks[m_Current];
+            auto base = reinterpret_cast<uintptr_t>(block.Data.get());
+            size_t offset = ((base + m_Used + alignment - 1) & ~(alignment - 1)) - base;
+            if (offset + bytes <= block.Size) {
+                m_Used = offset + bytes;
+                return block.Data.get() + offset;
+            }
+
+            m_Current++;
+            m_Used = 0;
+        }
+
+        // Only reached while the arena is still growing
+        size_t size = std::max(m_BlockBytes, bytes + alignment);
+        m_Blocks.push_back({Scope<std::byte[]>(new std::byte[size]), size});
+        return do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+  public:
+    explicit BumpArena(size_t block_bytes = 64 * 1024)
+        : m_BlockBytes(block_bytes), m_Current(0), m_Used(0) {}
+
+    BumpArena(const BumpArena&) = delete;
+    BumpArena& operator=(const BumpArena&) = delete;
+
+    /// Makes every block available again. Nothing allocated before may be used afterwards.
+    void reset() {
+        m_Current = 0;
+        m_Used = 0;
+    }
+
+    size_t capacity() const {
+        size_t bytes = 0;
+        for (const auto& block : m_Blocks) {
+            bytes += block.Size;
+        }
+        return bytes;
+    }
+};
@@ -1,6 +1,9 @@
 #pragma once
 
-#ifdef EXAMPLE
+#include "core/mmap.hpp"
+#include "core/polyglot.hpp"
+
+struct OpeningTree;
 
 struct PolyglotMove {
     uint16_t Compact;
@@ -9,27 +12,109 @@ struct PolyglotMove {
 };
 
 struct BookMove {
-    std::string MoveString;
+    uint16_t Compact;
     uint32_t Frequency;
 };
 
-class Book {
+/// A book file to probe, books with a higher priority shadow books with a lower one
+struct BookSource {
+    std::filesystem::path Path;
+    int Priority = 0;
+    float WeightScale = 1.0f;
+};
+
+/// A single mmapped book, probed in place with a binary search over its keys
+class MappedBook {
   private:
-    std::unordered_map<uint64_t, std::vector<BookMove>> m_PolyglotMoves;
+    Ref<MappedFile> m_File;
+    BookSource m_Source;
+    size_t m_NumEntries;
+    bool m_Sorted;
 
-    std::uniform_real_distribution<float> m_UniformRealDist;
-    std::mt19937 m_Rng;
+    // Only populated for books which were not written in key order or repeat moves. Those are
+    // indexed by runs of one key and move, each pointing at its first entry and carrying the summed
+    // weight.
+    std::vector<uint32_t> m_SortedOrder;
+    std::vector<uint32_t> m_RunWeights;
 
   private:
-    Book();
+    MappedBook(Ref<MappedFile> file, const BookSource& source);
+
+    inline size_t physical(size_t idx) const {
+        return m_SortedOrder.empty() ? idx : m_SortedOrder[idx];
+    }
+
+  public:
+    static Result<Ref<MappedBook>, std::string> open(const BookSource& source);
+
+    const BookSource& source() const { return m_Source; }
+    size_t size() const { return m_NumEntries; }
+    bool sorted() const { return m_Sorted; }
+    bool folded() const { return !m_SortedOrder.empty(); }
+
+    size_t mapped_bytes() const { return m_File->size(); }
+    size_t index_bytes() const {
+        return (m_SortedOrder.capacity() + m_RunWeights.capacity()) * sizeof(uint32_t);
+    }
+
+    inline uint64_t key_at(size_t idx) const {
+        return polyglot::key_at(m_File->data(), physical(idx));
+    }
+
+    /// Decodes an entry in key order, with the weight of a folded run clamped to 16 bits
+    inline PolyEntry entry_at(size_t idx) const {
+        auto entry = polyglot::decode_shared(m_File->data() + physical(idx) * POLY_ENTRY_SIZE);
+        if (folded()) {
+            entry.weight = static_cast<uint16_t>(std::min<uint32_t>(m_RunWeights[idx], UINT16_MAX));
+        }
+        return entry;
+    }
+
+    /// The weight of an entry in key order, unclamped for folded runs
+    inline uint32_t weight_at(size_t idx) const {
+        if (folded()) {
+            return m_RunWeights[idx];
+        }
+        return polyglot::load_shared_be16(m_File->data() + idx * POLY_ENTRY_SIZE +
+                                          POLY_WEIGHT_OFFSET);
+    }
+
+    bool contains(uint64_t key) const;
+
+    /// Returns the [first, last) range of entries matching the key in key order
+    std::pair<size_t, size_t> equal_range(uint64_t key) const;
 
-    inline float rand_float() { return m_UniformRealDist(m_Rng); };
+    /// Returns the first entry not less than the key, galloping forward from an earlier result
+    size_t gallop(uint64_t key, size_t from) const;
+};
+
+/// An immutable snapshot of every loaded book, ordered by descending priority
+class BookIndex {
+  private:
+    std::vector<Ref<const MappedBook>> m_Books;
+
+  public:
+    explicit BookIndex(std::vector<Ref<const MappedBook>> books);
+
+    const std::vector<Ref<const MappedBook>>& books() const { return m_Books; }
 
-    static std::unordered_map<uint64_t, std::vector<PolyglotMove>>
-    load_polyglot(const unsigned char* data, size_t size);
+    bool contains(uint64_t key) const;
 
-    static std::unordered_map<uint64_t, std::vector<BookMove>> normalize_polyglot(
-        const std::unordered_map<uint64_t, std::vector<PolyglotMove>>& polyglot_moves);
+    /// Marks which of the ascending keys are in any book, walking each book forward only once
+    void contains_sorted(std::span<const uint64_t> keys, std::span<uint8_t> hits) const;
+
+    /// Collects the moves of the highest priority level containing the key, with scaled weights
+    std::vector<BookMove> probe(uint64_t key) const;
+};
+
+class Book {
+  private:
+    std::atomic<Ref<const BookIndex>> m_Index;
+
+  private:
+    Book();
+
+    static float rand_float();
 
   public:
     Book(const Book&) = delete;
@@ -42,8 +127,18 @@ class Book {
         return s_instance;
     }
 
+    /// Maps all sources and atomically swaps them in, leaving the current books on failure
+    Result<void, std::string> load(const std::vector<BookSource>& sources);
+
+    /// Remaps the currently loaded sources, picking up any rewritten files
+    Result<void, std::string> reload();
+
+    Ref<const BookIndex> snapshot() const { return m_Index.load(std::memory_order_acquire); }
+
     bool is_book_pos(Ref<Board> board);
+
+    /// Returns the book subtree below the board up to the given plies, leaving the board untouched
+    OpeningTree expand(Ref<Board> board, int plies);
+
     Option<std::string> try_get_book_move(Ref<Board> board, float weight = 0.25);
 };
-
-#endif
\ No newline at end of file
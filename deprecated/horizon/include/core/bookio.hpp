@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core/polyglot.hpp"
+
+constexpr size_t BOOK_IO_BLOCK_ENTRIES = 64 * 1024;
+
+/// Streams entries out of a book file front to back through a fixed-size block buffer
+class PolyReader {
+  private:
+    std::ifstream m_Stream;
+    std::vector<unsigned char> m_Block;
+    size_t m_BlockEntries;
+    size_t m_Cursor;
+    uint64_t m_BytesRead;
+
+  private:
+    bool refill() {
+        m_Stream.read(reinterpret_cast<char*>(m_Block.data()),
+                      static_cast<std::streamsize>(m_Block.size()));
+        auto bytes = static_cast<size_t>(m_Stream.gcount());
+        m_BytesRead += bytes;
+        m_BlockEntries = bytes / POLY_ENTRY_SIZE;
+        m_Cursor = 0;
+        return m_BlockEntries > 0;
+    }
+
+  public:
+    explicit PolyReader(const std::filesystem::path& path,
+                        size_t block_entries = BOOK_IO_BLOCK_ENTRIES)
+        : m_Stream(path, std::ios::binary | std::ios::in), m_Block(block_entries * POLY_ENTRY_SIZE),
+          m_BlockEntries(0), m_Cursor(0), m_BytesRead(0) {}
+
+    bool is_open() const { return m_Stream.is_open(); }
+    uint64_t bytes_read() const { return m_BytesRead; }
+
+    /// Decodes the next entry, returning false once the file is exhausted
+    bool next(PolyEntry& entry) {
+        if (m_Cursor >= m_BlockEntries && !refill()) {
+            return false;
+        }
+
+        entry = polyglot::decode(m_Block.data() + m_Cursor * POLY_ENTRY_SIZE);
+        ++m_Cursor;
+        return true;
+    }
+};
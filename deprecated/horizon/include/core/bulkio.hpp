@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/polyglot.hpp"
+
+// Direct writes need their buffer, offset and length aligned to the device's logical block
+constexpr size_t BULK_IO_ALIGNMENT = 4096;
+// The smallest block holding whole entries that is also a whole number of aligned pages
+constexpr size_t BULK_IO_BLOCK_UNIT = POLY_ENTRY_SIZE * BULK_IO_ALIGNMENT / 2;
+constexpr size_t BULK_IO_BLOCK_BYTES = 8 * 1024 * 1024;
+
+struct BulkWriteOptions {
+    // Rounded down to whole units of BULK_IO_BLOCK_UNIT, at least one
+    size_t BlockBytes = BULK_IO_BLOCK_BYTES;
+    // Bypass the page cache where the platform and file system allow it
+    bool Direct = false;
+};
+
+/// Encodes host-order entries into the big-endian book layout, a whole span at a time
+void encode_entries(std::span<const PolyEntry> entries, unsigned char* out);
+
+/// Writes a book from host-order entries. Entries are byte-swapped in bulk into a large aligned
+/// block, which goes out with a single positioned write once it fills, so the encoding never
+/// touches a stream and the file is written in a handful of multi-megabyte requests.
+class BulkBookWriter {
+  private:
+    std::vector<unsigned char> m_Storage;
+    unsigned char* m_Block;
+    size_t m_BlockBytes;
+    size_t m_Cursor;
+    uint64_t m_Offset;
+    bool m_Direct;
+    bool m_Good;
+    std::filesystem::path m_Path;
+
+#ifdef _WIN32
+    std::FILE* m_File;
+#else
+    int m_FileDescriptor;
+#endif
+
+  private:
+    BulkBookWriter();
+
+    bool write_block(size_t bytes);
+    void close();
+
+  public:
+    BulkBookWriter(const BulkBookWriter&) = delete;
+    BulkBookWriter& operator=(const BulkBookWriter&) = delete;
+    BulkBookWriter(BulkBookWriter&&) = delete;
+    BulkBookWriter& operator=(BulkBookWriter&&) = delete;
+
+    ~BulkBookWriter() { finish(); }
+
+    /// Creates the book beside the path, finish() renames it over the path. Asking for direct
+    /// writes where they are unsupported falls back to buffered ones, which direct() then reports.
+    static Result<Ref<BulkBookWriter>, std::string> open(const std::filesystem::path& path,
+                                                         const BulkWriteOptions& options = {});
+
+    bool direct() const { return m_Direct; }
+    bool good() const { return m_Good; }
+    uint64_t bytes_written() const { return m_Offset + m_Cursor; }
+    const std::filesystem::path& path() const { return m_Path; }
+
+    bool write(std::span<const PolyEntry> entries);
+
+    /// Writes what is left of the last block, closes the file and moves it into place, returning
+    /// whether every write succeeded. Later calls only repeat the answer.
+    bool finish();
+
+    /// Closes and removes the partial book, leaving whatever was at the path in place
+    void discard();
+};
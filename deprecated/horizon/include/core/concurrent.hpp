@@ -0,0 +1,115 @@
+#pragma once
+
+/// A fixed-capacity open addressing table from 64-bit keys to the smallest value inserted for
+/// them. Inserts from any number of threads are lock-free, so a parallel pass can find which
+/// record saw each key first without agreeing on an order up front.
+class ConcurrentMinTable {
+  private:
+    static constexpr uint64_t EMPTY = 0;
+    // Zero marks empty slots, so a zero key is stored under this stand-in instead
+    static constexpr uint64_t ZERO_KEY = 0x9E3779B97F4A7C15;
+
+    struct Slot {
+        std::atomic<uint64_t> Key;
+        std::atomic<uint64_t> Value;
+    };
+
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t m_Mask;
+
+    static uint64_t stored_key(uint64_t key) { return key == EMPTY ? ZERO_KEY : key; }
+
+    static size_t slot_count(size_t expected_keys) {
+        return std::bit_ceil(std::max<size_t>(expected_keys * 2, 16));
+    }
+
+    const Slot* find_slot(uint64_t key) const {
+        key = stored_key(key);
+        for (size_t idx = key & m_Mask;; idx = (idx + 1) & m_Mask) {
+            uint64_t current = m_Slots[idx].Key.load(std::memory_order_acquire);
+            if (current == key) {
+                return &m_Slots[idx];
+            } else if (current == EMPTY) {
+                return nullptr;
+            }
+        }
+    }
+
+  public:
+    /// Sizes the table for the expected number of distinct keys at a load factor of at most half
+    explicit ConcurrentMinTable(size_t expected_keys)
+        : m_Slots(new Slot[slot_count(expected_keys)]), m_Mask(slot_count(expected_keys) - 1) {
+        for (size_t i = 0; i <= m_Mask; ++i) {
+            m_Slots[i].Key.store(EMPTY, std::memory_order_relaxed);
+            m_Slots[i].Value.store(UINT64_MAX, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return m_Mask + 1; }
+
+    /// Records the value for the key, keeping the smallest seen. Returns false if the table is
+    /// full, which only happens when more keys arrive than it was sized for.
+    bool insert(uint64_t key, uint64_t value) {
+        key = stored_key(key);
+        size_t idx = key & m_Mask;
+        for (size_t probes = 0; probes <= m_Mask; ++probes, idx = (idx + 1) & m_Mask) {
+            uint64_t current = m_Slots[idx].Key.load(std::memory_order_acquire);
+            // A failed claim reloads current with the key another thread stored first
+            if (current == EMPTY &&
+                m_Slots[idx].Key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                current = key;
+            }
+            if (current != key) {
+                continue;
+            }
+
+            auto& slot_value = m_Slots[idx].Value;
+            uint64_t seen = slot_value.load(std::memory_order_relaxed);
+            while (value < seen &&
+                   !slot_value.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    /// Returns the smallest value recorded for the key, or UINT64_MAX if it was never inserted
+    uint64_t min_value(uint64_t key) const {
+        const auto* slot = find_slot(key);
+        return slot ? slot->Value.load(std::memory_order_relaxed) : UINT64_MAX;
+    }
+};
+
+/// Resolves a requested thread count, where zero means every hardware thread
+inline uint64_t worker_count(uint64_t requested) {
+    return requested > 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// Runs the function over every item on up to the given number of threads, handing items out one
+/// at a time so a slow item never holds back the rest. The calling thread works as well. A
+/// function also taking a size_t receives the index of the worker running it, below threads, so
+/// it can keep per-thread state without locking.
+template <typename T, typename Fn>
+void parallel_for_each(std::span<T> items, uint64_t threads, Fn&& fn) {
+    std::atomic<size_t> next(0);
+    auto worker = [&](size_t index) {
+        for (size_t i = next.fetch_add(1); i < items.size(); i = next.fetch_add(1)) {
+            if constexpr (std::is_invocable_v<Fn&, T&, size_t>) {
+                fn(items[i], index);
+            } else {
+                fn(items[i]);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint64_t t = 1; t < std::min<uint64_t>(threads, items.size()); ++t) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+
+    for (auto& thread : workers) {
+        thread.join();
+    }
+}
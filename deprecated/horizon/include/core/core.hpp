@@ -492,93 +492,220 @@ template <typename T, typename... Args> constexpr Ref<T> CreateRef(Args&&... arg
 
 // ================ PROFILING (from Cherno's Game Engine Series) ================
 
-using FloatingPointMicroseconds = std::chrono::duration<double, std::micro>;
+/// A completed scope, timestamps are steady clock nanoseconds and the name is interned
+struct ProfileEvent {
+    uint64_t Start;
+    uint64_t End;
+    uint32_t NameId;
+};
 
-struct ProfileResult {
-    std::string Name;
+/// A single-producer single-consumer ring of events owned by one thread. The owning thread pushes
+/// without locking and the session writer drains it, events are dropped rather than blocking when
+/// the writer falls behind.
+class ProfileRing {
+  public:
+    static constexpr size_t CAPACITY = 1 << 16;
 
-    FloatingPointMicroseconds Start;
-    std::chrono::microseconds ElapsedTime;
-    std::thread::id ThreadID;
-};
+  private:
+    std::array<ProfileEvent, CAPACITY> m_Events;
+    alignas(64) std::atomic<uint64_t> m_Head;
+    alignas(64) std::atomic<uint64_t> m_Tail;
+    std::atomic<uint64_t> m_Dropped;
+    uint32_t m_ThreadIndex;
 
-struct InstrumentationSession {
-    std::string Name;
+  public:
+    explicit ProfileRing(uint32_t thread_index)
+        : m_Head(0), m_Tail(0), m_Dropped(0), m_ThreadIndex(thread_index) {}
+
+    uint32_t thread_index() const { return m_ThreadIndex; }
+    uint64_t dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+    void push(const ProfileEvent& event) {
+        uint64_t head = m_Head.load(std::memory_order_relaxed);
+        if (head - m_Tail.load(std::memory_order_acquire) >= CAPACITY) {
+            m_Dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        m_Events[head & (CAPACITY - 1)] = event;
+        m_Head.store(head + 1, std::memory_order_release);
+    }
+
+    template <typename F> size_t drain(F&& sink) {
+        uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+        uint64_t head = m_Head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i != head; ++i) {
+            sink(m_Events[i & (CAPACITY - 1)]);
+        }
+
+        m_Tail.store(head, std::memory_order_release);
+        return static_cast<size_t>(head - tail);
+    }
 };
 
 class Instrumentor {
   private:
+    static constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(10);
+
+    // Guards session state and the output stream, never taken on the recording path
     std::mutex m_Mutex;
-    InstrumentationSession* m_CurrentSession;
     std::ofstream m_OutputStream;
+    std::atomic<bool> m_Active;
+
+    std::thread m_Writer;
+    std::condition_variable m_WriterSignal;
+    bool m_StopWriter;
+
+    std::mutex m_RingMutex;
+    std::vector<Ref<ProfileRing>> m_Rings;
+
+    // Names live in a deque so the views keyed into them stay valid as it grows
+    std::mutex m_NameMutex;
+    std::deque<std::string> m_Names;
+    std::unordered_map<std::string_view, uint32_t> m_NameIds;
 
   private:
-    Instrumentor() : m_CurrentSession(nullptr) {}
+    Instrumentor() : m_Active(false), m_StopWriter(false) {}
 
     ~Instrumentor() { end_session(); }
 
-    void write_header() {
-        m_OutputStream << "{\"otherData\": {},\"traceEvents\":[{}";
-        m_OutputStream.flush();
-    }
+    void write_header() { m_OutputStream << "{\"otherData\": {},\"traceEvents\":[{}"; }
 
     void write_footer() {
-        m_OutputStream << "]}";
+        uint64_t dropped = 0;
+        {
+            std::lock_guard lock(m_RingMutex);
+            for (const auto& ring : m_Rings) {
+                dropped += ring->dropped();
+            }
+        }
+
+        m_OutputStream << "],\"droppedEvents\":" << dropped << "}";
         m_OutputStream.flush();
     }
 
+    Ref<ProfileRing> register_thread() {
+        std::lock_guard lock(m_RingMutex);
+        auto ring = CreateRef<ProfileRing>(static_cast<uint32_t>(m_Rings.size()));
+        m_Rings.push_back(ring);
+        return ring;
+    }
+
+    ProfileRing& thread_ring() {
+        thread_local Ref<ProfileRing> t_Ring = register_thread();
+        return *t_Ring;
+    }
+
+    /// Moves every buffered event into the output stream, called with m_Mutex held
+    void drain(bool write) {
+        std::vector<Ref<ProfileRing>> rings;
+        {
+            std::lock_guard lock(m_RingMutex);
+            rings = m_Rings;
+        }
+
+        std::lock_guard names(m_NameMutex);
+        for (const auto& ring : rings) {
+            ring->drain([&](const ProfileEvent& event) {
+                if (!write) {
+                    return;
+                }
+
+                m_OutputStream << ",{\"cat\":\"function\",\"dur\":"
+                               << static_cast<double>(event.End - event.Start) / 1000.0
+                               << ",\"name\":\"" << m_Names[event.NameId]
+                               << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->thread_index()
+                               << ",\"ts\":" << static_cast<double>(event.Start) / 1000.0 << "}";
+            });
+        }
+    }
+
+    void writer_loop() {
+        std::unique_lock lock(m_Mutex);
+        while (!m_StopWriter) {
+            m_WriterSignal.wait_for(lock, DRAIN_INTERVAL, [&] { return m_StopWriter; });
+            drain(true);
+        }
+    }
+
     void internal_end_session() {
-        if (m_CurrentSession) {
-            write_footer();
-            m_OutputStream.close();
-            delete m_CurrentSession;
-            m_CurrentSession = nullptr;
+        if (!m_Writer.joinable()) {
+            return;
         }
+
+        m_Active.store(false, std::memory_order_relaxed);
+        m_StopWriter = true;
+        m_WriterSignal.notify_one();
     }
 
   public:
     Instrumentor(const Instrumentor&) = delete;
     Instrumentor(Instrumentor&&) = delete;
 
-    void begin_session(const std::string& name, const std::string& filepath = "profile-data.json") {
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    void begin_session([[maybe_unused]] const std::string& name,
+                       const std::string& filepath = "profile-data.json") {
+        end_session();
+
         std::lock_guard lock(m_Mutex);
-        if (m_CurrentSession) {
-            internal_end_session();
-        }
         m_OutputStream.open(filepath);
-
-        if (m_OutputStream.is_open()) {
-            m_CurrentSession = new InstrumentationSession({name});
-            write_header();
+        if (!m_OutputStream.is_open()) {
+            return;
         }
+
+        // Leftovers recorded outside a session never make it into the trace
+        drain(false);
+        m_OutputStream << std::setprecision(3) << std::fixed;
+        write_header();
+
+        m_StopWriter = false;
+        m_Active.store(true, std::memory_order_relaxed);
+        m_Writer = std::thread([this] { writer_loop(); });
     }
 
     void end_session() {
-        std::lock_guard lock(m_Mutex);
-        internal_end_session();
+        {
+            std::lock_guard lock(m_Mutex);
+            internal_end_session();
+        }
+
+        if (m_Writer.joinable()) {
+            m_Writer.join();
+
+            std::lock_guard lock(m_Mutex);
+            drain(true);
+            write_footer();
+            m_OutputStream.close();
+        }
     }
 
-    void write_profile(const ProfileResult& result) {
-        std::stringstream json;
+    /// Returns a stable id for the name, only taking a lock the first time a thread sees it
+    uint32_t intern(std::string_view name) {
+        thread_local std::unordered_map<std::string_view, uint32_t> t_Cache;
+        if (auto it = t_Cache.find(name); it != t_Cache.end()) {
+            return it->second;
+        }
 
-        std::string name = result.Name;
-        std::replace(name.begin(), name.end(), '"', '\'');
+        std::lock_guard lock(m_NameMutex);
+        auto it = m_NameIds.find(name);
+        if (it == m_NameIds.end()) {
+            auto& stored = m_Names.emplace_back(name);
+            std::replace(stored.begin(), stored.end(), '"', '\'');
+            it = m_NameIds.emplace(std::string_view(m_Names.back()), m_Names.size() - 1).first;
+        }
 
-        json << std::setprecision(3) << std::fixed;
-        json << ",{";
-        json << "\"cat\":\"function\",";
-        json << "\"dur\":" << (result.ElapsedTime.count()) << ',';
-        json << "\"name\":\"" << name << "\",";
-        json << "\"ph\":\"X\",";
-        json << "\"pid\":0,";
-        json << "\"tid\":" << result.ThreadID << ",";
-        json << "\"ts\":" << result.Start.count();
-        json << "}";
+        t_Cache.emplace(it->first, it->second);
+        return it->second;
+    }
 
-        std::lock_guard lock(m_Mutex);
-        if (m_CurrentSession) {
-            m_OutputStream << json.str();
-            m_OutputStream.flush();
+    void record(const ProfileEvent& event) {
+        if (m_Active.load(std::memory_order_relaxed)) {
+            thread_ring().push(event);
         }
     }
 
@@ -590,14 +717,16 @@ class Instrumentor {
 
 class InstrumentationTimer {
   private:
-    const char* m_Name;
-    std::chrono::time_point<std::chrono::steady_clock> m_StartTimepoint;
+    uint32_t m_NameId;
+    uint64_t m_Start;
     bool m_Stopped;
 
   public:
-    InstrumentationTimer(const char* name) : m_Name(name), m_Stopped(false) {
-        m_StartTimepoint = std::chrono::steady_clock::now();
-    }
+    explicit InstrumentationTimer(uint32_t name_id)
+        : m_NameId(name_id), m_Start(Instrumentor::now()), m_Stopped(false) {}
+
+    explicit InstrumentationTimer(std::string_view name)
+        : InstrumentationTimer(Instrumentor::get().intern(name)) {}
 
     ~InstrumentationTimer() {
         if (!m_Stopped) {
@@ -606,17 +735,7 @@ class InstrumentationTimer {
     }
 
     void stop() {
-        auto end_timepoint = std::chrono::steady_clock::now();
-        auto high_res_start = FloatingPointMicroseconds{m_StartTimepoint.time_since_epoch()};
-        auto elapsed_time =
-            std::chrono::time_point_cast<std::chrono::microseconds>(end_timepoint)
-                .time_since_epoch() -
-            std::chrono::time_point_cast<std::chrono::microseconds>(m_StartTimepoint)
-                .time_since_epoch();
-
-        Instrumentor::get().write_profile(
-            {m_Name, high_res_start, elapsed_time, std::this_thread::get_id()});
-
+        Instrumentor::get().record({m_Start, Instrumentor::now(), m_NameId});
         m_Stopped = true;
     }
 };
@@ -630,7 +749,11 @@ class InstrumentationTimer {
 #define PROFILE_BEGIN_SESSION(name, filepath) ::Instrumentor::get().begin_session(name, filepath)
 #define PROFILE_END_SESSION() ::Instrumentor::get().end_session()
 #define PROFILE_SCOPE(name) ::InstrumentationTimer CONCAT(timer, __LINE__)(name)
-#define PROFILE_FUNCTION() PROFILE_SCOPE(__PRETTY_FUNCTION__)
+// Function names are interned once per call site instead of on every call
+#define PROFILE_FUNCTION()                                                                         \
+    static const uint32_t CONCAT(profile_name, __LINE__) =                                         \
+        ::Instrumentor::get().intern(__PRETTY_FUNCTION__);                                         \
+    ::InstrumentationTimer CONCAT(timer, __LINE__)(CONCAT(profile_name, __LINE__))
 #else
 #define PROFILE_BEGIN_SESSION(name, filepath)
 #define PROFILE_END_SESSION()
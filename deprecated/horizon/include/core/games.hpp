@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core/mmap.hpp"
+
+// ================ GAME OFFSETS FORMAT ================
+//
+// The sidecar of a pgn file, named after it with .idx appended. Every field is little-endian. A
+// 40 byte header:
+//     magic    8 bytes  "HZGAMES\0"
+//     version  u32      GAME_OFFSETS_VERSION
+//     reserved u32
+//     size     u64      the size of the pgn file when it was scanned
+//     modified i64      its last write time in file clock ticks
+//     count    u64      the number of games
+// is followed by the u64 byte offset and u64 header digest of every game, in file order.
+
+constexpr std::array<char, 8> GAME_OFFSETS_MAGIC = {'H', 'Z', 'G', 'A', 'M', 'E', 'S', '\0'};
+constexpr uint32_t GAME_OFFSETS_VERSION = 1;
+constexpr size_t GAME_OFFSETS_HEADER_BYTES = 40;
+
+struct GameEntry {
+    uint64_t Offset;
+    // FNV-1a of the game's tag section, skipping carriage returns
+    uint64_t HeaderDigest;
+};
+
+/// Returns the offset of every game starting within [begin, end) of the text, using the same rule
+/// as next_game_offset. The text is searched a vector of bytes at a time for a newline followed by
+/// a tag, which is rare enough that the few candidates are confirmed one by one. The start of the
+/// text always counts as a game.
+std::vector<uint64_t> find_game_offsets(std::string_view text, size_t begin, size_t end);
+
+/// Returns the text of the game starting at the offset, up to the next game
+std::string_view game_text(std::string_view text, uint64_t offset);
+
+uint64_t header_digest(std::string_view text, uint64_t offset);
+
+/// Finds and digests every game of a pgn text, splitting the scan between threads
+std::vector<GameEntry> scan_games(std::string_view text, uint64_t threads);
+
+std::filesystem::path game_offsets_path(const std::filesystem::path& pgn);
+
+/// Reads the sidecar of a pgn file, failing when it is missing, corrupt or older than the file.
+/// The text is the mapped pgn, used to check the digests of the first and last games.
+Result<std::vector<GameEntry>, std::string> load_game_offsets(const std::filesystem::path& pgn,
+                                                              std::string_view text);
+
+bool save_game_offsets(const std::filesystem::path& pgn, const std::vector<GameEntry>& games);
+
+/// Feeds chosen games of a pgn text to the stream parser one at a time, so their offsets stay
+/// known without scanning the rest. The parser reads a stream to its end and is left ready for
+/// the next one, so the same parser and its buffer serve every game.
+class GameParser {
+  private:
+    std::istream m_Stream;
+    Scope<pgn::StreamParser<>> m_Parser;
+
+  public:
+    GameParser();
+
+    /// Parses the text of one game, or of a range of consecutive games
+    pgn::StreamParserError parse(std::string_view text, pgn::Visitor& visitor);
+};
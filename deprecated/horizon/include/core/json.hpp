@@ -0,0 +1,134 @@
+#pragma once
+
+/// A minimal streaming JSON writer, values are emitted in the order they are added
+class JsonWriter {
+  private:
+    std::ostringstream m_Out;
+    // One entry per open object or array, true until its first member has been written
+    std::vector<bool> m_First;
+    bool m_AfterKey;
+
+  private:
+    void separate() {
+        if (m_AfterKey) {
+            m_AfterKey = false;
+            return;
+        }
+
+        if (!m_First.empty()) {
+            if (!m_First.back()) {
+                m_Out << ',';
+            }
+            m_First.back() = false;
+            newline();
+        }
+    }
+
+    void newline() { m_Out << '\n' << std::string(m_First.size() * 2, ' '); }
+
+    void open(char bracket) {
+        separate();
+        m_Out << bracket;
+        m_First.push_back(true);
+    }
+
+    void close(char bracket) {
+        assert(!m_First.empty());
+        bool empty = m_First.back();
+        m_First.pop_back();
+        if (!empty) {
+            newline();
+        }
+        m_Out << bracket;
+    }
+
+    void write_string(std::string_view s) {
+        m_Out << '"';
+        for (char c : s) {
+            switch (c) {
+            case '"':
+                m_Out << "\\\"";
+                break;
+            case '\\':
+                m_Out << "\\\\";
+                break;
+            case '\n':
+                m_Out << "\\n";
+                break;
+            case '\t':
+                m_Out << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    constexpr std::string_view hex = "0123456789abcdef";
+                    m_Out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+                } else {
+                    m_Out << c;
+                }
+            }
+        }
+        m_Out << '"';
+    }
+
+  public:
+    JsonWriter() : m_AfterKey(false) { m_Out << std::setprecision(6); }
+
+    JsonWriter& begin_object() {
+        open('{');
+        return *this;
+    }
+
+    JsonWriter& end_object() {
+        close('}');
+        return *this;
+    }
+
+    JsonWriter& begin_array() {
+        open('[');
+        return *this;
+    }
+
+    JsonWriter& end_array() {
+        close(']');
+        return *this;
+    }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        write_string(name);
+        m_Out << ": ";
+        m_AfterKey = true;
+        return *this;
+    }
+
+    template <typename T> JsonWriter& value(const T& v) {
+        separate();
+        if constexpr (std::is_same_v<T, bool>) {
+            m_Out << (v ? "true" : "false");
+        } else if constexpr (std::is_floating_point_v<T>) {
+            // JSON has no representation for nan or infinity
+            if (std::isfinite(v)) {
+                m_Out << v;
+            } else {
+                m_Out << "null";
+            }
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            m_Out << +v;
+        } else {
+            write_string(std::string_view(v));
+        }
+        return *this;
+    }
+
+    template <typename T> JsonWriter& field(std::string_view name, const T& v) {
+        return key(name).value(v);
+    }
+
+    std::string str() const { return m_Out.str(); }
+
+    bool save(const std::filesystem::path& path) const {
+        std::ofstream out(path);
+        out << m_Out.str() << '\n';
+        return out.good();
+    }
+};
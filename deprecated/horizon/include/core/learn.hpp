@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/book.hpp"
+
+enum class GameOutcome : int8_t {
+    Loss = -1,
+    Draw = 0,
+    Win = 1,
+};
+
+/// A game result for one book move, seen from the side that played it
+struct LearnUpdate {
+    uint64_t Key;
+    uint16_t Move;
+    GameOutcome Outcome;
+    int16_t WeightDelta = 0;
+};
+
+/// Updates the weight and learn fields of a key-sorted book in place through a writable mapping.
+/// The learn field holds a signed net score (wins minus losses) saturating at the int16 bounds,
+/// which merge sums per move. Every field update is a 16-bit compare-and-swap, so concurrent
+/// learners never lose updates and readers mapping the same file observe either the old or the new
+/// value, never a torn one.
+///
+/// The mapping follows the file, not the path. A rebuilt book published by rename over the same
+/// path leaves an open learner writing to the replaced file, so open a new learner after each
+/// Book::reload and merge the old book into the rebuild to keep what it learned.
+class BookLearner {
+  private:
+    Ref<MappedFile> m_File;
+    size_t m_NumEntries;
+
+  private:
+    explicit BookLearner(Ref<MappedFile> file);
+
+    /// Returns the offset of the first entry matching the key and move
+    Option<size_t> locate(uint64_t key, uint16_t move) const;
+
+    template <typename F> static uint16_t update_field(unsigned char* field, F&& transform) {
+        auto ref = polyglot::field_ref(field);
+        uint16_t stored = ref.load(std::memory_order_relaxed);
+        uint16_t desired;
+        do {
+            desired = polyglot::swap_be16(transform(polyglot::swap_be16(stored)));
+        } while (!ref.compare_exchange_weak(stored, desired, std::memory_order_relaxed));
+        return polyglot::swap_be16(desired);
+    }
+
+  public:
+    static Result<Ref<BookLearner>, std::string> open(const std::filesystem::path& path);
+
+    size_t size() const { return m_NumEntries; }
+
+    Option<PolyglotMove> find(uint64_t key, uint16_t move) const;
+
+    /// Adds the outcome to the learn score and the delta to the weight, returning false if the
+    /// move is not in the book
+    bool record(const LearnUpdate& update);
+
+    /// Records a batch of updates, returning how many of them were found in the book
+    size_t record(std::span<const LearnUpdate> updates);
+
+    bool set_weight(uint64_t key, uint16_t move, uint16_t weight);
+    bool set_learn(uint64_t key, uint16_t move, uint16_t learn);
+
+    /// Flushes the updated pages to disk, readers see updates before this through the page cache
+    bool sync() const { return m_File->sync(); }
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+/// A read-only stream buffer over memory owned elsewhere, letting stream based parsers read
+/// slices of a mapped file without copying them
+class MemoryBuf : public std::streambuf {
+  public:
+    explicit MemoryBuf(std::string_view data) {
+        // The get area is never written through, the const cast only satisfies the interface
+        auto* begin = const_cast<char*>(data.data());
+        setg(begin, begin, begin + data.size());
+    }
+
+  protected:
+    std::streamsize xsgetn(char* out, std::streamsize count) override {
+        auto available = std::min<std::streamsize>(count, egptr() - gptr());
+        if (available > 0) {
+            std::memcpy(out, gptr(), static_cast<size_t>(available));
+            setg(eback(), gptr() + available, egptr());
+        }
+        return available;
+    }
+};
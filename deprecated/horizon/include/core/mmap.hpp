@@ -0,0 +1,52 @@
+#pragma once
+
+/// A read-only or writable memory mapping of an entire file, unmapped on destruction
+class MappedFile {
+  public:
+    enum class Mode { ReadOnly, ReadWrite };
+
+  private:
+    unsigned char* m_Data;
+    size_t m_Size;
+    Mode m_Mode;
+    std::filesystem::path m_Path;
+
+#ifdef _WIN32
+    void* m_FileHandle;
+    void* m_MappingHandle;
+#else
+    int m_FileDescriptor;
+#endif
+
+  private:
+    MappedFile();
+
+    void release();
+
+  public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    ~MappedFile() { release(); }
+
+    static Result<Ref<MappedFile>, std::string> open(const std::filesystem::path& path,
+                                                     Mode mode = Mode::ReadOnly);
+
+    const unsigned char* data() const { return m_Data; }
+    unsigned char* mutable_data() { return m_Mode == Mode::ReadWrite ? m_Data : nullptr; }
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+    bool writable() const { return m_Mode == Mode::ReadWrite; }
+    const std::filesystem::path& path() const { return m_Path; }
+
+    /// Hints that the mapping will be read front to back
+    void advise_sequential() const;
+
+    /// Pre-faults the mapping so the first probes don't pay for page faults
+    void advise_willneed() const;
+
+    /// Flushes dirty pages of a writable mapping back to the file
+    bool sync() const;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+enum class PackedKernel {
+    // Picks pdep/pext when the cpu has fast bmi2, the portable kernel otherwise
+    Auto,
+    Portable,
+    Bmi2,
+};
+
+/// A PackedBoard spread back out into bitboards, which is what feature extraction consumes
+struct UnpackedBoard {
+    // Indexed by Piece, WHITEPAWN through BLACKKING
+    std::array<Bitboard, 12> Pieces;
+    Bitboard Occupancy;
+    // The rooks still carrying castling rights, of either color
+    Bitboard CastlingRooks;
+    Square EnPassant;
+    Color SideToMove;
+};
+
+/// Returns the kernel Auto resolves to on this machine
+PackedKernel resolve_packed_kernel(PackedKernel kernel);
+
+/// Packs every board, producing exactly what Board::Compact::encode does one board at a time
+void encode_packed(std::span<const Board> boards, std::span<PackedBoard> out,
+                   PackedKernel kernel = PackedKernel::Auto);
+
+/// Unpacks every PackedBoard into bitboards, agreeing with Board::Compact::decode on the pieces,
+/// side to move, en passant square and castling rooks
+void decode_packed(std::span<const PackedBoard> packed, std::span<UnpackedBoard> out,
+                   PackedKernel kernel = PackedKernel::Auto);
@@ -0,0 +1,156 @@
+#pragma once
+
+// Horizon books are flat arrays of big-endian 14-byte entries (key, move, weight, learn)
+#pragma pack(push, 1)
+struct PolyEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint16_t learn;
+};
+#pragma pack(pop)
+
+constexpr size_t POLY_ENTRY_SIZE = 14;
+static_assert(sizeof(PolyEntry) == POLY_ENTRY_SIZE);
+
+constexpr size_t POLY_MOVE_OFFSET = 8;
+constexpr size_t POLY_WEIGHT_OFFSET = 10;
+constexpr size_t POLY_LEARN_OFFSET = 12;
+
+namespace polyglot {
+
+inline uint64_t load_be64(const unsigned char* ptr) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v = (v << 8) | ptr[i];
+    }
+    return v;
+}
+
+inline uint16_t load_be16(const unsigned char* ptr) {
+    return static_cast<uint16_t>((ptr[0] << 8) | ptr[1]);
+}
+
+inline void store_be64(unsigned char* ptr, uint64_t v) {
+    for (int i = 7; i >= 0; --i) {
+        ptr[7 - i] = static_cast<unsigned char>((v >> (i * 8)) & 0xFF);
+    }
+}
+
+inline void store_be16(unsigned char* ptr, uint16_t v) {
+    ptr[0] = static_cast<unsigned char>(v >> 8);
+    ptr[1] = static_cast<unsigned char>(v & 0xFF);
+}
+
+inline uint64_t key_at(const unsigned char* data, size_t idx) {
+    return load_be64(data + idx * POLY_ENTRY_SIZE);
+}
+
+/// Converts between host order and the big-endian order of a stored 16-bit field
+inline uint16_t swap_be16(uint16_t v) {
+    if constexpr (std::endian::native == std::endian::little) {
+        return static_cast<uint16_t>((v << 8) | (v >> 8));
+    } else {
+        return v;
+    }
+}
+
+/// Views a 16-bit field of a shared mapping so that concurrent writers can't tear it
+inline std::atomic_ref<uint16_t> field_ref(const unsigned char* ptr) {
+    auto* field = reinterpret_cast<uint16_t*>(const_cast<unsigned char*>(ptr));
+    assert(reinterpret_cast<uintptr_t>(field) % std::atomic_ref<uint16_t>::required_alignment == 0);
+    return std::atomic_ref<uint16_t>(*field);
+}
+
+inline uint16_t load_shared_be16(const unsigned char* ptr) {
+    return swap_be16(field_ref(ptr).load(std::memory_order_relaxed));
+}
+
+/// Returns the first index in [from, n) whose key is not less than the key, for any key-sorted
+/// sequence read through key_at
+template <typename KeyAt>
+size_t lower_bound_by(size_t from, size_t n, uint64_t key, KeyAt&& key_at) {
+    size_t lo = from;
+    size_t len = n - from;
+    while (len > 0) {
+        size_t half = len / 2;
+        if (key_at(lo + half) < key) {
+            lo += half + 1;
+            len -= half + 1;
+        } else {
+            len = half;
+        }
+    }
+    return lo;
+}
+
+/// Returns the [first, last) range matching the key. Builder output repeats a position once per
+/// game reaching it, so the end of the run is galloped to rather than walked.
+template <typename KeyAt>
+std::pair<size_t, size_t> equal_range_by(size_t n, uint64_t key, KeyAt&& key_at) {
+    size_t first = lower_bound_by(0, n, key, key_at);
+    if (first == n || key_at(first) != key) {
+        return {first, first};
+    }
+
+    size_t matched = first;
+    size_t step = 1;
+    size_t probe = first + 1;
+    while (probe < n && key_at(probe) == key) {
+        matched = probe;
+        step *= 2;
+        probe = first + step;
+    }
+
+    // The run ends somewhere in (matched, probe]
+    size_t lo = matched + 1;
+    size_t hi = std::min(probe, n);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key_at(mid) == key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return {first, lo};
+}
+
+/// Returns the [first, last) range of entries matching the key in a key-sorted book
+inline std::pair<size_t, size_t> equal_range(const unsigned char* data, size_t n, uint64_t key) {
+    return equal_range_by(n, key, [data](size_t idx) { return key_at(data, idx); });
+}
+
+inline PolyEntry decode(const unsigned char* ptr) {
+    return {load_be64(ptr), load_be16(ptr + POLY_MOVE_OFFSET), load_be16(ptr + POLY_WEIGHT_OFFSET),
+            load_be16(ptr + POLY_LEARN_OFFSET)};
+}
+
+/// Decodes an entry of a mapping that may be updated in place while it is being read
+inline PolyEntry decode_shared(const unsigned char* ptr) {
+    return {load_be64(ptr), load_be16(ptr + POLY_MOVE_OFFSET),
+            load_shared_be16(ptr + POLY_WEIGHT_OFFSET), load_shared_be16(ptr + POLY_LEARN_OFFSET)};
+}
+
+inline void encode(unsigned char* ptr, const PolyEntry& e) {
+    store_be64(ptr, e.key);
+    store_be16(ptr + POLY_MOVE_OFFSET, e.move);
+    store_be16(ptr + POLY_WEIGHT_OFFSET, e.weight);
+    store_be16(ptr + POLY_LEARN_OFFSET, e.learn);
+}
+
+/// Books are written beside their target and renamed over it once complete, so a process still
+/// mapping the old file keeps reading it whole instead of watching it get truncated
+inline std::filesystem::path staging_path(const std::filesystem::path& path) {
+    auto staged = path;
+    staged += ".tmp";
+    return staged;
+}
+
+inline bool publish(const std::filesystem::path& staged, const std::filesystem::path& path) {
+    std::error_code ec;
+    std::filesystem::rename(staged, path, ec);
+    return !ec;
+}
+
+} // namespace polyglot
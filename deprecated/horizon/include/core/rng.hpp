@@ -0,0 +1,25 @@
+#pragma once
+
+/// splitmix64, cheap enough to seed per game and fully specified so the output never depends on
+/// the standard library's engines or distributions
+class SplitMixRng {
+  private:
+    uint64_t m_State;
+
+  public:
+    explicit constexpr SplitMixRng(uint64_t seed) : m_State(seed) {}
+
+    constexpr uint64_t next() {
+        uint64_t z = (m_State += 0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+
+    /// Returns a double in [0, 1) built from the top 53 bits
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    uint64_t below(uint64_t bound) { return bound <= 1 ? 0 : next() % bound; }
+
+    bool chance(double probability) { return uniform() < probability; }
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+/// Returns the offset just past the next newline at or after from, or the end of the text
+size_t next_line_offset(std::string_view text, size_t from);
+
+/// Returns the offset of the first game starting at or after from, or the end of the text. A game
+/// starts with a tag at the beginning of a line following a blank line.
+size_t next_game_offset(std::string_view text, size_t from);
+
+/// Cuts the text into slices of roughly the target size, moving every cut forward to the next
+/// record boundary so each slice can be parsed on its own
+std::vector<std::string_view> split_records(std::string_view text, size_t target_bytes,
+                                            size_t (*next_record)(std::string_view, size_t));
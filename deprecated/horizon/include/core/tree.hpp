@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/book.hpp"
+
+struct OpeningNode {
+    uint64_t Key;
+    uint32_t Parent;
+    uint16_t Move;
+    uint16_t Ply;
+    // Weight of the move from the parent's entries, zero when the child was only reached by
+    // transposition
+    uint32_t Weight;
+};
+
+/// A book subtree in depth-first order, the root is always the first node
+struct OpeningTree {
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    std::vector<OpeningNode> Nodes;
+
+    size_t size() const { return Nodes.size(); }
+};
+
+/// Computes the hash the board would have after the move by xoring the zobrist deltas of the
+/// pieces, castling rights and en passant file it touches, without making the move
+uint64_t child_key(const Board& board, Move move);
+
+/// Collects every position in the index reachable from the board within the given plies. Child
+/// positions are hashed incrementally and resolved together, so only positions that are in the
+/// book are ever made on the board. The board is restored before returning.
+OpeningTree expand_tree(const BookIndex& index, Board& board, int plies);
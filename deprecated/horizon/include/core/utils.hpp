@@ -3,6 +3,13 @@
 constexpr std::string_view STARTING_FEN =
     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+/// The start position, parsed once. Visitors copy it in at the start of every game instead of
+/// calling setFen, which reparses the fen and recomputes the hash each time.
+inline const Board& start_board() {
+    static const Board board(STARTING_FEN);
+    return board;
+}
+
 constexpr std::string_view FILES = "abcdefgh";
 constexpr std::string_view RANKS = "12345678";
 
@@ -5,5 +5,6 @@ constexpr uint64_t MAX_OPENING_DEPTH = 16;
 constexpr std::string_view DEFAULT_PGN_PARENT = "pgn";
 constexpr std::string_view DEFAULT_PGN_EXT = ".pgn";
 constexpr std::string_view DEFAULT_OUTPUT = "polyglot.bin";
+constexpr uint64_t DEFAULT_PROGRESS_SECONDS = 5;
 
 int launch(int argc, char* argv[]);
@@ -2,6 +2,7 @@
 #define WATER_PCH
 
 // I/O
+#include <charconv>
 #include <csignal>
 #include <cstring>
 #include <filesystem>
@@ -15,13 +16,16 @@
 // Utilities
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <bitset>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <climits>
 #include <concepts>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <numeric>
 #include <random>
@@ -34,6 +38,7 @@
 #include <array>
 #include <deque>
 #include <optional>
+#include <queue>
 #include <span>
 #include <unordered_map>
 #include <unordered_set>
@@ -55,7 +60,4 @@ using namespace chess;
 #include "core/core.hpp"
 #include "core/utils.hpp"
 
-#define INCBIN_SILENCE_BITCODE_WARNING
-#include "incbin/incbin.h"
-
 #endif // WATER_PCH
\ No newline at end of file
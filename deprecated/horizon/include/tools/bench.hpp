@@ -0,0 +1,22 @@
+#pragma once
+
+#include "launcher.hpp"
+#include "tools/corpus.hpp"
+
+struct BenchOptions {
+    uint64_t Games = 2000;
+    uint64_t Depth = DEFAULT_DEPTH;
+    uint64_t Seed = DEFAULT_CORPUS_SEED;
+    uint64_t Runs = 3;
+    uint64_t Probes = 200000;
+    uint64_t ColdProbes = 256;
+    uint64_t BatchSize = 256;
+    uint64_t PackedBoards = 200000;
+    uint64_t KeyPositions = 50000;
+    std::filesystem::path WorkDir;
+    bool Keep = false;
+};
+
+/// Builds a book from a synthetic corpus and measures build throughput along with the load time,
+/// memory and probe latencies of every book backend, writing the results as json
+int run_bench(const BenchOptions& options, const std::string& output_file);
@@ -0,0 +1,35 @@
+#pragma once
+
+struct ConvertOptions {
+    // The number of full moves to play before a game's position is written, zero writes the
+    // final position of every game
+    uint64_t Depth = 0;
+
+    // Duplicates are always reported, but only dropped from the output when set
+    bool Unique = false;
+
+    // Zero uses every hardware thread
+    uint64_t Threads = 0;
+};
+
+struct ConvertStats {
+    uint64_t Records = 0;
+    uint64_t Written = 0;
+    uint64_t Skipped = 0;
+
+    // The 1-based line (epd) or game (pgn) number of every repeated position, in input order
+    std::vector<uint64_t> Duplicates;
+};
+
+/// Wraps every fen of an epd suite in a headers-only pgn game, keeping the order intact. Positions
+/// are compared by zobrist key, so fens differing only in an unreachable en passant square or
+/// their move counters count as duplicates.
+Result<ConvertStats, std::string> epd_to_pgn(const std::filesystem::path& input,
+                                             const std::filesystem::path& output,
+                                             const ConvertOptions& options);
+
+/// Writes the position every game reaches after the configured depth as an epd line, in the
+/// order the games appear. Games ending before the depth or containing illegal moves are skipped.
+Result<ConvertStats, std::string> pgn_to_epd(const std::filesystem::path& input,
+                                             const std::filesystem::path& output,
+                                             const ConvertOptions& options);
@@ -0,0 +1,42 @@
+#pragma once
+
+// "HORIZON" in ascii
+constexpr uint64_t DEFAULT_CORPUS_SEED = 0x484F52495A4F4E;
+
+struct CorpusStats {
+    uint64_t Games = 0;
+    uint64_t Plies = 0;
+    uint64_t Bytes = 0;
+};
+
+struct CorpusOptions {
+    uint64_t Games = 10000;
+    // When set, games are generated until the corpus reaches this many bytes instead
+    uint64_t TargetBytes = 0;
+    uint64_t Seed = DEFAULT_CORPUS_SEED;
+
+    // Game lengths follow a triangular distribution with this range and mean
+    uint64_t MinPlies = 20;
+    uint64_t MeanPlies = 80;
+    uint64_t MaxPlies = 160;
+
+    // Chance for each move to carry a lichess style %clk or %eval comment
+    double ClockDensity = 0.0;
+    double EvalDensity = 0.0;
+
+    // The seven tag roster comes first, any further headers are filled with common extras
+    uint64_t Headers = 7;
+
+    // Opening moves are picked with zipf-distributed ranks, zero is uniform and larger values
+    // concentrate games into fewer lines
+    double OpeningSkew = 1.0;
+    uint64_t OpeningPlies = 12;
+
+    // Zero uses every hardware thread
+    uint64_t Threads = 0;
+};
+
+/// Writes a pgn file of random legal games. Every game is derived from the seed and its index
+/// alone, so the output is identical for any thread count, platform or standard library.
+Result<CorpusStats, std::string> write_synthetic_corpus(const std::filesystem::path& path,
+                                                        const CorpusOptions& options);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "launcher.hpp"
+
+// ================ TRAINING DATA FORMAT ================
+//
+// Every field is little-endian. A file starts with a 16 byte header:
+//     magic   8 bytes  "HZTRAIN\0"
+//     version u32      TRAINING_VERSION
+//     record  u32      sizeof(TrainingRecord)
+// followed by any number of chunks, each an 8 byte header and its records:
+//     magic   u32      TRAINING_CHUNK_MAGIC
+//     count   u32      the number of records in the chunk
+// Chunks come from different threads, so their order varies between runs.
+
+constexpr std::array<char, 8> TRAINING_MAGIC = {'H', 'Z', 'T', 'R', 'A', 'I', 'N', '\0'};
+constexpr uint32_t TRAINING_VERSION = 1;
+// "HZCK" read as a little-endian integer
+constexpr uint32_t TRAINING_CHUNK_MAGIC = 0x4B435A48;
+constexpr uint32_t TRAINING_CHUNK_RECORDS = 1 << 16;
+
+constexpr int16_t TRAINING_NO_EVAL = INT16_MIN;
+// Mate in n is stored as TRAINING_MATE - n from white's point of view, and negated for black
+constexpr int16_t TRAINING_MATE = 32000;
+constexpr int16_t TRAINING_EVAL_LIMIT = 30000;
+
+namespace TrainingFlags {
+constexpr uint8_t InCheck = 1 << 0;
+constexpr uint8_t Capture = 1 << 1;
+constexpr uint8_t HasEval = 1 << 2;
+} // namespace TrainingFlags
+
+/// One position as it is stored on disk
+struct TrainingRecord {
+    // Board::Compact::encode of the position after the move
+    PackedBoard Board;
+    // Centipawns from white's point of view, parsed from the move's %eval comment
+    int16_t Eval;
+    // The game ply from the move counters, so positions from a FEN header keep their own
+    uint16_t Ply;
+    // 1, 0 or -1 for a white win, draw or black win
+    int8_t Result;
+    uint8_t Flags;
+    uint16_t Reserved;
+};
+
+static_assert(sizeof(TrainingRecord) == 32);
+
+struct ExtractOptions {
+    // Positions reached before this ply are not written
+    uint64_t MinPly = 0;
+    // Drops positions where the side to move is in check or the last move was a capture
+    bool Quiet = false;
+    // Drops positions whose move carried no %eval comment
+    bool RequireEval = false;
+
+    uint64_t ProgressSeconds = DEFAULT_PROGRESS_SECONDS;
+    std::filesystem::path StatsFile;
+
+    // Zero uses every hardware thread
+    uint64_t Threads = 0;
+};
+
+struct ExtractStats {
+    uint64_t Games = 0;
+    // Games without a decisive or drawn result, which carry no training signal
+    uint64_t SkippedGames = 0;
+    uint64_t Positions = 0;
+    uint64_t Written = 0;
+    double Seconds = 0.0;
+};
+
+/// Replays every game of the pgn files and writes the positions passing the filters as training
+/// records, in chunks flushed independently by each thread
+Result<ExtractStats, std::string> extract_training_data(
+    const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output,
+    const ExtractOptions& options);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "core/mmap.hpp"
+
+// ================ POSITION INDEX FORMAT ================
+//
+// Every field is little-endian. A 72 byte header is followed by the posting lists, the key table,
+// the game table and the file table, at the offsets it records:
+//     magic    8 bytes  "HZINDEX\0"
+//     version  u32      POSITION_INDEX_VERSION
+//     depth    u32      full moves indexed per game, 0 when whole games are
+//     postings u64      offset of the posting lists
+//     keys     u64 x2   offset and count of the key table
+//     games    u64 x2   offset and count of the game table
+//     files    u64 x2   offset and count of the file table
+// A posting list holds the ascending ids of the games reaching a position as varint deltas, and
+// ends where the next key's list starts. Key table entries are a zobrist key and the u64 offset of
+// its list, sorted by key. Game table entries hold the game's file in the top 16 bits and its byte
+// offset in that file below. File table entries are the u64 number of bytes indexed, the u64
+// length of the path and the path itself.
+
+constexpr std::array<char, 8> POSITION_INDEX_MAGIC = {'H', 'Z', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr uint32_t POSITION_INDEX_VERSION = 1;
+constexpr size_t POSITION_INDEX_HEADER_BYTES = 72;
+constexpr size_t POSITION_INDEX_KEY_BYTES = 16;
+constexpr uint64_t POSITION_INDEX_OFFSET_BITS = 48;
+
+struct IndexOptions {
+    // Full moves of every game to index, zero indexes whole games
+    uint64_t Depth = 0;
+    // Adds new files, and games appended to indexed files, to an existing index
+    bool Append = false;
+    // Pgn bytes parsed in memory before their positions are sorted and spilled to disk
+    uint64_t BatchBytes = 256 * 1024 * 1024;
+    // Zero uses every hardware thread
+    uint64_t Threads = 0;
+};
+
+struct IndexBuildStats {
+    uint64_t Files = 0;
+    uint64_t NewBytes = 0;
+    uint64_t NewGames = 0;
+    uint64_t Games = 0;
+    uint64_t Keys = 0;
+    uint64_t IndexBytes = 0;
+    double Seconds = 0.0;
+};
+
+/// Indexes the positions of every game in the pgn files, so the games reaching a position can be
+/// looked up without scanning them again
+Result<IndexBuildStats, std::string> build_position_index(
+    const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output,
+    const IndexOptions& options);
+
+struct IndexedGame {
+    std::filesystem::path File;
+    uint64_t Offset;
+};
+
+/// A memory mapped position index. Lookups binary search the key table and decode one posting
+/// list, so they touch a handful of pages no matter how large the indexed corpus is.
+class PositionIndex {
+  private:
+    Ref<MappedFile> m_File;
+    uint32_t m_Depth;
+    uint64_t m_PostingsOffset;
+    uint64_t m_KeysOffset;
+    uint64_t m_KeyCount;
+    uint64_t m_GamesOffset;
+    uint64_t m_GameCount;
+    std::vector<std::filesystem::path> m_Paths;
+    std::vector<uint64_t> m_IndexedBytes;
+
+  private:
+    PositionIndex() = default;
+
+  public:
+    static Result<Ref<PositionIndex>, std::string> open(const std::filesystem::path& path);
+
+    uint32_t depth() const { return m_Depth; }
+    uint64_t key_count() const { return m_KeyCount; }
+    uint64_t game_count() const { return m_GameCount; }
+    uint64_t file_count() const { return m_Paths.size(); }
+    const std::filesystem::path& file_path(size_t file) const { return m_Paths[file]; }
+    uint64_t indexed_bytes(size_t file) const { return m_IndexedBytes[file]; }
+
+    /// Returns the ids of every game reaching the position, in ascending order
+    std::vector<uint64_t> games(uint64_t key) const;
+
+    /// The key and ascending game ids stored in a slot of the key table, below key_count
+    uint64_t key_at(uint64_t slot) const;
+    std::vector<uint64_t> games_at(uint64_t slot) const;
+
+    /// The game table entry of a game, its file index above POSITION_INDEX_OFFSET_BITS
+    uint64_t game_entry(uint64_t id) const;
+    IndexedGame game(uint64_t id) const;
+};
+
+struct QueryOptions {
+    std::filesystem::path Index;
+    // The position to look up, the start position when empty
+    std::string Fen;
+    // San moves played from the fen before looking up, move numbers are ignored
+    std::string Moves;
+    // The most games to print, zero prints every one
+    uint64_t Limit = 20;
+    // Prints the text of every game instead of where it is
+    bool PrintGames = false;
+};
+
+/// Looks up a position in an index and prints the games reaching it
+int query_position_index(const QueryOptions& options);
@@ -0,0 +1,15 @@
+#pragma once
+
+struct MergeInput {
+    std::filesystem::path Path;
+    float WeightScale = 1.0f;
+};
+
+struct MergeOptions {
+    uint64_t MinWeight = 1;
+    uint64_t TopK = 0;
+};
+
+/// Merges key-sorted books into a single sorted book, aggregating the weights of shared moves
+int merge_books(const std::vector<MergeInput>& inputs, const MergeOptions& options,
+                const std::string& output_file);
@@ -0,0 +1,29 @@
+#pragma once
+
+struct SampleOptions {
+    uint64_t Count = 1000;
+    uint64_t Seed = 1;
+    // Only draws games whose moves all replay legally, parsing nothing but the drawn games
+    bool Legal = false;
+    // Scans the pgn again even when its .idx sidecar is up to date
+    bool Rescan = false;
+    // Zero uses every hardware thread
+    uint64_t Threads = 0;
+};
+
+struct SampleStats {
+    uint64_t Games = 0;
+    uint64_t Sampled = 0;
+    // Drawn games dropped for an illegal move or an invalid FEN
+    uint64_t Rejected = 0;
+    // Whether the game offsets were scanned rather than read from the sidecar
+    bool Scanned = false;
+    double ScanSeconds = 0.0;
+};
+
+/// Writes a seeded random sample of the games of a pgn file, in file order. Game offsets come
+/// from the file's .idx sidecar, which is written whenever it is missing or stale, so repeated
+/// samples of the same file never scan it again.
+Result<SampleStats, std::string> sample_games(const std::filesystem::path& input,
+                                              const std::filesystem::path& output,
+                                              const SampleOptions& options);
@@ -1,86 +1,256 @@
 #include <pch.hpp>
 
 #include "core/book.hpp"
+#include "core/tree.hpp"
 
-#ifdef EXAMPLE
+// ================ MAPPED BOOK ================
 
-INCBIN(BOOK, "test.poly");
+MappedBook::MappedBook(Ref<MappedFile> file, const BookSource& source)
+    : m_File(std::move(file)), m_Source(source), m_NumEntries(m_File->size() / POLY_ENTRY_SIZE),
+      m_Sorted(true) {}
 
-Book::Book() : m_UniformRealDist(0.0f, 1.0f), m_Rng(std::random_device{}()) {
-    auto gm_moves = load_polyglot(reinterpret_cast<const unsigned char*>(gBOOKData), gBOOKSize);
-    m_PolyglotMoves.merge(normalize_polyglot(gm_moves));
-}
+Result<Ref<MappedBook>, std::string> MappedBook::open(const BookSource& source) {
+    using Res = Result<Ref<MappedBook>, std::string>;
+    PROFILE_FUNCTION();
+
+    auto mapped = MappedFile::open(source.Path);
+    if (mapped.is_err()) {
+        return Res::Err(mapped.unwrap_err());
+    }
+
+    auto file = mapped.unwrap();
+    if (file->size() % POLY_ENTRY_SIZE != 0) {
+        return Res::Err(fmt::interpolate("{} is not a multiple of {} bytes", source.Path.string(),
+                                         POLY_ENTRY_SIZE));
+    }
 
-std::unordered_map<uint64_t, std::vector<PolyglotMove>>
-Book::load_polyglot(const unsigned char* data, size_t size) {
-    std::unordered_map<uint64_t, std::vector<PolyglotMove>> book_map;
-    size_t n = size / 14;
+    Ref<MappedBook> book(new MappedBook(file, source));
+    const auto* data = file->data();
+    size_t n = book->m_NumEntries;
 
-    for (size_t i = 0; i < n; ++i) {
-        const unsigned char* ptr = data + i * 14;
+    auto move_at = [&](size_t idx) {
+        return polyglot::load_be16(data + idx * POLY_ENTRY_SIZE + POLY_MOVE_OFFSET);
+    };
 
-        uint64_t key = 0;
-        for (int j = 0; j < 8; ++j) {
-            key = (key << 8) | ptr[j];
+    // A position rarely has more than a few dozen moves, so the moves seen under the current key
+    // are a short list even when the key repeats once per game
+    bool repeats = false;
+    std::vector<uint16_t> key_moves;
+    for (size_t i = 0; i < n && book->m_Sorted; ++i) {
+        if (i > 0 && polyglot::key_at(data, i - 1) != polyglot::key_at(data, i)) {
+            book->m_Sorted = polyglot::key_at(data, i - 1) < polyglot::key_at(data, i);
+            key_moves.clear();
         }
+        if (!repeats) {
+            repeats = std::find(key_moves.begin(), key_moves.end(), move_at(i)) != key_moves.end();
+            key_moves.push_back(move_at(i));
+        }
+    }
 
-        uint16_t move = (ptr[8] << 8) | ptr[9];
-        uint16_t weight = (ptr[10] << 8) | ptr[11];
-        uint16_t learn = (ptr[12] << 8) | ptr[13];
+    if (!book->m_Sorted && n > UINT32_MAX) {
+        return Res::Err(fmt::interpolate("{} is too large to index unsorted, sort it first",
+                                         source.Path.string()));
+    }
+
+    // Books written by the builder hold an entry per game, in game order unless sorted since, so
+    // give them a key ordering and fold the repeats of a move into one weighted run
+    if (!book->m_Sorted || (repeats && n <= UINT32_MAX)) {
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            uint64_t key_a = polyglot::key_at(data, a);
+            uint64_t key_b = polyglot::key_at(data, b);
+            return key_a != key_b ? key_a < key_b : move_at(a) < move_at(b);
+        });
+
+        for (uint32_t idx : order) {
+            uint32_t weight =
+                polyglot::load_be16(data + idx * POLY_ENTRY_SIZE + POLY_WEIGHT_OFFSET);
+            if (!book->m_SortedOrder.empty()) {
+                uint32_t head = book->m_SortedOrder.back();
+                if (polyglot::key_at(data, head) == polyglot::key_at(data, idx) &&
+                    move_at(head) == move_at(idx)) {
+                    book->m_RunWeights.back() += weight;
+                    continue;
+                }
+            }
+            book->m_SortedOrder.push_back(idx);
+            book->m_RunWeights.push_back(weight);
+        }
 
-        book_map[key].push_back({move, weight, learn});
+        book->m_SortedOrder.shrink_to_fit();
+        book->m_RunWeights.shrink_to_fit();
+        book->m_NumEntries = book->m_SortedOrder.size();
     }
 
-    return book_map;
+    file->advise_willneed();
+    return Res(book);
+}
+
+bool MappedBook::contains(uint64_t key) const {
+    size_t first =
+        polyglot::lower_bound_by(0, m_NumEntries, key, [this](size_t idx) { return key_at(idx); });
+    return first < m_NumEntries && key_at(first) == key;
+}
+
+std::pair<size_t, size_t> MappedBook::equal_range(uint64_t key) const {
+    if (!folded()) {
+        return polyglot::equal_range(m_File->data(), m_NumEntries, key);
+    }
+    return polyglot::equal_range_by(m_NumEntries, key, [this](size_t idx) { return key_at(idx); });
 }
 
-std::unordered_map<uint64_t, std::vector<BookMove>> Book::normalize_polyglot(
-    const std::unordered_map<uint64_t, std::vector<PolyglotMove>>& polyglot_moves) {
-    std::unordered_map<uint64_t, std::vector<BookMove>> converted;
+size_t MappedBook::gallop(uint64_t key, size_t from) const {
+    size_t lo = from;
+    size_t step = 1;
+    size_t hi = from;
+    while (hi < m_NumEntries && key_at(hi) < key) {
+        lo = hi + 1;
+        hi = from + step;
+        step *= 2;
+    }
+    hi = std::min(hi, m_NumEntries);
 
-    for (const auto& [k, v] : polyglot_moves) {
-        converted[k].reserve(v.size());
-        for (const auto& move : v) {
-            converted[k].push_back({uci::moveToUci(move.Compact), move.Weight});
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key_at(mid) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
 
-    return converted;
+    return lo;
 }
 
-bool Book::is_book_pos(Ref<Board> board) { return m_PolyglotMoves.contains(board->hash()); }
+// ================ BOOK INDEX ================
 
-Option<std::string> Book::try_get_book_move(Ref<Board> board, float weight) {
-    if (!is_book_pos(board)) {
-        return Option<std::string>();
-    }
+BookIndex::BookIndex(std::vector<Ref<const MappedBook>> books) : m_Books(std::move(books)) {
+    std::stable_sort(m_Books.begin(), m_Books.end(), [](const auto& a, const auto& b) {
+        return a->source().Priority > b->source().Priority;
+    });
+}
 
-    auto current_hash = board->hash();
-    auto weight_power = std::clamp(weight, 0.0f, 1.0f);
-    auto weighted_frequency = [&](int play_count) -> int {
-        return static_cast<int>(std::ceil(std::pow(play_count, weight_power)));
-    };
+bool BookIndex::contains(uint64_t key) const {
+    return std::any_of(m_Books.begin(), m_Books.end(),
+                       [&](const auto& book) { return book->contains(key); });
+}
+
+void BookIndex::contains_sorted(std::span<const uint64_t> keys, std::span<uint8_t> hits) const {
+    assert(keys.size() == hits.size());
+    std::fill(hits.begin(), hits.end(), 0);
+
+    for (const auto& book : m_Books) {
+        size_t cursor = 0;
+        for (size_t i = 0; i < keys.size() && cursor < book->size(); ++i) {
+            cursor = book->gallop(keys[i], cursor);
+            if (cursor < book->size() && book->key_at(cursor) == keys[i]) {
+                hits[i] = 1;
+            }
+        }
+    }
+}
 
-    // Extract relevant moves for the position
+std::vector<BookMove> BookIndex::probe(uint64_t key) const {
     std::vector<BookMove> moves;
-    if (m_PolyglotMoves.contains(current_hash)) {
-        auto relevant_moves = m_PolyglotMoves[current_hash];
-        moves.insert(moves.end(), relevant_moves.begin(), relevant_moves.end());
+
+    for (size_t i = 0; i < m_Books.size(); ++i) {
+        // Lower priorities are only consulted when no book at a higher priority knows the position
+        if (i > 0 && !moves.empty() &&
+            m_Books[i]->source().Priority != m_Books[i - 1]->source().Priority) {
+            break;
+        }
+
+        const auto& book = m_Books[i];
+        auto [first, last] = book->equal_range(key);
+        for (size_t idx = first; idx < last; ++idx) {
+            auto entry = book->entry_at(idx);
+            double scale = std::max(book->source().WeightScale, 0.0f);
+            auto scaled = static_cast<uint32_t>(std::lround(book->weight_at(idx) * scale));
+
+            auto existing = std::find_if(moves.begin(), moves.end(), [&](const BookMove& m) {
+                return m.Compact == entry.move;
+            });
+            if (existing != moves.end()) {
+                existing->Frequency += scaled;
+            } else {
+                moves.push_back({entry.move, scaled});
+            }
+        }
+    }
+
+    return moves;
+}
+
+// ================ BOOK ================
+
+Book::Book() : m_Index(CreateRef<const BookIndex>(std::vector<Ref<const MappedBook>>{})) {}
+
+float Book::rand_float() {
+    thread_local std::mt19937 rng(std::random_device{}());
+    thread_local std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    return dist(rng);
+}
+
+Result<void, std::string> Book::load(const std::vector<BookSource>& sources) {
+    PROFILE_FUNCTION();
+    std::vector<Ref<const MappedBook>> books;
+    books.reserve(sources.size());
+
+    for (const auto& source : sources) {
+        auto book = MappedBook::open(source);
+        if (book.is_err()) {
+            return Result<void, std::string>::Err(book.unwrap_err());
+        }
+        books.push_back(book.unwrap());
+    }
+
+    // Probes holding the previous snapshot keep its mappings alive until they finish
+    m_Index.store(CreateRef<const BookIndex>(std::move(books)), std::memory_order_release);
+    return Result<void, std::string>::Ok();
+}
+
+Result<void, std::string> Book::reload() {
+    std::vector<BookSource> sources;
+    for (const auto& book : snapshot()->books()) {
+        sources.push_back(book->source());
     }
 
-    // This should never be true, but is done for safety incase of breaking changes
+    return load(sources);
+}
+
+bool Book::is_book_pos(Ref<Board> board) { return snapshot()->contains(board->hash()); }
+
+OpeningTree Book::expand(Ref<Board> board, int plies) {
+    Board scratch = *board;
+    return expand_tree(*snapshot(), scratch, plies);
+}
+
+Option<std::string> Book::try_get_book_move(Ref<Board> board, float weight) {
+    auto moves = snapshot()->probe(board->hash());
     if (moves.empty()) {
         return Option<std::string>();
     }
 
+    auto weight_power = std::clamp(weight, 0.0f, 1.0f);
+    auto weighted_frequency = [&](uint32_t play_count) -> float {
+        return std::ceil(std::pow(static_cast<float>(play_count), weight_power));
+    };
+
     std::vector<float> weights;
     weights.reserve(moves.size());
-    float total_play_count =
-        std::accumulate(moves.begin(), moves.end(), 0.0f, [&](int sum, const BookMove& move) {
-            int frequency = weighted_frequency(move.Frequency);
-            weights.push_back(frequency);
-            return sum + frequency;
-        });
+    float total_play_count = 0.0f;
+    for (const auto& move : moves) {
+        float frequency = weighted_frequency(move.Frequency);
+        weights.push_back(frequency);
+        total_play_count += frequency;
+    }
+
+    // Every move was scaled down to nothing, so fall back to a uniform pick
+    if (total_play_count <= 0.0f) {
+        std::fill(weights.begin(), weights.end(), 1.0f);
+        total_play_count = static_cast<float>(weights.size());
+    }
 
     std::vector<float> prefix(weights.size());
     prefix[0] = weights[0] / total_play_count;
@@ -89,9 +259,7 @@ Option<std::string> Book::try_get_book_move(Ref<Board> board, float weight) {
     }
 
     auto it = std::lower_bound(prefix.begin(), prefix.end(), rand_float());
-    size_t idx = static_cast<int>(std::distance(prefix.begin(), it));
+    size_t idx = std::min(static_cast<size_t>(std::distance(prefix.begin(), it)), moves.size() - 1);
 
-    return Option<std::string>(moves[idx].MoveString);
+    return Option<std::string>(uci::moveToUci(Move(moves[idx].Compact)));
 }
-
-#endif
\ No newline at end of file
@@ -25,27 +25,58 @@ std::vector<std::filesystem::path> collect_pgns(std::string pgn_parent_directory
     return paths;
 }
 
-int make_book(int depth, const std::vector<std::filesystem::path>& files, std::string output_file) {
+int make_book(int depth, const std::vector<std::filesystem::path>& files, std::string output_file,
+              const BuildReport& report) {
     PROFILE_FUNCTION();
     if (files.empty()) {
         return 1;
     }
 
-    PGNVisitor visitor(depth, output_file);
-    for (const auto& file : files) {
-        if (!std::filesystem::exists(file)) {
-            continue;
-        }
+    BuildStats stats;
+    auto counters = stats.register_thread();
+
+    {
+        ProgressReporter progress(stats, report.ProgressSeconds);
+        PGNVisitor visitor(depth, output_file, counters, report.DirectIO);
+
+        for (const auto& file : files) {
+            if (!std::filesystem::exists(file)) {
+                continue;
+            }
+
+            PROFILE_SCOPE(fmt::interpolate("Parse {}", file.string()).c_str());
+            CountingFileBuf file_buffer(file, counters->BytesRead);
+            if (!file_buffer.is_open()) {
+                fmt::eprintln("Failed to open {}", file.string());
+                continue;
+            }
 
-        PROFILE_SCOPE(fmt::interpolate("Parse {}", file.string()).c_str());
-        std::ifstream file_stream(file);
-        pgn::StreamParser parser(file_stream);
+            std::istream file_stream(&file_buffer);
+            pgn::StreamParser parser(file_stream);
+
+            auto start = std::chrono::steady_clock::now();
+            uint64_t bytes_before = counters->BytesRead.load();
+            uint64_t games_before = counters->Games.load();
+
+            auto error = parser.readGames(visitor);
+            stats.record_file(
+                {file, counters->BytesRead.load() - bytes_before,
+                 counters->Games.load() - games_before,
+                 std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()});
+
+            if (error.hasError()) {
+                fmt::eprintln(error.message());
+                continue;
+            }
+        }
+    }
 
-        auto error = parser.readGames(visitor);
-        if (error.hasError()) {
-            fmt::eprintln(error.message());
-            continue;
+    if (!report.StatsFile.empty()) {
+        if (!stats.write_json(report.StatsFile)) {
+            fmt::eprintln("Failed to write stats to {}", report.StatsFile);
+            return 1;
         }
+        fmt::println("Wrote run stats to {}", report.StatsFile);
     }
 
     return 0;
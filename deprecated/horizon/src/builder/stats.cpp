@@ -0,0 +1,138 @@
+#include <pch.hpp>
+
+#include "builder/stats.hpp"
+
+#include "core/json.hpp"
+#include "core/polyglot.hpp"
+
+// ================ BUILD STATS ================
+
+BuildStats::BuildStats() : m_Start(std::chrono::steady_clock::now()) {}
+
+Ref<BuildCounters> BuildStats::register_thread() {
+    std::lock_guard lock(m_Mutex);
+    auto counters = CreateRef<BuildCounters>();
+    m_Threads.push_back(counters);
+    return counters;
+}
+
+void BuildStats::record_file(const FileTiming& timing) {
+    std::lock_guard lock(m_Mutex);
+    m_Files.push_back(timing);
+}
+
+BuildSnapshot BuildStats::snapshot() const {
+    BuildSnapshot snapshot;
+    snapshot.Seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+
+    std::lock_guard lock(m_Mutex);
+    for (const auto& counters : m_Threads) {
+        snapshot.BytesRead += counters->BytesRead.load();
+        snapshot.Games += counters->Games.load();
+        snapshot.SanParsed += counters->SanParsed.load();
+        snapshot.LegalMoves += counters->LegalMoves.load();
+        snapshot.IllegalMoves += counters->IllegalMoves.load();
+        snapshot.EntriesWritten += counters->EntriesWritten.load();
+        snapshot.FlushNs += counters->FlushNs.load();
+        snapshot.WriteNs += counters->WriteNs.load();
+        snapshot.Rehashes += counters->Rehashes.load();
+
+        // Each thread drains its own table, so the peaks add up across threads
+        snapshot.PeakTablePositions += counters->PeakTablePositions.load();
+        snapshot.PeakTableBuckets += counters->PeakTableBuckets.load();
+        snapshot.PeakTableBytes += counters->PeakTableBytes.load();
+    }
+
+    return snapshot;
+}
+
+std::string BuildStats::progress_line() const {
+    auto s = snapshot();
+    return fmt::interpolate("[{}s] {} MB read ({} MB/s), {} games ({}/s), {} SAN/s, {}% illegal",
+                            static_cast<uint64_t>(s.Seconds), s.BytesRead / (1024 * 1024),
+                            static_cast<uint64_t>(s.rate(s.BytesRead) / (1024 * 1024)), s.Games,
+                            static_cast<uint64_t>(s.rate(s.Games)),
+                            static_cast<uint64_t>(s.rate(s.SanParsed)), s.illegal_rate() * 100.0);
+}
+
+bool BuildStats::write_json(const std::filesystem::path& path) const {
+    auto s = snapshot();
+    JsonWriter json;
+    json.begin_object();
+
+    json.field("seconds", s.Seconds);
+    json.field("bytes_read", s.BytesRead);
+    json.field("games", s.Games);
+    json.field("san_parsed", s.SanParsed);
+    json.field("legal_moves", s.LegalMoves);
+    json.field("illegal_moves", s.IllegalMoves);
+    json.field("entries_written", s.EntriesWritten);
+
+    json.key("rates").begin_object();
+    json.field("mb_per_second", s.rate(s.BytesRead) / (1024.0 * 1024.0));
+    json.field("games_per_second", s.rate(s.Games));
+    json.field("san_per_second", s.rate(s.SanParsed));
+    json.field("illegal_rate", s.illegal_rate());
+    json.end_object();
+
+    json.key("table").begin_object();
+    json.field("peak_positions", s.PeakTablePositions);
+    json.field("peak_buckets", s.PeakTableBuckets);
+    json.field("peak_load_factor", s.load_factor());
+    json.field("peak_bytes", s.PeakTableBytes);
+    json.field("rehashes", s.Rehashes);
+    json.end_object();
+
+    json.field("flush_seconds", static_cast<double>(s.FlushNs) / 1e9);
+    json.field("write_seconds", static_cast<double>(s.WriteNs) / 1e9);
+    // Same 1024 * 1024 byte megabytes as the read rate
+    double write_seconds = static_cast<double>(s.WriteNs) / 1e9;
+    double write_mb = static_cast<double>(s.EntriesWritten * POLY_ENTRY_SIZE) / (1024.0 * 1024.0);
+    json.field("write_mb_per_second", write_seconds > 0 ? write_mb / write_seconds : 0.0);
+
+    json.key("files").begin_array();
+    {
+        std::lock_guard lock(m_Mutex);
+        for (const auto& file : m_Files) {
+            json.begin_object();
+            json.field("path", file.Path.string());
+            json.field("bytes", file.Bytes);
+            json.field("games", file.Games);
+            json.field("seconds", file.Seconds);
+            json.end_object();
+        }
+    }
+    json.end_array();
+
+    json.end_object();
+    return json.save(path);
+}
+
+// ================ PROGRESS REPORTER ================
+
+ProgressReporter::ProgressReporter(const BuildStats& stats, uint64_t interval_seconds)
+    : m_Stats(stats), m_Interval(std::chrono::seconds(interval_seconds)), m_Stop(false) {
+    if (interval_seconds == 0) {
+        return;
+    }
+
+    m_Thread = std::thread([this] {
+        std::unique_lock lock(m_Mutex);
+        while (!m_Signal.wait_for(lock, m_Interval, [this] { return m_Stop; })) {
+            fmt::println("{}", m_Stats.progress_line());
+        }
+    });
+}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Signal.notify_one();
+
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
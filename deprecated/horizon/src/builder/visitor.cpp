@@ -3,8 +3,11 @@
 #include "builder/visitor.hpp"
 
 void PGNVisitor::startPgn() {
-    m_Board.setFen(constants::STARTPOS);
+    m_Board = start_board();
     m_NumHalfMovesSoFar = 0;
+
+    // A game adds at most one position per half move, so the table never rehashes mid-game
+    m_PositionMap.reserve(m_MaxOpeningDepth * 2);
 }
 
 void PGNVisitor::move(std::string_view move, [[maybe_unused]] std::string_view comment) {
@@ -12,6 +15,7 @@ void PGNVisitor::move(std::string_view move, [[maybe_unused]] std::string_view c
     uint64_t key = m_Board.hash();
 
     Move parsed_move = uci::parseSan(m_Board, move);
+    m_Counters->SanParsed.add(1);
     uint16_t encoded_move = parsed_move.move();
 
     if (m_NumHalfMovesSoFar < halfmove_cutoff) {
@@ -21,16 +25,21 @@ void PGNVisitor::move(std::string_view move, [[maybe_unused]] std::string_view c
     Movelist moves;
     movegen::legalmoves(moves, m_Board);
     if (!contains(moves, parsed_move)) {
-        m_IllegalCounter += 1;
+        m_Counters->IllegalMoves.add(1);
         return;
     }
 
     m_Board.makeMove(parsed_move);
-    m_LegalCounter += 1;
+    m_Counters->LegalMoves.add(1);
     m_NumHalfMovesSoFar++;
 }
 
 void PGNVisitor::endPgn() {
+    sample_table();
     try_flush();
-    m_GameCounter += 1;
+    m_Counters->Games.add(1);
+
+    // The drained table still holds its buckets, so it is replaced before they are reused
+    m_PositionMap = PositionTable(&m_Arena);
+    m_Arena.reset();
 }
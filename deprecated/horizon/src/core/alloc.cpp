@@ -0,0 +1,92 @@
+#include <pch.hpp>
+
+#include "core/alloc.hpp"
+
+#ifdef COUNT_ALLOCATIONS
+
+// A plain thread local integer keeps counting as cheap as the allocation itself is not
+static thread_local uint64_t t_Allocations = 0;
+
+uint64_t thread_allocations() { return t_Allocations; }
+
+static void* counted_alloc(size_t size) {
+    t_Allocations++;
+    return std::malloc(size ? size : 1);
+}
+
+static void* counted_aligned_alloc(size_t size, std::align_val_t alignment) {
+    t_Allocations++;
+    auto align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+    size = (std::max<size_t>(size, 1) + align - 1) & ~(align - 1);
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    return std::aligned_alloc(align, size);
+#endif
+}
+
+static void aligned_free(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+// ================ REPLACED OPERATORS ================
+
+void* operator new(size_t size) {
+    if (void* ptr = counted_alloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size); }
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* ptr = counted_aligned_alloc(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_aligned_alloc(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return counted_aligned_alloc(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { aligned_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    aligned_free(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    aligned_free(ptr);
+}
+
+#else
+
+uint64_t thread_allocations() { return 0; }
+
+#endif
@@ -0,0 +1,201 @@
+#include <pch.hpp>
+
+#include "core/bulkio.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define BULK_SSSE3_KERNEL
+#include <immintrin.h>
+#endif
+
+// ================ ENCODING ================
+
+static void encode_portable(std::span<const PolyEntry> entries, unsigned char* out) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+        polyglot::encode(out + i * POLY_ENTRY_SIZE, entries[i]);
+    }
+}
+
+#ifdef BULK_SSSE3_KERNEL
+// An entry in host order only needs its key and each 16-bit field reversed in place, one byte
+// shuffle. Every 16 byte store also spills over the first two bytes of the next entry, which its
+// own store then overwrites, so only the last entry is left to the portable path.
+__attribute__((target("ssse3"))) static void encode_ssse3(std::span<const PolyEntry> entries,
+                                                         unsigned char* out) {
+    const __m128i swap = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 9, 8, 11, 10, 13, 12, 14, 15);
+    const auto* in = reinterpret_cast<const unsigned char*>(entries.data());
+
+    size_t i = 0;
+    for (; i + 1 < entries.size(); ++i) {
+        __m128i entry = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * POLY_ENTRY_SIZE));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * POLY_ENTRY_SIZE),
+                         _mm_shuffle_epi8(entry, swap));
+    }
+    encode_portable(entries.subspan(i), out + i * POLY_ENTRY_SIZE);
+}
+#endif
+
+void encode_entries(std::span<const PolyEntry> entries, unsigned char* out) {
+#ifdef BULK_SSSE3_KERNEL
+    static const bool has_ssse3 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") != 0;
+    }();
+
+    if (has_ssse3) {
+        encode_ssse3(entries, out);
+        return;
+    }
+#endif
+    encode_portable(entries, out);
+}
+
+// ================ WRITER ================
+
+#ifdef _WIN32
+BulkBookWriter::BulkBookWriter()
+    : m_Block(nullptr), m_BlockBytes(0), m_Cursor(0), m_Offset(0), m_Direct(false), m_Good(true),
+      m_File(nullptr) {}
+#else
+BulkBookWriter::BulkBookWriter()
+    : m_Block(nullptr), m_BlockBytes(0), m_Cursor(0), m_Offset(0), m_Direct(false), m_Good(true),
+      m_FileDescriptor(-1) {}
+#endif
+
+Result<Ref<BulkBookWriter>, std::string> BulkBookWriter::open(const std::filesystem::path& path,
+                                                              const BulkWriteOptions& options) {
+    using Res = Result<Ref<BulkBookWriter>, std::string>;
+    Ref<BulkBookWriter> writer(new BulkBookWriter());
+    writer->m_Path = path;
+    auto staged = polyglot::staging_path(path);
+
+#ifdef _WIN32
+    writer->m_File = std::fopen(staged.string().c_str(), "wb");
+    if (!writer->m_File) {
+        return Res::Err(fmt::interpolate("Failed to open {}", path.string()));
+    }
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (options.Direct) {
+        writer->m_FileDescriptor = ::open(staged.c_str(), flags | O_DIRECT, 0644);
+        writer->m_Direct = writer->m_FileDescriptor >= 0;
+    }
+#endif
+    if (writer->m_FileDescriptor < 0) {
+        writer->m_FileDescriptor = ::open(staged.c_str(), flags, 0644);
+    }
+    if (writer->m_FileDescriptor < 0) {
+        return Res::Err(fmt::interpolate("Failed to open {}", path.string()));
+    }
+#ifdef F_NOCACHE
+    if (options.Direct) {
+        writer->m_Direct = fcntl(writer->m_FileDescriptor, F_NOCACHE, 1) != -1;
+    }
+#endif
+#endif
+
+    writer->m_BlockBytes =
+        std::max<size_t>(1, options.BlockBytes / BULK_IO_BLOCK_UNIT) * BULK_IO_BLOCK_UNIT;
+    writer->m_Storage.resize(writer->m_BlockBytes + BULK_IO_ALIGNMENT);
+
+    void* block = writer->m_Storage.data();
+    size_t space = writer->m_Storage.size();
+    writer->m_Block = static_cast<unsigned char*>(
+        std::align(BULK_IO_ALIGNMENT, writer->m_BlockBytes, block, space));
+
+    return Res(writer);
+}
+
+bool BulkBookWriter::write_block(size_t bytes) {
+#ifdef _WIN32
+    if (std::fwrite(m_Block, 1, bytes, m_File) != bytes) {
+        m_Good = false;
+        return false;
+    }
+#else
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t wrote = ::pwrite(m_FileDescriptor, m_Block + done, bytes - done,
+                                 static_cast<off_t>(m_Offset + done));
+        if (wrote < 0 && errno == EINTR) {
+            continue;
+        } else if (wrote <= 0) {
+            m_Good = false;
+            return false;
+        }
+        done += static_cast<size_t>(wrote);
+    }
+#endif
+
+    m_Offset += bytes;
+    return true;
+}
+
+void BulkBookWriter::close() {
+#ifdef _WIN32
+    if (!m_File) {
+        return;
+    }
+    m_Good = std::fclose(m_File) == 0 && m_Good;
+    m_File = nullptr;
+#else
+    if (m_FileDescriptor < 0) {
+        return;
+    }
+    m_Good = ::close(m_FileDescriptor) == 0 && m_Good;
+    m_FileDescriptor = -1;
+#endif
+
+    // A failed build leaves the previous book in place
+    auto staged = polyglot::staging_path(m_Path);
+    if (m_Good) {
+        m_Good = polyglot::publish(staged, m_Path);
+    } else {
+        std::error_code ec;
+        std::filesystem::remove(staged, ec);
+    }
+}
+
+bool BulkBookWriter::write(std::span<const PolyEntry> entries) {
+    // Blocks are whole entries, so an entry never straddles two of them
+    while (!entries.empty() && m_Good) {
+        size_t count = std::min(entries.size(), (m_BlockBytes - m_Cursor) / POLY_ENTRY_SIZE);
+        encode_entries(entries.first(count), m_Block + m_Cursor);
+        m_Cursor += count * POLY_ENTRY_SIZE;
+        entries = entries.subspan(count);
+
+        if (m_Cursor == m_BlockBytes) {
+            write_block(m_BlockBytes);
+            m_Cursor = 0;
+        }
+    }
+    return m_Good;
+}
+
+bool BulkBookWriter::finish() {
+    if (m_Cursor > 0 && m_Good) {
+#if !defined(_WIN32) && defined(O_DIRECT)
+        // The last block rarely ends on an aligned length, so it goes through the page cache
+        if (m_Direct && m_Cursor % BULK_IO_ALIGNMENT != 0) {
+            int flags = fcntl(m_FileDescriptor, F_GETFL);
+            fcntl(m_FileDescriptor, F_SETFL, flags & ~O_DIRECT);
+        }
+#endif
+        write_block(m_Cursor);
+    }
+    m_Cursor = 0;
+
+    close();
+    return m_Good;
+}
+
+void BulkBookWriter::discard() {
+    m_Cursor = 0;
+    m_Good = false;
+    close();
+}
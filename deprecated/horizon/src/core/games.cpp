@@ -0,0 +1,236 @@
+#include <pch.hpp>
+
+#include "core/games.hpp"
+
+#include "core/concurrent.hpp"
+#include "core/membuf.hpp"
+#include "core/split.hpp"
+
+constexpr size_t GAME_SCAN_CHUNK_BYTES = 16 * 1024 * 1024;
+constexpr uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+static inline void put_le64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<unsigned char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+static inline uint64_t get_le64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+// ================ SCANNING ================
+
+std::vector<uint64_t> find_game_offsets(std::string_view text, size_t begin, size_t end) {
+    std::vector<uint64_t> offsets;
+    end = std::min(end, text.size());
+    if (begin >= end) {
+        return offsets;
+    }
+    if (begin == 0) {
+        offsets.push_back(0);
+    }
+
+    // A tag at pos + 1 starts a game when the line before the newline at pos is blank
+    auto confirm = [&](size_t pos) {
+        size_t previous = pos;
+        while (previous > 0 && text[previous - 1] == '\r') {
+            previous--;
+        }
+        if (previous > 0 && text[previous - 1] == '\n') {
+            offsets.push_back(pos + 1);
+        }
+    };
+
+    using Batch = xsimd::batch<uint8_t>;
+    const auto* data = reinterpret_cast<const uint8_t*>(text.data());
+    size_t pos = begin > 0 ? begin - 1 : 0;
+    size_t stop = end - 1;
+    for (; pos + Batch::size <= stop; pos += Batch::size) {
+        auto newlines = Batch::load_unaligned(data + pos) == Batch('\n');
+        auto tags = Batch::load_unaligned(data + pos + 1) == Batch('[');
+        for (uint64_t mask = (newlines & tags).mask(); mask; mask &= mask - 1) {
+            confirm(pos + std::countr_zero(mask));
+        }
+    }
+    for (; pos < stop; ++pos) {
+        if (data[pos] == '\n' && data[pos + 1] == '[') {
+            confirm(pos);
+        }
+    }
+
+    return offsets;
+}
+
+std::string_view game_text(std::string_view text, uint64_t offset) {
+    if (offset >= text.size()) {
+        return {};
+    }
+    return text.substr(offset, next_game_offset(text, offset + 1) - offset);
+}
+
+uint64_t header_digest(std::string_view text, uint64_t offset) {
+    uint64_t digest = FNV_OFFSET_BASIS;
+    bool blank_line = true;
+    for (size_t i = offset; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '\r') {
+            continue;
+        } else if (c == '\n') {
+            // The tag section ends at the first blank line
+            if (blank_line && i > offset) {
+                break;
+            }
+            blank_line = true;
+        } else {
+            blank_line = false;
+        }
+
+        digest ^= static_cast<unsigned char>(c);
+        digest *= FNV_PRIME;
+    }
+    return digest;
+}
+
+std::vector<GameEntry> scan_games(std::string_view text, uint64_t threads) {
+    PROFILE_FUNCTION();
+    std::vector<std::pair<size_t, size_t>> chunks;
+    for (size_t begin = 0; begin < text.size(); begin += GAME_SCAN_CHUNK_BYTES) {
+        chunks.push_back({begin, std::min(text.size(), begin + GAME_SCAN_CHUNK_BYTES)});
+    }
+
+    std::vector<std::vector<GameEntry>> found(chunks.size());
+    parallel_for_each(std::span(chunks), worker_count(threads),
+                      [&](std::pair<size_t, size_t>& chunk) {
+                          auto& games = found[&chunk - chunks.data()];
+                          for (auto offset : find_game_offsets(text, chunk.first, chunk.second)) {
+                              games.push_back({offset, header_digest(text, offset)});
+                          }
+                      });
+
+    std::vector<GameEntry> games;
+    for (auto& chunk : found) {
+        games.insert(games.end(), chunk.begin(), chunk.end());
+    }
+
+    // Whatever precedes the first tag is only a game when it holds more than whitespace
+    if (!games.empty()) {
+        auto first = game_text(text, 0);
+        if (first.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+            games.erase(games.begin());
+        }
+    }
+    return games;
+}
+
+// ================ SIDECAR ================
+
+static int64_t modified_ticks(const std::filesystem::path& pgn) {
+    std::error_code ec;
+    auto modified = std::filesystem::last_write_time(pgn, ec);
+    return ec ? 0 : static_cast<int64_t>(modified.time_since_epoch().count());
+}
+
+std::filesystem::path game_offsets_path(const std::filesystem::path& pgn) {
+    std::filesystem::path path = pgn;
+    path += ".idx";
+    return path;
+}
+
+Result<std::vector<GameEntry>, std::string> load_game_offsets(const std::filesystem::path& pgn,
+                                                              std::string_view text) {
+    using Res = Result<std::vector<GameEntry>, std::string>;
+    auto path = game_offsets_path(pgn);
+    if (!std::filesystem::exists(path)) {
+        return Res::Err(fmt::interpolate("{} does not exist", path.string()));
+    }
+
+    auto opened = MappedFile::open(path);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+
+    auto file = opened.unwrap();
+    const unsigned char* data = file->data();
+    if (file->size() < GAME_OFFSETS_HEADER_BYTES ||
+        std::memcmp(data, GAME_OFFSETS_MAGIC.data(), GAME_OFFSETS_MAGIC.size()) != 0 ||
+        get_le64(data + 8) != GAME_OFFSETS_VERSION) {
+        return Res::Err(fmt::interpolate("{} is not a game offsets file", path.string()));
+    }
+
+    uint64_t count = get_le64(data + 32);
+    if (count != (file->size() - GAME_OFFSETS_HEADER_BYTES) / 16 ||
+        file->size() != GAME_OFFSETS_HEADER_BYTES + count * 16) {
+        return Res::Err(fmt::interpolate("{} is truncated or corrupt", path.string()));
+    }
+
+    if (get_le64(data + 16) != text.size() ||
+        static_cast<int64_t>(get_le64(data + 24)) != modified_ticks(pgn)) {
+        return Res::Err(fmt::interpolate("{} is older than {}", path.string(), pgn.string()));
+    }
+
+    std::vector<GameEntry> games(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        const unsigned char* entry = data + GAME_OFFSETS_HEADER_BYTES + i * 16;
+        games[i] = {get_le64(entry), get_le64(entry + 8)};
+    }
+
+    // Rewriting a file in place can keep its size and time, so the ends have to still match too
+    for (size_t i : {size_t(0), games.size() - 1}) {
+        if (!games.empty() && (games[i].Offset >= text.size() ||
+                               header_digest(text, games[i].Offset) != games[i].HeaderDigest)) {
+            return Res::Err(
+                fmt::interpolate("{} no longer matches {}", path.string(), pgn.string()));
+        }
+    }
+
+    return Res(games);
+}
+
+bool save_game_offsets(const std::filesystem::path& pgn, const std::vector<GameEntry>& games) {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(pgn, ec);
+    if (ec) {
+        return false;
+    }
+
+    std::vector<unsigned char> bytes(GAME_OFFSETS_HEADER_BYTES + games.size() * 16);
+    std::memcpy(bytes.data(), GAME_OFFSETS_MAGIC.data(), GAME_OFFSETS_MAGIC.size());
+    put_le64(bytes.data() + 8, GAME_OFFSETS_VERSION);
+    put_le64(bytes.data() + 16, size);
+    put_le64(bytes.data() + 24, static_cast<uint64_t>(modified_ticks(pgn)));
+    put_le64(bytes.data() + 32, games.size());
+    for (size_t i = 0; i < games.size(); ++i) {
+        unsigned char* entry = bytes.data() + GAME_OFFSETS_HEADER_BYTES + i * 16;
+        put_le64(entry, games[i].Offset);
+        put_le64(entry + 8, games[i].HeaderDigest);
+    }
+
+    std::ofstream file(game_offsets_path(pgn), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(bytes.data()),
+               static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file.flush());
+}
+
+// ================ PARSING ================
+
+GameParser::GameParser()
+    : m_Stream(nullptr), m_Parser(CreateScope<pgn::StreamParser<>>(m_Stream)) {}
+
+pgn::StreamParserError GameParser::parse(std::string_view text, pgn::Visitor& visitor) {
+    MemoryBuf buffer(text);
+    m_Stream.rdbuf(&buffer);
+    auto error = m_Parser->readGames(visitor);
+    m_Stream.rdbuf(nullptr);
+
+    // A parser keeps its first error, so the next game needs a fresh one
+    if (error.hasError()) {
+        m_Parser = CreateScope<pgn::StreamParser<>>(m_Stream);
+    }
+    return error;
+}
@@ -0,0 +1,123 @@
+#include <pch.hpp>
+
+#include "core/learn.hpp"
+
+BookLearner::BookLearner(Ref<MappedFile> file)
+    : m_File(std::move(file)), m_NumEntries(m_File->size() / POLY_ENTRY_SIZE) {}
+
+Result<Ref<BookLearner>, std::string> BookLearner::open(const std::filesystem::path& path) {
+    using Res = Result<Ref<BookLearner>, std::string>;
+
+    auto mapped = MappedFile::open(path, MappedFile::Mode::ReadWrite);
+    if (mapped.is_err()) {
+        return Res::Err(mapped.unwrap_err());
+    }
+
+    auto file = mapped.unwrap();
+    if (file->size() % POLY_ENTRY_SIZE != 0) {
+        return Res::Err(
+            fmt::interpolate("{} is not a multiple of {} bytes", path.string(), POLY_ENTRY_SIZE));
+    }
+
+    // Lookups binary search the file itself, so there is no permutation to fall back on. A move
+    // repeated under one key would split its learning over entries that readers fold back together.
+    const auto* data = file->data();
+    size_t n = file->size() / POLY_ENTRY_SIZE;
+    size_t key_start = 0;
+    for (size_t i = 1; i < n; ++i) {
+        uint64_t previous = polyglot::key_at(data, i - 1);
+        uint64_t key = polyglot::key_at(data, i);
+        if (previous > key) {
+            return Res::Err(fmt::interpolate("{} is not sorted by key, merge it first to sort it",
+                                             path.string()));
+        } else if (previous != key) {
+            key_start = i;
+            continue;
+        }
+
+        auto move = polyglot::load_be16(data + i * POLY_ENTRY_SIZE + POLY_MOVE_OFFSET);
+        for (size_t j = key_start; j < i; ++j) {
+            if (polyglot::load_be16(data + j * POLY_ENTRY_SIZE + POLY_MOVE_OFFSET) == move) {
+                return Res::Err(fmt::interpolate(
+                    "{} repeats moves under one key, merge it first to combine them",
+                    path.string()));
+            }
+        }
+    }
+
+    return Res(Ref<BookLearner>(new BookLearner(file)));
+}
+
+Option<size_t> BookLearner::locate(uint64_t key, uint16_t move) const {
+    const auto* data = m_File->data();
+    auto [first, last] = polyglot::equal_range(data, m_NumEntries, key);
+    for (size_t idx = first; idx < last; ++idx) {
+        size_t offset = idx * POLY_ENTRY_SIZE;
+        if (polyglot::load_be16(data + offset + POLY_MOVE_OFFSET) == move) {
+            return Option<size_t>(offset);
+        }
+    }
+
+    return Option<size_t>();
+}
+
+Option<PolyglotMove> BookLearner::find(uint64_t key, uint16_t move) const {
+    auto offset = locate(key, move);
+    if (offset.is_none()) {
+        return Option<PolyglotMove>();
+    }
+
+    auto entry = polyglot::decode_shared(m_File->data() + offset.unwrap());
+    return Option<PolyglotMove>({entry.move, entry.weight, entry.learn});
+}
+
+bool BookLearner::record(const LearnUpdate& update) {
+    auto offset = locate(update.Key, update.Move);
+    if (offset.is_none()) {
+        return false;
+    }
+
+    auto* entry = m_File->mutable_data() + offset.unwrap();
+    update_field(entry + POLY_LEARN_OFFSET, [&](uint16_t learn) {
+        int score = static_cast<int16_t>(learn) + static_cast<int>(update.Outcome);
+        return static_cast<uint16_t>(static_cast<int16_t>(std::clamp(score, -32768, 32767)));
+    });
+
+    if (update.WeightDelta != 0) {
+        update_field(entry + POLY_WEIGHT_OFFSET, [&](uint16_t weight) {
+            int adjusted = static_cast<int>(weight) + update.WeightDelta;
+            return static_cast<uint16_t>(std::clamp(adjusted, 0, static_cast<int>(UINT16_MAX)));
+        });
+    }
+
+    return true;
+}
+
+size_t BookLearner::record(std::span<const LearnUpdate> updates) {
+    return std::count_if(updates.begin(), updates.end(),
+                         [&](const LearnUpdate& update) { return record(update); });
+}
+
+bool BookLearner::set_weight(uint64_t key, uint16_t move, uint16_t weight) {
+    auto offset = locate(key, move);
+    if (offset.is_none()) {
+        return false;
+    }
+
+    auto* entry = m_File->mutable_data() + offset.unwrap();
+    polyglot::field_ref(entry + POLY_WEIGHT_OFFSET)
+        .store(polyglot::swap_be16(weight), std::memory_order_relaxed);
+    return true;
+}
+
+bool BookLearner::set_learn(uint64_t key, uint16_t move, uint16_t learn) {
+    auto offset = locate(key, move);
+    if (offset.is_none()) {
+        return false;
+    }
+
+    auto* entry = m_File->mutable_data() + offset.unwrap();
+    polyglot::field_ref(entry + POLY_LEARN_OFFSET)
+        .store(polyglot::swap_be16(learn), std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,160 @@
+#include <pch.hpp>
+
+#include "core/mmap.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : m_Data(nullptr), m_Size(0), m_Mode(Mode::ReadOnly), m_FileHandle(INVALID_HANDLE_VALUE),
+      m_MappingHandle(nullptr) {}
+
+void MappedFile::release() {
+    if (m_Data) {
+        UnmapViewOfFile(m_Data);
+        m_Data = nullptr;
+    }
+    if (m_MappingHandle) {
+        CloseHandle(m_MappingHandle);
+        m_MappingHandle = nullptr;
+    }
+    if (m_FileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_FileHandle);
+        m_FileHandle = INVALID_HANDLE_VALUE;
+    }
+    m_Size = 0;
+}
+
+Result<Ref<MappedFile>, std::string> MappedFile::open(const std::filesystem::path& path,
+                                                      Mode mode) {
+    using Res = Result<Ref<MappedFile>, std::string>;
+    Ref<MappedFile> mapped(new MappedFile());
+    mapped->m_Mode = mode;
+    mapped->m_Path = path;
+
+    bool rw = mode == Mode::ReadWrite;
+    mapped->m_FileHandle =
+        CreateFileW(path.wstring().c_str(), rw ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                    FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mapped->m_FileHandle == INVALID_HANDLE_VALUE) {
+        return Res::Err(fmt::interpolate("Failed to open {}", path.string()));
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(mapped->m_FileHandle, &file_size)) {
+        return Res::Err(fmt::interpolate("Failed to stat {}", path.string()));
+    }
+
+    mapped->m_Size = static_cast<size_t>(file_size.QuadPart);
+    if (mapped->m_Size == 0) {
+        return Res(mapped);
+    }
+
+    mapped->m_MappingHandle = CreateFileMappingW(
+        mapped->m_FileHandle, nullptr, rw ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    if (!mapped->m_MappingHandle) {
+        return Res::Err(fmt::interpolate("Failed to map {}", path.string()));
+    }
+
+    mapped->m_Data = static_cast<unsigned char*>(MapViewOfFile(
+        mapped->m_MappingHandle, rw ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, mapped->m_Size));
+    if (!mapped->m_Data) {
+        return Res::Err(fmt::interpolate("Failed to map {}", path.string()));
+    }
+
+    return Res(mapped);
+}
+
+void MappedFile::advise_sequential() const {}
+
+void MappedFile::advise_willneed() const {
+    if (!m_Data) {
+        return;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range{m_Data, m_Size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+bool MappedFile::sync() const {
+    return !m_Data || !writable() || FlushViewOfFile(m_Data, m_Size) != 0;
+}
+
+#else
+
+MappedFile::MappedFile()
+    : m_Data(nullptr), m_Size(0), m_Mode(Mode::ReadOnly), m_FileDescriptor(-1) {}
+
+void MappedFile::release() {
+    if (m_Data) {
+        munmap(m_Data, m_Size);
+        m_Data = nullptr;
+    }
+    if (m_FileDescriptor >= 0) {
+        close(m_FileDescriptor);
+        m_FileDescriptor = -1;
+    }
+    m_Size = 0;
+}
+
+Result<Ref<MappedFile>, std::string> MappedFile::open(const std::filesystem::path& path,
+                                                      Mode mode) {
+    using Res = Result<Ref<MappedFile>, std::string>;
+    Ref<MappedFile> mapped(new MappedFile());
+    mapped->m_Mode = mode;
+    mapped->m_Path = path;
+
+    bool rw = mode == Mode::ReadWrite;
+    mapped->m_FileDescriptor = ::open(path.c_str(), rw ? O_RDWR : O_RDONLY);
+    if (mapped->m_FileDescriptor < 0) {
+        return Res::Err(fmt::interpolate("Failed to open {}: {}", path.string(), strerror(errno)));
+    }
+
+    struct stat st;
+    if (fstat(mapped->m_FileDescriptor, &st) != 0) {
+        return Res::Err(fmt::interpolate("Failed to stat {}: {}", path.string(), strerror(errno)));
+    }
+
+    mapped->m_Size = static_cast<size_t>(st.st_size);
+    if (mapped->m_Size == 0) {
+        return Res(mapped);
+    }
+
+    void* addr = mmap(nullptr, mapped->m_Size, rw ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                      mapped->m_FileDescriptor, 0);
+    if (addr == MAP_FAILED) {
+        return Res::Err(fmt::interpolate("Failed to map {}: {}", path.string(), strerror(errno)));
+    }
+
+    mapped->m_Data = static_cast<unsigned char*>(addr);
+    return Res(mapped);
+}
+
+void MappedFile::advise_sequential() const {
+    if (m_Data) {
+        madvise(m_Data, m_Size, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::advise_willneed() const {
+    if (m_Data) {
+        madvise(m_Data, m_Size, MADV_WILLNEED);
+    }
+}
+
+bool MappedFile::sync() const {
+    return !m_Data || !writable() || msync(m_Data, m_Size, MS_SYNC) == 0;
+}
+
+#endif
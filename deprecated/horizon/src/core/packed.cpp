@@ -0,0 +1,264 @@
+#include <pch.hpp>
+
+#include "core/packed.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(_MSC_VER)
+#define PACKED_BMI2_KERNEL
+#include <immintrin.h>
+#endif
+
+// The lowest bit of every nibble, shifted left to select the others
+constexpr uint64_t NIBBLE_LOW_BITS = 0x1111111111111111;
+constexpr uint64_t RANK_4_BITS = 0x00000000FF000000;
+
+// Nibbles with a special meaning in Board::Compact, above the twelve plain pieces
+constexpr uint8_t NIBBLE_EP_PAWN = 12;
+constexpr uint8_t NIBBLE_WHITE_CASTLE_ROOK = 13;
+constexpr uint8_t NIBBLE_BLACK_CASTLE_ROOK = 14;
+constexpr uint8_t NIBBLE_BLACK_KING_TO_MOVE = 15;
+
+/// The nibble of every occupied square split into four bitboards, one per nibble bit. Working on
+/// whole bitboards replaces the per-square branching of Board::Compact with a handful of masks.
+using NibblePlanes = std::array<uint64_t, 4>;
+
+static inline void set_nibble(NibblePlanes& planes, uint64_t squares, uint8_t nibble) {
+    for (size_t bit = 0; bit < planes.size(); ++bit) {
+        planes[bit] = (planes[bit] & ~squares) | ((nibble >> bit) & 1 ? squares : 0);
+    }
+}
+
+static inline NibblePlanes nibble_planes(const Board& board) {
+    uint64_t white = board.us(Color::WHITE).getBits();
+    uint64_t black = board.us(Color::BLACK).getBits();
+    uint64_t pawns = board.pieces(PieceType::PAWN).getBits();
+    uint64_t knights = board.pieces(PieceType::KNIGHT).getBits();
+    uint64_t bishops = board.pieces(PieceType::BISHOP).getBits();
+    uint64_t rooks = board.pieces(PieceType::ROOK).getBits();
+    uint64_t queens = board.pieces(PieceType::QUEEN).getBits();
+    uint64_t kings = board.pieces(PieceType::KING).getBits();
+
+    // Plain pieces are numbered color * 6 + type
+    NibblePlanes planes = {
+        knights | rooks | kings,
+        (white & (bishops | rooks)) | (black & (pawns | knights | queens | kings)),
+        (white & (queens | kings)) | (black & (pawns | knights)),
+        black & (bishops | rooks | queens | kings),
+    };
+
+    if (board.enpassantSq() != Square::NO_SQ) {
+        // The pawn which just moved sits on the other side of the en passant square
+        uint64_t pawn = 1ULL << (board.enpassantSq().index() ^ 8);
+        set_nibble(planes, pawns & pawn, NIBBLE_EP_PAWN);
+    }
+
+    auto castle_rooks = [&](Color color, Rank rank) {
+        uint64_t squares = 0;
+        for (auto side : {Board::CastlingRights::Side::KING_SIDE,
+                          Board::CastlingRights::Side::QUEEN_SIDE}) {
+            File file = board.castlingRights().getRookFile(color, side);
+            if (file != File::NO_FILE) {
+                squares |= 1ULL << Square(file, rank).index();
+            }
+        }
+        return squares & rooks & board.us(color).getBits();
+    };
+    set_nibble(planes, castle_rooks(Color::WHITE, Rank::RANK_1), NIBBLE_WHITE_CASTLE_ROOK);
+    set_nibble(planes, castle_rooks(Color::BLACK, Rank::RANK_8), NIBBLE_BLACK_CASTLE_ROOK);
+
+    if (board.sideToMove() == Color::BLACK) {
+        set_nibble(planes, black & kings, NIBBLE_BLACK_KING_TO_MOVE);
+    }
+
+    return planes;
+}
+
+/// Builds the bitboards of every nibble value from the planes, then folds the special nibbles back
+/// into the plain pieces the way Board::Compact::decode does
+static inline void unpack_planes(uint64_t occupancy, const NibblePlanes& planes,
+                                 UnpackedBoard& out) {
+    auto squares_of = [&](uint8_t nibble) {
+        uint64_t squares = occupancy;
+        for (size_t bit = 0; bit < planes.size(); ++bit) {
+            squares &= (nibble >> bit) & 1 ? planes[bit] : ~planes[bit];
+        }
+        return squares;
+    };
+
+    for (uint8_t nibble = 0; nibble < out.Pieces.size(); ++nibble) {
+        out.Pieces[nibble] = squares_of(nibble);
+    }
+
+    uint64_t ep_pawns = squares_of(NIBBLE_EP_PAWN);
+    uint64_t white_rooks = squares_of(NIBBLE_WHITE_CASTLE_ROOK);
+    uint64_t black_rooks = squares_of(NIBBLE_BLACK_CASTLE_ROOK);
+    uint64_t black_king = squares_of(NIBBLE_BLACK_KING_TO_MOVE);
+
+    out.Pieces[static_cast<int>(Piece::WHITEPAWN)] |= ep_pawns & RANK_4_BITS;
+    out.Pieces[static_cast<int>(Piece::BLACKPAWN)] |= ep_pawns & ~RANK_4_BITS;
+    out.Pieces[static_cast<int>(Piece::WHITEROOK)] |= white_rooks;
+    out.Pieces[static_cast<int>(Piece::BLACKROOK)] |= black_rooks;
+    out.Pieces[static_cast<int>(Piece::BLACKKING)] |= black_king;
+
+    out.Occupancy = occupancy;
+    out.CastlingRooks = white_rooks | black_rooks;
+    out.EnPassant = ep_pawns ? Square(std::countr_zero(ep_pawns) ^ 8) : Square(Square::NO_SQ);
+    out.SideToMove = black_king ? Color::BLACK : Color::WHITE;
+}
+
+// The packed nibbles are read as two little-endian words holding sixteen squares each, with the
+// first square of every byte in its high half
+static inline uint64_t swap_nibbles(uint64_t word) {
+    return ((word & 0x0F0F0F0F0F0F0F0F) << 4) | ((word >> 4) & 0x0F0F0F0F0F0F0F0F);
+}
+
+static inline void store_packed(uint64_t occupancy, uint64_t low, uint64_t high,
+                                PackedBoard& out) {
+    low = swap_nibbles(low);
+    high = swap_nibbles(high);
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(occupancy >> (56 - i * 8));
+        out[8 + i] = static_cast<uint8_t>(low >> (i * 8));
+        out[16 + i] = static_cast<uint8_t>(high >> (i * 8));
+    }
+}
+
+static inline void load_packed(const PackedBoard& packed, uint64_t& occupancy, uint64_t& low,
+                               uint64_t& high) {
+    occupancy = low = high = 0;
+    for (int i = 0; i < 8; ++i) {
+        occupancy |= static_cast<uint64_t>(packed[i]) << (56 - i * 8);
+        low |= static_cast<uint64_t>(packed[8 + i]) << (i * 8);
+        high |= static_cast<uint64_t>(packed[16 + i]) << (i * 8);
+    }
+    low = swap_nibbles(low);
+    high = swap_nibbles(high);
+}
+
+// ================ PORTABLE KERNEL ================
+
+static void encode_portable(std::span<const Board> boards, std::span<PackedBoard> out) {
+    for (size_t i = 0; i < boards.size(); ++i) {
+        auto planes = nibble_planes(boards[i]);
+        uint64_t occupancy = boards[i].occ().getBits();
+
+        std::array<uint64_t, 2> stream = {0, 0};
+        unsigned count = 0;
+        for (uint64_t left = occupancy; left && count < 32; left &= left - 1, ++count) {
+            int sq = std::countr_zero(left);
+            uint64_t nibble = ((planes[0] >> sq) & 1) | ((planes[1] >> sq) & 1) << 1 |
+                              ((planes[2] >> sq) & 1) << 2 | ((planes[3] >> sq) & 1) << 3;
+            stream[count >> 4] |= nibble << ((count & 15) * 4);
+        }
+
+        store_packed(occupancy, stream[0], stream[1], out[i]);
+    }
+}
+
+static void decode_portable(std::span<const PackedBoard> packed, std::span<UnpackedBoard> out) {
+    for (size_t i = 0; i < packed.size(); ++i) {
+        uint64_t occupancy, low, high;
+        load_packed(packed[i], occupancy, low, high);
+        std::array<uint64_t, 2> stream = {low, high};
+
+        NibblePlanes planes = {0, 0, 0, 0};
+        unsigned count = 0;
+        for (uint64_t left = occupancy; left && count < 32; left &= left - 1, ++count) {
+            int sq = std::countr_zero(left);
+            uint64_t nibble = stream[count >> 4] >> ((count & 15) * 4);
+            planes[0] |= (nibble & 1) << sq;
+            planes[1] |= ((nibble >> 1) & 1) << sq;
+            planes[2] |= ((nibble >> 2) & 1) << sq;
+            planes[3] |= ((nibble >> 3) & 1) << sq;
+        }
+
+        unpack_planes(occupancy, planes, out[i]);
+    }
+}
+
+// ================ BMI2 KERNEL ================
+
+#ifdef PACKED_BMI2_KERNEL
+// pext gathers one plane's bits of the occupied squares in square order, and pdep spreads them
+// out again, so a board costs four of each instead of a loop over its pieces
+__attribute__((target("bmi2"))) static void encode_bmi2(std::span<const Board> boards,
+                                                       std::span<PackedBoard> out) {
+    for (size_t i = 0; i < boards.size(); ++i) {
+        auto planes = nibble_planes(boards[i]);
+        uint64_t occupancy = boards[i].occ().getBits();
+
+        uint64_t low = 0, high = 0;
+        for (int bit = 0; bit < 4; ++bit) {
+            uint64_t gathered = _pext_u64(planes[bit], occupancy);
+            low |= _pdep_u64(gathered, NIBBLE_LOW_BITS << bit);
+            high |= _pdep_u64(gathered >> 16, NIBBLE_LOW_BITS << bit);
+        }
+
+        store_packed(occupancy, low, high, out[i]);
+    }
+}
+
+__attribute__((target("bmi2"))) static void decode_bmi2(std::span<const PackedBoard> packed,
+                                                       std::span<UnpackedBoard> out) {
+    for (size_t i = 0; i < packed.size(); ++i) {
+        uint64_t occupancy, low, high;
+        load_packed(packed[i], occupancy, low, high);
+
+        NibblePlanes planes;
+        for (int bit = 0; bit < 4; ++bit) {
+            uint64_t gathered = _pext_u64(low, NIBBLE_LOW_BITS << bit) |
+                                _pext_u64(high, NIBBLE_LOW_BITS << bit) << 16;
+            planes[bit] = _pdep_u64(gathered, occupancy);
+        }
+
+        unpack_planes(occupancy, planes, out[i]);
+    }
+}
+#endif
+
+// ================ DISPATCH ================
+
+PackedKernel resolve_packed_kernel(PackedKernel kernel) {
+#ifdef PACKED_BMI2_KERNEL
+    static const bool has_bmi2 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2") != 0;
+    }();
+    // Zen 1 and 2 run pdep and pext in microcode, slower than the portable kernel. The slider
+    // lookups already make that call, Hygon's Zen parts included.
+    static const bool fast_bmi2 = has_bmi2 && chess::attacks::fastPext();
+
+    if (kernel == PackedKernel::Auto) {
+        return fast_bmi2 ? PackedKernel::Bmi2 : PackedKernel::Portable;
+    }
+    return kernel == PackedKernel::Bmi2 && has_bmi2 ? PackedKernel::Bmi2 : PackedKernel::Portable;
+#else
+    (void)kernel;
+    return PackedKernel::Portable;
+#endif
+}
+
+void encode_packed(std::span<const Board> boards, std::span<PackedBoard> out,
+                   PackedKernel kernel) {
+    assert(out.size() >= boards.size());
+#ifdef PACKED_BMI2_KERNEL
+    if (resolve_packed_kernel(kernel) == PackedKernel::Bmi2) {
+        encode_bmi2(boards, out);
+        return;
+    }
+#endif
+    (void)kernel;
+    encode_portable(boards, out);
+}
+
+void decode_packed(std::span<const PackedBoard> packed, std::span<UnpackedBoard> out,
+                   PackedKernel kernel) {
+    assert(out.size() >= packed.size());
+#ifdef PACKED_BMI2_KERNEL
+    if (resolve_packed_kernel(kernel) == PackedKernel::Bmi2) {
+        decode_bmi2(packed, out);
+        return;
+    }
+#endif
+    (void)kernel;
+    decode_portable(packed, out);
+}
@@ -0,0 +1,36 @@
+#include <pch.hpp>
+
+#include "core/split.hpp"
+
+size_t next_line_offset(std::string_view text, size_t from) {
+    auto pos = text.find('\n', from);
+    return pos == std::string_view::npos ? text.size() : pos + 1;
+}
+
+size_t next_game_offset(std::string_view text, size_t from) {
+    for (auto pos = text.find("\n[", from); pos != std::string_view::npos;
+         pos = text.find("\n[", pos + 1)) {
+        // Only a tag after a blank line starts a game, the others belong to the current one
+        size_t previous = pos;
+        while (previous > 0 && text[previous - 1] == '\r') {
+            previous--;
+        }
+        if (previous > 0 && text[previous - 1] == '\n') {
+            return pos + 1;
+        }
+    }
+    return text.size();
+}
+
+std::vector<std::string_view> split_records(std::string_view text, size_t target_bytes,
+                                            size_t (*next_record)(std::string_view, size_t)) {
+    std::vector<std::string_view> slices;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.size() - start > target_bytes ? next_record(text, start + target_bytes)
+                                                        : text.size();
+        slices.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return slices;
+}
@@ -0,0 +1,4 @@
+#include <pch.hpp>
+
+// Every other file includes chess.hpp with CHESS_EXTERN_SLIDER_TABLES, see the Makefile
+CHESS_DEFINE_SLIDER_TABLES
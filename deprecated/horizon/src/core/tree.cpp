@@ -0,0 +1,139 @@
+#include <pch.hpp>
+
+#include "core/tree.hpp"
+
+uint64_t child_key(const Board& board, Move move) {
+    const auto us = board.sideToMove();
+    const auto them = ~us;
+    const auto from = move.from();
+    const auto to = move.to();
+    const auto piece = board.at(from);
+
+    uint64_t key = board.hash() ^ Zobrist::sideToMove();
+    if (board.enpassantSq() != Square::NO_SQ) {
+        key ^= Zobrist::enpassant(board.enpassantSq().file());
+    }
+
+    auto rights = board.castlingRights();
+    const int old_rights = rights.hashIndex();
+
+    // Castling is encoded as the king capturing its own rook
+    if (move.typeOf() == Move::CASTLING) {
+        const bool king_side = to > from;
+        const auto rook = board.at(to);
+
+        key ^= Zobrist::piece(piece, from) ^
+               Zobrist::piece(piece, Square::castling_king_square(king_side, us));
+        key ^= Zobrist::piece(rook, to) ^
+               Zobrist::piece(rook, Square::castling_rook_square(king_side, us));
+        rights.clear(us);
+
+        return key ^ Zobrist::castling(old_rights) ^ Zobrist::castling(rights.hashIndex());
+    }
+
+    const auto captured = board.at(to);
+    if (captured != Piece::NONE) {
+        key ^= Zobrist::piece(captured, to);
+
+        if (captured.type() == PieceType::ROOK && Rank::back_rank(to.rank(), them)) {
+            const auto side = Board::CastlingRights::closestSide(to, board.kingSq(them));
+            if (rights.getRookFile(them, side) == to.file()) {
+                rights.clear(them, side);
+            }
+        }
+    }
+
+    if (move.typeOf() == Move::PROMOTION) {
+        key ^= Zobrist::piece(piece, from) ^ Zobrist::piece(Piece(move.promotionType(), us), to);
+    } else {
+        key ^= Zobrist::piece(piece, from) ^ Zobrist::piece(piece, to);
+    }
+
+    if (move.typeOf() == Move::ENPASSANT) {
+        key ^= Zobrist::piece(Piece(PieceType::PAWN, them), to.ep_square());
+    }
+
+    if (piece.type() == PieceType::KING) {
+        rights.clear(us);
+    } else if (piece.type() == PieceType::ROOK && Square::back_rank(from, us)) {
+        const auto side = Board::CastlingRights::closestSide(from, board.kingSq(us));
+        if (rights.getRookFile(us, side) == from.file()) {
+            rights.clear(us, side);
+        }
+    } else if (piece.type() == PieceType::PAWN && Square::value_distance(to, from) == 16) {
+        // Matches makeMove: the ep file is hashed whenever an enemy pawn attacks the ep square
+        if (attacks::pawn(us, to.ep_square()) & board.pieces(PieceType::PAWN, them)) {
+            key ^= Zobrist::enpassant(to.file());
+        }
+    }
+
+    return key ^ Zobrist::castling(old_rights) ^ Zobrist::castling(rights.hashIndex());
+}
+
+static void expand_node(const BookIndex& index, Board& board, int plies_left, uint32_t parent,
+                        OpeningTree& tree) {
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    if (moves.empty()) {
+        return;
+    }
+
+    // Sort the children by key so a single forward pass over each book resolves all of them
+    std::array<std::pair<uint64_t, uint16_t>, constants::MAX_MOVES> children;
+    std::array<uint64_t, constants::MAX_MOVES> keys;
+    std::array<uint8_t, constants::MAX_MOVES> hits;
+    const size_t n = moves.size();
+
+    for (size_t i = 0; i < n; ++i) {
+        children[i] = {child_key(board, moves[i]), static_cast<uint16_t>(i)};
+    }
+    std::sort(children.begin(), children.begin() + n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = children[i].first;
+    }
+
+    index.contains_sorted({keys.data(), n}, {hits.data(), n});
+
+    std::array<uint8_t, constants::MAX_MOVES> in_book{};
+    std::array<uint64_t, constants::MAX_MOVES> child_keys;
+    for (size_t i = 0; i < n; ++i) {
+        in_book[children[i].second] = hits[i];
+        child_keys[children[i].second] = children[i].first;
+    }
+
+    auto book_moves = index.probe(board.hash());
+    const auto ply = static_cast<uint16_t>(tree.Nodes[parent].Ply + 1);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (!in_book[i]) {
+            continue;
+        }
+
+        const auto move = moves[i];
+        auto listed = std::find_if(book_moves.begin(), book_moves.end(),
+                                   [&](const BookMove& m) { return m.Compact == move.move(); });
+        uint32_t weight = listed != book_moves.end() ? listed->Frequency : 0;
+
+        auto node_idx = static_cast<uint32_t>(tree.Nodes.size());
+        tree.Nodes.push_back({child_keys[i], parent, move.move(), ply, weight});
+
+        if (plies_left > 1) {
+            board.makeMove(move);
+            assert(board.hash() == tree.Nodes[node_idx].Key);
+            expand_node(index, board, plies_left - 1, node_idx, tree);
+            board.unmakeMove(move);
+        }
+    }
+}
+
+OpeningTree expand_tree(const BookIndex& index, Board& board, int plies) {
+    PROFILE_FUNCTION();
+    OpeningTree tree;
+    tree.Nodes.push_back({board.hash(), OpeningTree::NO_PARENT, Move::NO_MOVE, 0, 0});
+
+    if (plies > 0) {
+        expand_node(index, board, plies, 0, tree);
+    }
+
+    return tree;
+}
@@ -3,14 +3,509 @@
 #include "launcher.hpp"
 
 #include "builder/builder.hpp"
+#include "core/games.hpp"
+#include "tools/bench.hpp"
+#include "tools/convert.hpp"
+#include "tools/extract.hpp"
+#include "tools/index.hpp"
+#include "tools/merge.hpp"
+#include "tools/sample.hpp"
 
 #define FLAG_IMPLEMENTATION
 #include "flag/flag.h"
 
 void usage() {
-    fmt::eprintln("Usage: ./horizon [OPTIONS]");
+    fmt::eprintln("Usage: ./horizon [OPTIONS] [SUBCOMMAND] [SUBCOMMAND OPTIONS]");
     fmt::eprintln("OPTIONS:");
     flag_print_options(stderr);
+    fmt::eprintln("SUBCOMMANDS:");
+    fmt::eprintln("    merge");
+    fmt::eprintln("        Merge several key-sorted books into one");
+    fmt::eprintln("    generate");
+    fmt::eprintln("        Write a seeded synthetic pgn corpus");
+    fmt::eprintln("    bench");
+    fmt::eprintln("        Benchmark book building and probing on a synthetic corpus");
+    fmt::eprintln("    convert");
+    fmt::eprintln("        Convert an epd suite to pgn or the positions of a pgn file to epd");
+    fmt::eprintln("    extract");
+    fmt::eprintln("        Write the positions of pgn games as packed training data");
+    fmt::eprintln("    index");
+    fmt::eprintln("        Index which games of pgn files reach every position");
+    fmt::eprintln("    query");
+    fmt::eprintln("        Print the games of an index reaching a position");
+    fmt::eprintln("    sample");
+    fmt::eprintln("        Write a seeded random sample of the games of a pgn file");
+}
+
+void subcommand_usage(void* context) {
+    fmt::eprintln("Usage: ./horizon {} [OPTIONS]", flag_c_program_name(context));
+    fmt::eprintln("OPTIONS:");
+    flag_c_print_options(context, stderr);
+}
+
+int launch_merge(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("merge");
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto input_flag = flag_c_list(context, "input",
+                                  "A key-sorted input book, optionally suffixed with @<scale> to "
+                                  "multiply its weights");
+    auto output_flag = flag_c_str(context, "output", "merged.bin", "The merged book to write");
+    auto min_weight_flag = flag_c_uint64(context, "min-weight", 1,
+                                         "Moves with a lower aggregated weight are pruned");
+    auto top_flag = flag_c_uint64(context, "top", 0,
+                                  "Keep only the K heaviest moves per position (0 keeps all)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag || input_flag->count == 0) {
+        subcommand_usage(context);
+        status = *help_flag ? 0 : 1;
+    } else {
+        std::vector<MergeInput> inputs;
+        for (size_t i = 0; i < input_flag->count && status == 0; ++i) {
+            std::string spec(input_flag->items[i]);
+            MergeInput input{spec, 1.0f};
+
+            auto at = spec.rfind('@');
+            if (at != std::string::npos) {
+                input.Path = spec.substr(0, at);
+                try {
+                    input.WeightScale = std::stof(spec.substr(at + 1));
+                } catch (const std::exception&) {
+                    fmt::eprintln("Invalid weight scale in {}", spec);
+                    status = 1;
+                }
+            }
+            inputs.push_back(input);
+        }
+
+        if (status == 0) {
+            status = merge_books(inputs, {*min_weight_flag, *top_flag}, *output_flag);
+        }
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_generate(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("generate");
+    CorpusOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto output_flag = flag_c_str(context, "output", "corpus.pgn", "The pgn file to write");
+    auto games_flag =
+        flag_c_uint64(context, "games", options.Games, "The number of games to write");
+    auto size_flag = flag_c_size(context, "size", 0,
+                                 "Write games until the corpus reaches this size instead, accepts "
+                                 "K, M and G suffixes (0 uses -games)");
+    auto seed_flag = flag_c_uint64(context, "seed", options.Seed, "The seed for every game");
+    auto min_plies_flag =
+        flag_c_uint64(context, "min-plies", options.MinPlies, "The shortest game length in plies");
+    auto mean_plies_flag =
+        flag_c_uint64(context, "mean-plies", options.MeanPlies, "The mean game length in plies");
+    auto max_plies_flag =
+        flag_c_uint64(context, "max-plies", options.MaxPlies, "The longest game length in plies");
+    auto clock_flag =
+        flag_c_uint64(context, "clk", 0, "Percentage of moves with a %clk comment (0-100)");
+    auto eval_flag =
+        flag_c_uint64(context, "eval", 0, "Percentage of moves with an %eval comment (0-100)");
+    auto headers_flag = flag_c_uint64(context, "headers", options.Headers,
+                                      "The number of header tags per game");
+    auto skew_flag = flag_c_str(context, "skew", "1.0",
+                                "Zipf exponent for opening move ranks, 0 picks uniformly");
+    auto opening_plies_flag = flag_c_uint64(context, "opening-plies", options.OpeningPlies,
+                                            "The number of plies the skew applies to");
+    auto threads_flag =
+        flag_c_uint64(context, "threads", 0, "Worker threads (0 uses every hardware thread)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag) {
+        subcommand_usage(context);
+    } else {
+        options.Games = *games_flag;
+        options.TargetBytes = *size_flag;
+        options.Seed = *seed_flag;
+        options.MinPlies = *min_plies_flag;
+        options.MeanPlies = *mean_plies_flag;
+        options.MaxPlies = *max_plies_flag;
+        options.ClockDensity = std::min<uint64_t>(*clock_flag, 100) / 100.0;
+        options.EvalDensity = std::min<uint64_t>(*eval_flag, 100) / 100.0;
+        options.Headers = *headers_flag;
+        options.OpeningPlies = *opening_plies_flag;
+        options.Threads = *threads_flag;
+
+        try {
+            options.OpeningSkew = std::stod(*skew_flag);
+        } catch (const std::exception&) {
+            fmt::eprintln("Invalid skew {}", *skew_flag);
+            status = 1;
+        }
+
+        if (status == 0) {
+            auto start = std::chrono::steady_clock::now();
+            auto written = write_synthetic_corpus(*output_flag, options);
+            double seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (written.is_err()) {
+                fmt::eprintln(written.unwrap_err());
+                status = 1;
+            } else {
+                auto stats = written.unwrap();
+                fmt::println("Wrote {} games ({} plies, {} bytes) to {} in {} s", stats.Games,
+                             stats.Plies, stats.Bytes, *output_flag, seconds);
+            }
+        }
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_bench(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("bench");
+    BenchOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto output_flag = flag_c_str(context, "output", "bench.json", "The file to write results to");
+    auto games_flag =
+        flag_c_uint64(context, "games", options.Games, "The number of games in the corpus");
+    auto depth_flag = flag_c_uint64(context, "depth", DEFAULT_DEPTH,
+                                    "The maximum depth considered an opening position");
+    auto seed_flag =
+        flag_c_uint64(context, "seed", options.Seed, "The seed for the corpus and probe keys");
+    auto runs_flag = flag_c_uint64(context, "runs", options.Runs,
+                                   "How many times to repeat builds and loads");
+    auto probes_flag = flag_c_uint64(context, "probes", options.Probes,
+                                     "The number of warm and batched probes per key set");
+    auto cold_flag = flag_c_uint64(context, "cold-probes", options.ColdProbes,
+                                   "The number of cold probes per key set");
+    auto batch_flag =
+        flag_c_uint64(context, "batch", options.BatchSize, "The number of keys per batched probe");
+    auto packed_flag = flag_c_uint64(context, "packed", options.PackedBoards,
+                                     "The number of boards to pack and unpack (0 skips them)");
+    auto keys_flag = flag_c_uint64(context, "child-keys", options.KeyPositions,
+                                   "The number of positions to check child keys in (0 skips them)");
+    auto dir_flag = flag_c_str(context, "dir", "",
+                               "The directory for the corpus and books (defaults to a temp dir)");
+    auto keep_flag =
+        flag_c_bool(context, "keep", false, "Keep the corpus and books after the benchmark");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag) {
+        subcommand_usage(context);
+    } else {
+        options.Games = *games_flag;
+        options.Depth = std::min(*depth_flag, MAX_OPENING_DEPTH);
+        options.Seed = *seed_flag;
+        options.Runs = *runs_flag;
+        options.Probes = *probes_flag;
+        options.ColdProbes = *cold_flag;
+        options.BatchSize = *batch_flag;
+        options.PackedBoards = *packed_flag;
+        options.KeyPositions = *keys_flag;
+        options.WorkDir = *dir_flag;
+        options.Keep = *keep_flag;
+        status = run_bench(options, *output_flag);
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_convert(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("convert");
+    ConvertOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto input_flag =
+        flag_c_str(context, "input", "", "The .epd or .pgn file to convert, chosen by extension");
+    auto output_flag = flag_c_str(context, "output", "",
+                                  "The file to write (defaults to the input with the other "
+                                  "extension)");
+    auto depth_flag = flag_c_uint64(context, "depth", options.Depth,
+                                    "Full moves to play before writing a pgn game's position (0 "
+                                    "writes the final position)");
+    auto unique_flag =
+        flag_c_bool(context, "unique", false, "Drop duplicate positions instead of only reporting");
+    auto threads_flag =
+        flag_c_uint64(context, "threads", 0, "Worker threads (0 uses every hardware thread)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag || std::string(*input_flag).empty()) {
+        subcommand_usage(context);
+        status = *help_flag ? 0 : 1;
+    } else {
+        std::filesystem::path input(*input_flag);
+        bool from_epd = input.extension() == ".epd";
+        if (!from_epd && input.extension() != ".pgn") {
+            fmt::eprintln("Expected an .epd or .pgn input, got {}", input.string());
+            status = 1;
+        }
+
+        options.Depth = *depth_flag;
+        options.Unique = *unique_flag;
+        options.Threads = *threads_flag;
+
+        std::filesystem::path output(*output_flag);
+        if (output.empty()) {
+            output = input;
+            output.replace_extension(from_epd ? ".pgn" : ".epd");
+        }
+
+        if (status == 0) {
+            auto converted =
+                from_epd ? epd_to_pgn(input, output, options) : pgn_to_epd(input, output, options);
+            if (converted.is_err()) {
+                fmt::eprintln(converted.unwrap_err());
+                status = 1;
+            } else {
+                auto stats = converted.unwrap();
+                if (!stats.Duplicates.empty()) {
+                    std::string numbers;
+                    for (auto number : stats.Duplicates) {
+                        numbers += (numbers.empty() ? "" : ",") + std::to_string(number);
+                    }
+                    fmt::println("Warning: The following {} are a duplicate: {}.",
+                                 from_epd ? "FENs" : "games", numbers);
+                }
+                if (stats.Skipped > 0) {
+                    fmt::println("Skipped {} games which ended early or contained illegal moves",
+                                 stats.Skipped);
+                }
+                fmt::println("Wrote the converted {} to {}.", from_epd ? "book" : "positions",
+                             output.string());
+            }
+        }
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_extract(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("extract");
+    ExtractOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto input_flag = flag_c_list(context, "input", "A pgn file to extract positions from");
+    auto output_flag =
+        flag_c_str(context, "output", "training.bin", "The training data file to write");
+    auto min_ply_flag = flag_c_uint64(context, "min-ply", options.MinPly,
+                                      "Skip positions reached before this ply");
+    auto quiet_flag = flag_c_bool(context, "quiet", false,
+                                  "Skip positions in check or reached by a capture");
+    auto eval_flag =
+        flag_c_bool(context, "eval", false, "Skip positions without an %eval comment");
+    auto progress_flag = flag_c_uint64(context, "progress", options.ProgressSeconds,
+                                       "Seconds between progress lines (0 disables them)");
+    auto stats_flag =
+        flag_c_str(context, "stats", "", "A json file to write the run stats to when finished");
+    auto threads_flag =
+        flag_c_uint64(context, "threads", 0, "Worker threads (0 uses every hardware thread)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag || input_flag->count == 0) {
+        subcommand_usage(context);
+        status = *help_flag ? 0 : 1;
+    } else {
+        std::vector<std::filesystem::path> inputs(input_flag->items,
+                                                  input_flag->items + input_flag->count);
+        options.MinPly = *min_ply_flag;
+        options.Quiet = *quiet_flag;
+        options.RequireEval = *eval_flag;
+        options.ProgressSeconds = *progress_flag;
+        options.StatsFile = *stats_flag;
+        options.Threads = *threads_flag;
+
+        auto extracted = extract_training_data(inputs, *output_flag, options);
+        if (extracted.is_err()) {
+            fmt::eprintln(extracted.unwrap_err());
+            status = 1;
+        } else {
+            auto stats = extracted.unwrap();
+            fmt::println("Wrote {} of {} positions from {} games to {} in {} s ({} positions/s)",
+                         stats.Written, stats.Positions, stats.Games, *output_flag,
+                         stats.Seconds,
+                         static_cast<uint64_t>(stats.Seconds > 0.0 ? stats.Positions / stats.Seconds
+                                                                   : 0.0));
+            if (stats.SkippedGames > 0) {
+                fmt::println("Skipped {} games without a result or with an invalid FEN",
+                             stats.SkippedGames);
+            }
+        }
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_index(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("index");
+    IndexOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto input_flag = flag_c_list(context, "input", "A pgn file to index");
+    auto output_flag = flag_c_str(context, "output", "positions.index", "The index to write");
+    auto depth_flag = flag_c_uint64(context, "depth", options.Depth,
+                                    "Full moves of every game to index (0 indexes whole games)");
+    auto append_flag = flag_c_bool(context, "append", false,
+                                   "Add new files and games appended to indexed files to an "
+                                   "existing index");
+    auto batch_flag = flag_c_size(context, "batch", options.BatchBytes,
+                                  "Pgn bytes parsed before their positions are spilled to disk, "
+                                  "accepts K, M and G suffixes");
+    auto threads_flag =
+        flag_c_uint64(context, "threads", 0, "Worker threads (0 uses every hardware thread)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag || input_flag->count == 0) {
+        subcommand_usage(context);
+        status = *help_flag ? 0 : 1;
+    } else {
+        std::vector<std::filesystem::path> inputs(input_flag->items,
+                                                  input_flag->items + input_flag->count);
+        options.Depth = *depth_flag;
+        options.Append = *append_flag;
+        options.BatchBytes = std::max<uint64_t>(*batch_flag, 1);
+        options.Threads = *threads_flag;
+
+        auto built = build_position_index(inputs, *output_flag, options);
+        if (built.is_err()) {
+            fmt::eprintln(built.unwrap_err());
+            status = 1;
+        } else {
+            auto stats = built.unwrap();
+            fmt::println("Indexed {} new games ({} bytes) in {} s", stats.NewGames,
+                         stats.NewBytes, stats.Seconds);
+            fmt::println("Wrote {} positions of {} games from {} files to {} ({} bytes)",
+                         stats.Keys, stats.Games, stats.Files, *output_flag, stats.IndexBytes);
+        }
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_query(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("query");
+    QueryOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto index_flag = flag_c_str(context, "index", "positions.index", "The index to search");
+    auto fen_flag =
+        flag_c_str(context, "fen", "", "The position to look up (defaults to the start position)");
+    auto moves_flag =
+        flag_c_str(context, "moves", "", "San moves to play from the position before looking up");
+    auto limit_flag = flag_c_uint64(context, "limit", options.Limit,
+                                    "The most games to print (0 prints every game)");
+    auto pgn_flag =
+        flag_c_bool(context, "pgn", false, "Print the games themselves instead of their offsets");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag) {
+        subcommand_usage(context);
+    } else {
+        options.Index = *index_flag;
+        options.Fen = *fen_flag;
+        options.Moves = *moves_flag;
+        options.Limit = *limit_flag;
+        options.PrintGames = *pgn_flag;
+        status = query_position_index(options);
+    }
+
+    flag_c_free(context);
+    return status;
+}
+
+int launch_sample(int argc, char* argv[]) {
+    PROFILE_FUNCTION();
+    void* context = flag_c_new("sample");
+    SampleOptions options;
+
+    auto help_flag = flag_c_bool(context, "help", false, "Print this help message");
+    auto input_flag = flag_c_str(context, "input", "", "The pgn file to sample games from");
+    auto output_flag = flag_c_str(context, "output", "sample.pgn", "The pgn file to write");
+    auto count_flag = flag_c_uint64(context, "count", options.Count, "The number of games to draw");
+    auto seed_flag = flag_c_uint64(context, "seed", options.Seed, "The seed for the draw");
+    auto legal_flag = flag_c_bool(context, "legal", false,
+                                  "Draw again in place of games with illegal moves or fens");
+    auto rescan_flag = flag_c_bool(context, "rescan", false,
+                                   "Scan the pgn for games even if its .idx sidecar is up to date");
+    auto threads_flag =
+        flag_c_uint64(context, "threads", 0, "Worker threads (0 uses every hardware thread)");
+
+    int status = 0;
+    if (!flag_c_parse(context, argc, argv)) {
+        subcommand_usage(context);
+        flag_c_print_error(context, stderr);
+        status = 1;
+    } else if (*help_flag || std::string(*input_flag).empty()) {
+        subcommand_usage(context);
+        status = *help_flag ? 0 : 1;
+    } else {
+        std::filesystem::path input(*input_flag);
+        options.Count = *count_flag;
+        options.Seed = *seed_flag;
+        options.Legal = *legal_flag;
+        options.Rescan = *rescan_flag;
+        options.Threads = *threads_flag;
+
+        auto sampled = sample_games(input, *output_flag, options);
+        if (sampled.is_err()) {
+            fmt::eprintln(sampled.unwrap_err());
+            status = 1;
+        } else {
+            auto stats = sampled.unwrap();
+            if (stats.Scanned) {
+                fmt::println("Scanned {} games in {} s and saved their offsets to {}", stats.Games,
+                             stats.ScanSeconds, game_offsets_path(input).string());
+            }
+            if (stats.Rejected > 0) {
+                fmt::println("Rejected {} drawn games with illegal moves or fens", stats.Rejected);
+            }
+            fmt::println("Wrote {} of {} games to {}", stats.Sampled, stats.Games, *output_flag);
+        }
+    }
+
+    flag_c_free(context);
+    return status;
 }
 
 int launch(int argc, char* argv[]) {
@@ -20,17 +515,18 @@ int launch(int argc, char* argv[]) {
     std::string pgn_ext = str::from_view(DEFAULT_PGN_EXT);
     Option<std::string> single_pgn;
     std::string output = str::from_view(DEFAULT_OUTPUT);
+    BuildReport report{DEFAULT_PROGRESS_SECONDS, ""};
 
     auto target = [&]() -> int {
         if (single_pgn.is_some()) {
-            return make_book(depth, {single_pgn.unwrap()}, output);
+            return make_book(depth, {single_pgn.unwrap()}, output, report);
         } else {
             auto files = collect_pgns(pgn_parent, pgn_ext);
             if (files.empty()) {
                 fmt::eprintln("Failed to collect pgn files");
                 return 1;
             }
-            return make_book(depth, files, output);
+            return make_book(depth, files, output, report);
         }
     };
 
@@ -49,6 +545,11 @@ int launch(int argc, char* argv[]) {
         flag_str("single", "",
                  "A single filepath to use for the book if full directory scanning is not needed");
     auto output_flag = flag_str("output", output.c_str(), "The file to output the binary file to");
+    auto progress_flag = flag_uint64("progress", report.ProgressSeconds,
+                                     "Seconds between progress lines (0 disables them)");
+    auto stats_flag = flag_str("stats", "", "A json file to write the run stats to when finished");
+    auto direct_flag =
+        flag_bool("direct", false, "Write the book with direct I/O, bypassing the page cache");
 
     if (!flag_parse(argc, argv)) {
         usage();
@@ -61,6 +562,32 @@ int launch(int argc, char* argv[]) {
         return 0;
     }
 
+    // Anything left over after the global options names a subcommand
+    if (flag_rest_argc() > 0) {
+        std::string subcommand(flag_rest_argv()[0]);
+        if (subcommand == "merge") {
+            return launch_merge(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "generate") {
+            return launch_generate(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "bench") {
+            return launch_bench(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "convert") {
+            return launch_convert(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "extract") {
+            return launch_extract(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "index") {
+            return launch_index(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "query") {
+            return launch_query(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        } else if (subcommand == "sample") {
+            return launch_sample(flag_rest_argc() - 1, flag_rest_argv() + 1);
+        }
+
+        usage();
+        fmt::eprintln("Unknown subcommand: {}", subcommand);
+        return 1;
+    }
+
     // Reassign options with new flags if valid
     if (*depth_flag < MAX_OPENING_DEPTH) {
         depth = *depth_flag;
@@ -81,6 +608,10 @@ int launch(int argc, char* argv[]) {
         output = maybe_output;
     }
 
+    report.ProgressSeconds = *progress_flag;
+    report.StatsFile = *stats_flag;
+    report.DirectIO = *direct_flag;
+
     std::string maybe_single(*single_pgn_flag);
     if (!maybe_single.empty() && std::filesystem::exists(maybe_single)) {
         single_pgn = Option<std::string>(maybe_single);
@@ -13,6 +13,11 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[]) {
     // Example using using water's API
     auto board = CreateRef<Board>();
     auto& book = Book::instance();
+    if (auto loaded = book.load({{"test.poly"}}); loaded.is_err()) {
+        fmt::eprintln(loaded.unwrap_err());
+        exit(1);
+    }
+
     fmt::println("Opening position in book: {}", book.is_book_pos(board));
     if (!book.is_book_pos(board)) {
         exit(1);
@@ -0,0 +1,844 @@
+#include <pch.hpp>
+
+#include "tools/bench.hpp"
+
+#include "builder/builder.hpp"
+#include "builder/visitor.hpp"
+#include "core/alloc.hpp"
+#include "core/book.hpp"
+#include "core/bookio.hpp"
+#include "core/bulkio.hpp"
+#include "core/games.hpp"
+#include "core/json.hpp"
+#include "core/learn.hpp"
+#include "core/packed.hpp"
+#include "core/tree.hpp"
+#include "tools/merge.hpp"
+
+using BenchClock = std::chrono::steady_clock;
+
+// Larger than the last level cache of the machines we run on, touched before every cold probe
+constexpr size_t CACHE_FLUSH_BYTES = 64 * 1024 * 1024;
+constexpr size_t CACHE_LINE_BYTES = 64;
+
+// Results are folded into this so the optimizer can't drop the work being timed
+static volatile uint64_t s_Sink = 0;
+
+static void consume(uint64_t value) { s_Sink = s_Sink + value; }
+
+static double elapsed_ns(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+static double median(std::vector<double> samples) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+
+    auto mid = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), mid, samples.end());
+    return *mid;
+}
+
+static std::string_view build_config() {
+#if defined(DIST)
+    return "dist";
+#elif defined(RELEASE)
+    return "release";
+#elif defined(DEBUG)
+    return "debug";
+#else
+    return "example";
+#endif
+}
+
+/// Evicts the probed book from the cpu caches by streaming through a buffer larger than them
+class CacheFlusher {
+  private:
+    std::vector<uint8_t> m_Buffer;
+
+  public:
+    CacheFlusher() : m_Buffer(CACHE_FLUSH_BYTES, 1) {}
+
+    void flush() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < m_Buffer.size(); i += CACHE_LINE_BYTES) {
+            m_Buffer[i] += 1;
+            sum += m_Buffer[i];
+        }
+        consume(sum);
+    }
+};
+
+struct BookBackend {
+    std::string Name;
+    std::filesystem::path Path;
+};
+
+struct ProbeKeys {
+    std::vector<uint64_t> Hits;
+    std::vector<uint64_t> Misses;
+};
+
+static ProbeKeys sample_keys(const BookIndex& index, const MappedBook& book, uint64_t count,
+                             uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    ProbeKeys keys;
+    keys.Hits.reserve(count);
+    keys.Misses.reserve(count);
+
+    while (keys.Hits.size() < count && book.size() > 0) {
+        keys.Hits.push_back(book.key_at(rng() % book.size()));
+    }
+    while (keys.Misses.size() < count) {
+        uint64_t key = rng();
+        if (!index.contains(key)) {
+            keys.Misses.push_back(key);
+        }
+    }
+
+    return keys;
+}
+
+static double warm_probe_ns(const BookIndex& index, const std::vector<uint64_t>& keys) {
+    if (keys.empty()) {
+        return 0.0;
+    }
+
+    // An untimed pass first so the touched pages and cache lines are resident
+    uint64_t sink = 0;
+    for (auto key : keys) {
+        sink += index.probe(key).size();
+    }
+
+    auto start = BenchClock::now();
+    for (auto key : keys) {
+        sink += index.probe(key).size();
+    }
+    double ns = elapsed_ns(start);
+
+    consume(sink);
+    return ns / static_cast<double>(keys.size());
+}
+
+static double cold_probe_ns(const BookIndex& index, const std::vector<uint64_t>& keys,
+                            uint64_t count, CacheFlusher& flusher) {
+    std::vector<double> samples;
+    for (size_t i = 0; i < std::min<size_t>(count, keys.size()); ++i) {
+        flusher.flush();
+        auto start = BenchClock::now();
+        consume(index.probe(keys[i]).size());
+        samples.push_back(elapsed_ns(start));
+    }
+
+    return median(samples);
+}
+
+struct BatchTimings {
+    double BatchedNs;
+    double SingleNs;
+};
+
+/// Times contains_sorted over pre-sorted batches that are half hits, against one contains per key
+static BatchTimings batched_probe_ns(const BookIndex& index, const ProbeKeys& keys,
+                                     uint64_t batch_size) {
+    std::vector<uint64_t> mixed;
+    mixed.reserve(keys.Hits.size() + keys.Misses.size());
+    for (size_t i = 0; i < std::max(keys.Hits.size(), keys.Misses.size()); ++i) {
+        if (i < keys.Hits.size()) {
+            mixed.push_back(keys.Hits[i]);
+        }
+        if (i < keys.Misses.size()) {
+            mixed.push_back(keys.Misses[i]);
+        }
+    }
+
+    batch_size = std::max<uint64_t>(batch_size, 1);
+    for (size_t first = 0; first < mixed.size(); first += batch_size) {
+        auto last = std::min<size_t>(first + batch_size, mixed.size());
+        std::sort(mixed.begin() + first, mixed.begin() + last);
+    }
+
+    if (mixed.empty()) {
+        return {0.0, 0.0};
+    }
+
+    std::vector<uint8_t> hits(batch_size);
+    uint64_t sink = 0;
+    auto start = BenchClock::now();
+    for (size_t first = 0; first < mixed.size(); first += batch_size) {
+        auto n = std::min<size_t>(batch_size, mixed.size() - first);
+        index.contains_sorted({mixed.data() + first, n}, {hits.data(), n});
+        sink += hits[0];
+    }
+    double batched = elapsed_ns(start);
+
+    start = BenchClock::now();
+    for (auto key : mixed) {
+        sink += index.contains(key);
+    }
+    double single = elapsed_ns(start);
+
+    consume(sink);
+    auto n = static_cast<double>(mixed.size());
+    return {batched / n, single / n};
+}
+
+/// Replays the path to every node of the tree from its root, returning how many nodes hold a key
+/// other than the hash makeMove gives, which release builds have no assert for
+static uint64_t mismatched_tree_keys(const OpeningTree& tree, const Board& root) {
+    uint64_t mismatches = 0;
+    std::vector<uint16_t> path;
+    for (const auto& node : tree.Nodes) {
+        path.clear();
+        for (const auto* at = &node; at->Parent != OpeningTree::NO_PARENT;
+             at = &tree.Nodes[at->Parent]) {
+            path.push_back(at->Move);
+        }
+
+        Board board = root;
+        for (auto move = path.rbegin(); move != path.rend(); ++move) {
+            board.makeMove(Move(*move));
+        }
+        mismatches += board.hash() != node.Key;
+    }
+    return mismatches;
+}
+
+/// Copies every entry of a book in key order, keeping the repeats that indexing would fold together
+static bool write_sorted_copy(const std::filesystem::path& input,
+                              const std::filesystem::path& path) {
+    PolyReader reader(input);
+    if (!reader.is_open()) {
+        return false;
+    }
+
+    std::vector<PolyEntry> entries;
+    PolyEntry entry;
+    while (reader.next(entry)) {
+        entries.push_back(entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const PolyEntry& a, const PolyEntry& b) { return a.key < b.key; });
+
+    auto opened = BulkBookWriter::open(path, {BULK_IO_BLOCK_BYTES, false});
+    if (opened.is_err()) {
+        return false;
+    }
+
+    auto writer = opened.unwrap();
+    writer->write(entries);
+    return writer->finish();
+}
+
+static Result<void, std::string> bench_backend(const BookBackend& backend,
+                                               const BenchOptions& options, CacheFlusher& flusher,
+                                               JsonWriter& json) {
+    using Res = Result<void, std::string>;
+    PROFILE_FUNCTION();
+
+    std::vector<double> load_ms;
+    Ref<MappedBook> book;
+    for (uint64_t run = 0; run < std::max<uint64_t>(options.Runs, 1); ++run) {
+        auto start = BenchClock::now();
+        auto opened = MappedBook::open({backend.Path});
+        load_ms.push_back(elapsed_ns(start) / 1e6);
+
+        if (opened.is_err()) {
+            return Res::Err(opened.unwrap_err());
+        }
+        book = opened.unwrap();
+    }
+
+    BookIndex index({book});
+    auto keys = sample_keys(index, *book, options.Probes, options.Seed);
+
+    double warm_hit = warm_probe_ns(index, keys.Hits);
+    double warm_miss = warm_probe_ns(index, keys.Misses);
+    double cold_hit = cold_probe_ns(index, keys.Hits, options.ColdProbes, flusher);
+    double cold_miss = cold_probe_ns(index, keys.Misses, options.ColdProbes, flusher);
+    auto batched = batched_probe_ns(index, keys, options.BatchSize);
+
+    // The whole book reachable from the start, which is as deep as the builder went
+    std::vector<double> expand_ms;
+    OpeningTree tree;
+    for (uint64_t run = 0; run < std::max<uint64_t>(options.Runs, 1); ++run) {
+        Board board = start_board();
+        auto start = BenchClock::now();
+        tree = expand_tree(index, board, static_cast<int>(options.Depth));
+        expand_ms.push_back(elapsed_ns(start) / 1e6);
+    }
+    double expand_median = median(expand_ms);
+    double nodes_per_second = expand_median > 0 ? tree.size() * 1e3 / expand_median : 0.0;
+    uint64_t tree_mismatches = mismatched_tree_keys(tree, start_board());
+
+    size_t entries = book->size();
+    size_t resident = book->mapped_bytes() + book->index_bytes();
+    double bytes_per_entry = entries > 0 ? static_cast<double>(resident) / entries : 0.0;
+
+    fmt::println("{}: {} entries, load {} ms, {} bytes/entry", backend.Name, entries,
+                 median(load_ms), bytes_per_entry);
+    fmt::println("\tprobe hit {} ns warm, {} ns cold", warm_hit, cold_hit);
+    fmt::println("\tprobe miss {} ns warm, {} ns cold", warm_miss, cold_miss);
+    fmt::println("\tbatched {} ns/key, single {} ns/key", batched.BatchedNs, batched.SingleNs);
+    fmt::println("\texpand {} plies to {} nodes in {} ms ({} nodes/s), {} mismatched keys",
+                 options.Depth, tree.size(), expand_median, nodes_per_second, tree_mismatches);
+
+    json.begin_object();
+    json.field("name", backend.Name);
+    json.field("entries", entries);
+    json.field("sorted", book->sorted());
+    json.field("folded", book->folded());
+
+    json.key("load_ms").begin_object();
+    json.field("median", median(load_ms));
+    json.field("min", *std::min_element(load_ms.begin(), load_ms.end()));
+    json.end_object();
+
+    json.key("memory").begin_object();
+    json.field("mapped_bytes", book->mapped_bytes());
+    json.field("index_bytes", book->index_bytes());
+    json.field("bytes_per_entry", bytes_per_entry);
+    json.end_object();
+
+    json.key("probe_ns").begin_object();
+    json.field("warm_hit", warm_hit);
+    json.field("warm_miss", warm_miss);
+    json.field("cold_hit", cold_hit);
+    json.field("cold_miss", cold_miss);
+    json.end_object();
+
+    json.key("batched").begin_object();
+    json.field("batch_size", options.BatchSize);
+    json.field("ns_per_key", batched.BatchedNs);
+    json.field("keys_per_second", batched.BatchedNs > 0 ? 1e9 / batched.BatchedNs : 0.0);
+    json.field("single_ns_per_key", batched.SingleNs);
+    json.end_object();
+
+    json.key("expand").begin_object();
+    json.field("plies", options.Depth);
+    json.field("nodes", tree.size());
+    json.field("median_ms", expand_median);
+    json.field("nodes_per_second", nodes_per_second);
+    json.field("mismatches", tree_mismatches);
+    json.end_object();
+
+    json.end_object();
+
+    if (tree_mismatches > 0) {
+        return Res::Err(fmt::interpolate("{} expanded {} nodes under the wrong key", backend.Name,
+                                         tree_mismatches));
+    }
+    return Res::Ok();
+}
+
+// ================ CHILD KEYS ================
+
+// Random walks start from each of these in turn, so besides ordinary play they reach Chess960
+// castling, en passant, promotions and captures of rooks that still have castling rights
+static const std::array<std::pair<std::string_view, bool>, 7> KEY_WALK_STARTS = {{
+    {constants::STARTPOS, false},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", false},
+    {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", false},
+    {"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1", false},
+    {"bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", true},
+    {"1rqbkrbn/1ppppp1p/1n6/p1N3p1/8/2P4P/PP1PPPP1/1RQBKRBN w FBfb - 0 9", true},
+    {"rbbqn1kr/pp2p1pp/6n1/2pp1p2/2P4P/P7/BP1PPPP1/R1BQNNKR w HAha - 0 9", true},
+}};
+
+struct ChildKeyCounts {
+    uint64_t Moves = 0;
+    uint64_t Castles = 0;
+    uint64_t EnPassants = 0;
+    uint64_t Promotions = 0;
+    uint64_t Mismatches = 0;
+    double ChildKeyNs = 0;
+    double MakeMoveNs = 0;
+};
+
+/// Checks child_key against the hash makeMove leaves for every legal move of random positions,
+/// timing both. Expanding a tree only asserts the two agree, and only in debug builds.
+static Result<void, std::string> bench_child_keys(const BenchOptions& options, JsonWriter& json) {
+    PROFILE_FUNCTION();
+    using Res = Result<void, std::string>;
+    constexpr uint64_t MAX_PLIES = 80;
+    std::mt19937_64 rng(options.Seed);
+    ChildKeyCounts counts;
+
+    size_t start_idx = 0;
+    Board board(KEY_WALK_STARTS[0].first, KEY_WALK_STARTS[0].second);
+    Movelist moves;
+    std::vector<uint64_t> keys;
+    uint64_t plies = 0;
+    for (uint64_t position = 0; position < options.KeyPositions;) {
+        movegen::legalmoves(moves, board);
+        if (moves.empty() || plies == MAX_PLIES) {
+            start_idx = (start_idx + 1) % KEY_WALK_STARTS.size();
+            board = Board(KEY_WALK_STARTS[start_idx].first, KEY_WALK_STARTS[start_idx].second);
+            plies = 0;
+            continue;
+        }
+
+        keys.resize(moves.size());
+        auto start = BenchClock::now();
+        for (int i = 0; i < moves.size(); ++i) {
+            keys[i] = child_key(board, moves[i]);
+        }
+        counts.ChildKeyNs += elapsed_ns(start);
+
+        start = BenchClock::now();
+        for (int i = 0; i < moves.size(); ++i) {
+            board.makeMove(moves[i]);
+            counts.Mismatches += board.hash() != keys[i];
+            board.unmakeMove(moves[i]);
+        }
+        counts.MakeMoveNs += elapsed_ns(start);
+
+        for (const auto& move : moves) {
+            counts.Castles += move.typeOf() == Move::CASTLING;
+            counts.EnPassants += move.typeOf() == Move::ENPASSANT;
+            counts.Promotions += move.typeOf() == Move::PROMOTION;
+        }
+        counts.Moves += moves.size();
+
+        board.makeMove(moves[rng() % moves.size()]);
+        plies++;
+        position++;
+    }
+
+    double moves_count = static_cast<double>(std::max<uint64_t>(counts.Moves, 1));
+    fmt::println("child keys: {} moves ({} castles, {} en passant, {} promotions), {} mismatches",
+                 counts.Moves, counts.Castles, counts.EnPassants, counts.Promotions,
+                 counts.Mismatches);
+    fmt::println("	child_key {} ns/move, makeMove and hash {} ns/move",
+                 counts.ChildKeyNs / moves_count, counts.MakeMoveNs / moves_count);
+
+    json.key("child_keys").begin_object();
+    json.field("positions", options.KeyPositions);
+    json.field("moves", counts.Moves);
+    json.field("castles", counts.Castles);
+    json.field("en_passants", counts.EnPassants);
+    json.field("promotions", counts.Promotions);
+    json.field("mismatches", counts.Mismatches);
+    json.field("child_key_ns", counts.ChildKeyNs / moves_count);
+    json.field("make_move_ns", counts.MakeMoveNs / moves_count);
+    json.end_object();
+
+    if (counts.Mismatches > 0) {
+        return Res::Err(
+            fmt::interpolate("child_key disagreed with makeMove on {} moves", counts.Mismatches));
+    }
+    return Res::Ok();
+}
+
+// ================ PACKED BOARDS ================
+
+/// Packs the positions of random legal games, restarting whenever one ends or runs long
+static std::vector<PackedBoard> sample_positions(uint64_t count, uint64_t seed) {
+    constexpr uint64_t MAX_PLIES = 160;
+    std::mt19937_64 rng(seed);
+    std::vector<PackedBoard> positions;
+    positions.reserve(count);
+
+    Board board;
+    Movelist moves;
+    uint64_t plies = 0;
+    while (positions.size() < count) {
+        movegen::legalmoves(moves, board);
+        if (moves.empty() || plies == MAX_PLIES) {
+            board = start_board();
+            plies = 0;
+            continue;
+        }
+
+        board.makeMove(moves[rng() % moves.size()]);
+        plies++;
+        positions.push_back(Board::Compact::encode(board));
+    }
+
+    return positions;
+}
+
+static bool unpacked_matches(const Board& board, const UnpackedBoard& unpacked) {
+    for (int piece = 0; piece < 12; ++piece) {
+        Piece p(static_cast<Piece::underlying>(piece));
+        if (board.pieces(p.type(), p.color()) != unpacked.Pieces[piece]) {
+            return false;
+        }
+    }
+
+    Bitboard castling_rooks;
+    for (auto color : {Color::WHITE, Color::BLACK}) {
+        for (auto side : {Board::CastlingRights::Side::KING_SIDE,
+                          Board::CastlingRights::Side::QUEEN_SIDE}) {
+            File file = board.castlingRights().getRookFile(color, side);
+            if (file != File::NO_FILE) {
+                auto rank = color == Color::WHITE ? Rank::RANK_1 : Rank::RANK_8;
+                castling_rooks |= Bitboard::fromSquare(Square(file, rank));
+            }
+        }
+    }
+
+    return board.occ() == unpacked.Occupancy && castling_rooks == unpacked.CastlingRooks &&
+           board.enpassantSq() == unpacked.EnPassant &&
+           board.sideToMove() == unpacked.SideToMove;
+}
+
+/// Times a pass over every position, keeping the fastest of the runs in ns per board
+template <typename Pass>
+static double best_ns_per_board(uint64_t runs, size_t boards, Pass pass) {
+    double best = std::numeric_limits<double>::infinity();
+    for (uint64_t run = 0; run < std::max<uint64_t>(runs, 1); ++run) {
+        auto start = BenchClock::now();
+        pass();
+        best = std::min(best, elapsed_ns(start) / static_cast<double>(std::max<size_t>(boards, 1)));
+    }
+    return best;
+}
+
+/// Replays the corpus twice through the builder's visitor and counts the heap allocations of each
+/// pass. The second should make none, since every buffer has grown to fit the largest game by then.
+static Result<void, std::string> bench_allocations(const std::filesystem::path& corpus_path,
+                                                   const std::filesystem::path& book_path,
+                                                   const BenchOptions& options, JsonWriter& json) {
+    PROFILE_FUNCTION();
+    using Res = Result<void, std::string>;
+    auto opened = MappedFile::open(corpus_path);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+
+    auto corpus = opened.unwrap();
+    std::string_view text(reinterpret_cast<const char*>(corpus->data()), corpus->size());
+    auto games = scan_games(text, 1);
+
+    std::array<uint64_t, 2> allocations = {0, 0};
+    {
+        BuildStats stats;
+        PGNVisitor visitor(options.Depth, book_path.string(), stats.register_thread());
+        GameParser parser;
+        for (auto& pass : allocations) {
+            uint64_t before = thread_allocations();
+            for (const auto& game : games) {
+                parser.parse(game_text(text, game.Offset), visitor);
+            }
+            pass = thread_allocations() - before;
+        }
+    }
+
+    double games_count = static_cast<double>(std::max<size_t>(games.size(), 1));
+    fmt::println("allocations: {} per game on the first pass, {} per game after",
+                 allocations[0] / games_count, allocations[1] / games_count);
+
+    json.key("allocations").begin_object();
+    json.field("games", games.size());
+    json.field("first_pass", allocations[0]);
+    json.field("steady_state", allocations[1]);
+    json.field("steady_state_per_game", allocations[1] / games_count);
+    json.end_object();
+    return Res::Ok();
+}
+
+/// Records wins into a sample of the merged book's moves through BookLearner, then reads every
+/// touched move back through a Book sharing the file, which must see each update without a reload
+static Result<void, std::string> bench_learn(const std::filesystem::path& book_path,
+                                             const BenchOptions& options, JsonWriter& json) {
+    PROFILE_FUNCTION();
+    using Res = Result<void, std::string>;
+
+    auto& book = Book::instance();
+    if (auto loaded = book.load({{book_path}}); loaded.is_err()) {
+        return Res::Err(loaded.unwrap_err());
+    }
+    auto opened = BookLearner::open(book_path);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+    auto learner = opened.unwrap();
+
+    const auto& mapped = *book.snapshot()->books().front();
+    std::mt19937_64 rng(options.Seed);
+    std::vector<LearnUpdate> updates;
+    // A learner only opens books holding each move of a key once, so entries identify moves
+    std::unordered_map<size_t, PolyEntry> expected;
+    for (uint64_t i = 0; i < options.Probes && mapped.size() > 0; ++i) {
+        size_t idx = rng() % mapped.size();
+        auto entry = mapped.entry_at(idx);
+        updates.push_back({entry.key, entry.move, GameOutcome::Win, 1});
+
+        auto [it, inserted] = expected.try_emplace(idx, entry);
+        auto& want = it->second;
+        want.weight = static_cast<uint16_t>(std::min<int>(want.weight + 1, UINT16_MAX));
+        want.learn = static_cast<uint16_t>(
+            static_cast<int16_t>(std::min<int>(static_cast<int16_t>(want.learn) + 1, 32767)));
+    }
+
+    auto start = BenchClock::now();
+    size_t recorded = learner->record(updates);
+    double record_ns = elapsed_ns(start) / std::max<double>(static_cast<double>(updates.size()), 1);
+
+    uint64_t mismatches = updates.size() - recorded;
+    for (const auto& [_, want] : expected) {
+        auto moves = book.snapshot()->probe(want.key);
+        auto probed = std::find_if(moves.begin(), moves.end(),
+                                   [&](const BookMove& m) { return m.Compact == want.move; });
+        auto found = learner->find(want.key, want.move);
+        if (probed == moves.end() || probed->Frequency != want.weight || found.is_none() ||
+            found.unwrap().Learn != want.learn) {
+            mismatches += 1;
+        }
+    }
+
+    fmt::println("learn: {} updates to {} moves, {} ns/update, {} mismatches", updates.size(),
+                 expected.size(), record_ns, mismatches);
+
+    json.key("learn").begin_object();
+    json.field("updates", updates.size());
+    json.field("moves", expected.size());
+    json.field("record_ns", record_ns);
+    json.field("mismatches", mismatches);
+    json.end_object();
+
+    // Unmaps the book again, the bench may delete it afterwards
+    (void)book.load({});
+    if (mismatches > 0) {
+        return Res::Err(fmt::interpolate("{} learned moves did not read back", mismatches));
+    }
+    return Res::Ok();
+}
+
+/// Compares Board::Compact one board at a time against the batch kernels, checking that every
+/// kernel agrees with it bit for bit
+static void bench_packed(const BenchOptions& options, JsonWriter& json) {
+    PROFILE_FUNCTION();
+    auto positions = sample_positions(options.PackedBoards, options.Seed);
+
+    std::vector<Board> boards;
+    boards.reserve(positions.size());
+    for (const auto& packed : positions) {
+        boards.push_back(Board::Compact::decode(packed));
+    }
+
+    std::vector<PackedBoard> encoded(positions.size());
+    std::vector<UnpackedBoard> decoded(positions.size());
+
+    double scalar_encode = best_ns_per_board(options.Runs, boards.size(), [&] {
+        for (size_t i = 0; i < boards.size(); ++i) {
+            encoded[i] = Board::Compact::encode(boards[i]);
+        }
+        consume(encoded.back()[8]);
+    });
+    double scalar_decode = best_ns_per_board(options.Runs, positions.size(), [&] {
+        uint64_t sink = 0;
+        for (const auto& packed : positions) {
+            sink += Board::Compact::decode(packed).occ().getBits();
+        }
+        consume(sink);
+    });
+
+    std::vector<std::pair<std::string, PackedKernel>> kernels = {
+        {"portable", PackedKernel::Portable}};
+    if (resolve_packed_kernel(PackedKernel::Bmi2) == PackedKernel::Bmi2) {
+        kernels.push_back({"bmi2", PackedKernel::Bmi2});
+    }
+
+    fmt::println("packed: {} boards, scalar encode {} ns, decode {} ns", positions.size(),
+                 scalar_encode, scalar_decode);
+
+    json.key("packed").begin_object();
+    json.field("boards", positions.size());
+    json.field("auto_kernel",
+               resolve_packed_kernel(PackedKernel::Auto) == PackedKernel::Bmi2 ? "bmi2"
+                                                                              : "portable");
+    json.key("scalar").begin_object();
+    json.field("encode_ns", scalar_encode);
+    json.field("decode_ns", scalar_decode);
+    json.end_object();
+
+    json.key("kernels").begin_array();
+    for (const auto& [name, kernel] : kernels) {
+        double encode_ns = best_ns_per_board(options.Runs, boards.size(), [&] {
+            encode_packed(boards, encoded, kernel);
+            consume(encoded.back()[8]);
+        });
+        double decode_ns = best_ns_per_board(options.Runs, positions.size(), [&] {
+            decode_packed(positions, decoded, kernel);
+            consume(decoded.back().Occupancy.getBits());
+        });
+
+        uint64_t mismatches = 0;
+        for (size_t i = 0; i < positions.size(); ++i) {
+            mismatches += encoded[i] != positions[i] || !unpacked_matches(boards[i], decoded[i]);
+        }
+
+        fmt::println("\t{}: encode {} ns ({}x), decode {} ns ({}x), {} mismatches", name,
+                     encode_ns, scalar_encode / encode_ns, decode_ns, scalar_decode / decode_ns,
+                     mismatches);
+
+        json.begin_object();
+        json.field("name", name);
+        json.field("encode_ns", encode_ns);
+        json.field("decode_ns", decode_ns);
+        json.field("encode_speedup", scalar_encode / encode_ns);
+        json.field("decode_speedup", scalar_decode / decode_ns);
+        json.field("mismatches", mismatches);
+        json.end_object();
+    }
+    json.end_array();
+    json.end_object();
+}
+
+int run_bench(const BenchOptions& options, const std::string& output_file) {
+    PROFILE_FUNCTION();
+    auto work_dir = options.WorkDir.empty()
+                        ? std::filesystem::temp_directory_path() / "horizon-bench"
+                        : options.WorkDir;
+
+    std::error_code ec;
+    std::filesystem::create_directories(work_dir, ec);
+    if (ec) {
+        fmt::eprintln("Failed to create {}: {}", work_dir.string(), ec.message());
+        return 1;
+    }
+
+    auto corpus_path = work_dir / "corpus.pgn";
+    auto unsorted_path = work_dir / "book-unsorted.bin";
+    auto sorted_path = work_dir / "book-sorted.bin";
+    auto merged_path = work_dir / "book-merged.bin";
+
+    CorpusOptions corpus_options;
+    corpus_options.Games = options.Games;
+    corpus_options.Seed = options.Seed;
+
+    auto generated = write_synthetic_corpus(corpus_path, corpus_options);
+    if (generated.is_err()) {
+        fmt::eprintln(generated.unwrap_err());
+        return 1;
+    }
+    auto corpus = generated.unwrap();
+
+    // The builder writes entries in game order, which is the permuted backend's input as is
+    std::vector<double> build_seconds;
+    for (uint64_t run = 0; run < std::max<uint64_t>(options.Runs, 1); ++run) {
+        auto start = BenchClock::now();
+        int depth = static_cast<int>(options.Depth);
+        if (make_book(depth, {corpus_path}, unsorted_path.string()) != 0) {
+            fmt::eprintln("Failed to build {}", unsorted_path.string());
+            return 1;
+        }
+        build_seconds.push_back(elapsed_ns(start) / 1e9);
+    }
+
+    if (!write_sorted_copy(unsorted_path, sorted_path)) {
+        fmt::eprintln("Failed to write {}", sorted_path.string());
+        return 1;
+    }
+
+    if (merge_books({{sorted_path}}, {}, merged_path.string()) != 0) {
+        return 1;
+    }
+
+    double seconds = median(build_seconds);
+    double games_per_second = seconds > 0 ? corpus.Games / seconds : 0.0;
+    double mb_per_second = seconds > 0 ? corpus.Bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    double positions_per_second = seconds > 0 ? corpus.Plies / seconds : 0.0;
+
+    fmt::println("build: {} games, {} positions, {} bytes in {} s", corpus.Games, corpus.Plies,
+                 corpus.Bytes, seconds);
+    fmt::println("\t{} games/s, {} MB/s, {} positions/s", games_per_second, mb_per_second,
+                 positions_per_second);
+
+    JsonWriter json;
+    json.begin_object();
+
+    json.key("meta").begin_object();
+    json.field("config", build_config());
+#ifdef __VERSION__
+    json.field("compiler", __VERSION__);
+#endif
+    json.field("hardware_threads", std::thread::hardware_concurrency());
+    // Picked by chess.hpp at startup, PEXT where the CPU has a fast one
+    json.field("sliders",
+               attacks::sliderLookup() == attacks::SliderLookup::PEXT ? "pext" : "magic");
+    json.field("seed", options.Seed);
+    json.field("games", options.Games);
+    json.field("depth", options.Depth);
+    json.field("runs", options.Runs);
+    json.field("probes", options.Probes);
+    json.field("cold_probes", options.ColdProbes);
+    json.field("packed_boards", options.PackedBoards);
+    json.end_object();
+
+    json.key("build").begin_object();
+    json.field("corpus_bytes", corpus.Bytes);
+    json.field("games", corpus.Games);
+    json.field("positions", corpus.Plies);
+    json.field("seconds_median", seconds);
+    json.field("seconds_min", *std::min_element(build_seconds.begin(), build_seconds.end()));
+    json.field("games_per_second", games_per_second);
+    json.field("mb_per_second", mb_per_second);
+    json.field("positions_per_second", positions_per_second);
+    json.end_object();
+
+    // Raw builder output indexed through a permutation of its folded runs, the same entries sorted
+    // in place, and the deduplicated book a merge produces from them
+    const std::array<BookBackend, 3> backends = {{
+        {"mmap-permuted", unsorted_path},
+        {"mmap-sorted", sorted_path},
+        {"mmap-merged", merged_path},
+    }};
+
+    CacheFlusher flusher;
+    json.key("backends").begin_array();
+    for (const auto& backend : backends) {
+        if (auto result = bench_backend(backend, options, flusher, json); result.is_err()) {
+            fmt::eprintln(result.unwrap_err());
+            return 1;
+        }
+    }
+    json.end_array();
+
+    // Runs last among the book benches, as it changes the merged book's weights
+    if (auto learned = bench_learn(merged_path, options, json); learned.is_err()) {
+        fmt::eprintln(learned.unwrap_err());
+        return 1;
+    }
+
+    if constexpr (ALLOCATIONS_COUNTED) {
+        auto allocations_path = work_dir / "book-allocations.bin";
+        auto allocations = bench_allocations(corpus_path, allocations_path, options, json);
+        std::filesystem::remove(allocations_path, ec);
+        if (allocations.is_err()) {
+            fmt::eprintln(allocations.unwrap_err());
+            return 1;
+        }
+    } else {
+        fmt::println("allocations: skipped, only `make bench` builds count them");
+    }
+
+    if (options.KeyPositions > 0) {
+        if (auto checked = bench_child_keys(options, json); checked.is_err()) {
+            fmt::eprintln(checked.unwrap_err());
+            return 1;
+        }
+    }
+
+    if (options.PackedBoards > 0) {
+        bench_packed(options, json);
+    }
+    json.end_object();
+
+    if (!options.Keep) {
+        for (const auto& path : {corpus_path, unsorted_path, sorted_path, merged_path}) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    if (!json.save(output_file)) {
+        fmt::eprintln("Failed to write {}", output_file);
+        return 1;
+    }
+
+    fmt::println("Wrote results to {}", output_file);
+    return 0;
+}
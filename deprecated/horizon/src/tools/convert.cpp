@@ -0,0 +1,273 @@
+#include <pch.hpp>
+
+#include "tools/convert.hpp"
+
+#include "core/concurrent.hpp"
+#include "core/membuf.hpp"
+#include "core/mmap.hpp"
+#include "core/split.hpp"
+
+constexpr size_t CONVERT_CHUNK_BYTES = 4 * 1024 * 1024;
+
+struct ConvertRecord {
+    uint64_t Key;
+    // The 0-based line or game number within its chunk
+    uint64_t Number;
+    // Where the record's text ends in the chunk output
+    size_t End;
+};
+
+/// A slice of the input starting on a record boundary, converted independently of the others
+struct ConvertChunk {
+    std::string_view Input;
+    std::string Output;
+    std::vector<ConvertRecord> Records;
+
+    // Lines or games seen, including those which produced no record
+    uint64_t Count = 0;
+    uint64_t Skipped = 0;
+
+    // Filled in once every chunk is converted
+    uint64_t FirstNumber = 0;
+    uint64_t FirstOrdinal = 0;
+    std::vector<uint64_t> Duplicates;
+
+    std::string Error;
+    uint64_t ErrorNumber = 0;
+};
+
+static std::string_view trim(std::string_view text) {
+    auto is_space = [](char c) { return std::isspace(static_cast<unsigned char>(c)); };
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+static void convert_epd_chunk(ConvertChunk& chunk) {
+    PROFILE_FUNCTION();
+    Board board;
+    chunk.Output.reserve(chunk.Input.size() * 2);
+
+    for (size_t pos = 0; pos < chunk.Input.size();) {
+        size_t end = next_line_offset(chunk.Input, pos);
+        auto line = trim(chunk.Input.substr(pos, end - pos));
+        uint64_t number = chunk.Count++;
+        pos = end;
+
+        if (line.empty()) {
+            continue;
+        } else if (line.find(';') != std::string_view::npos) {
+            chunk.Error = "Expected fens with or without move counters, found epd operations";
+            chunk.ErrorNumber = number;
+            return;
+        } else if (!board.setFen(line)) {
+            chunk.Error = "Invalid fen";
+            chunk.ErrorNumber = number;
+            return;
+        }
+
+        chunk.Output += "[FEN \"";
+        chunk.Output += line;
+        chunk.Output += "\"]\n[Result \"*\"]\n\n*\n\n";
+        chunk.Records.push_back({board.hash(), number, chunk.Output.size()});
+    }
+}
+
+/// Plays every game up to the target ply and records the position it reaches
+class EpdVisitor : public pgn::Visitor {
+  private:
+    ConvertChunk& m_Chunk;
+    uint64_t m_TargetPlies;
+
+    Board m_Board;
+    uint64_t m_Plies;
+    bool m_Valid;
+
+  public:
+    EpdVisitor(ConvertChunk& chunk, uint64_t target_plies)
+        : m_Chunk(chunk), m_TargetPlies(target_plies), m_Plies(0), m_Valid(true) {}
+
+    void startPgn() override {
+        m_Board = start_board();
+        m_Plies = 0;
+        m_Valid = true;
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "FEN") {
+            m_Valid = m_Board.setFen(trim(value));
+        }
+    }
+
+    void startMoves() override {}
+
+    void move(std::string_view move, [[maybe_unused]] std::string_view comment) override {
+        // Comments before the first move arrive without one
+        if (move.empty()) {
+            return;
+        } else if (!m_Valid) {
+            skipPgn(true);
+            return;
+        }
+
+        Move parsed_move = uci::parseSan(m_Board, move);
+        if (parsed_move == Move::NO_MOVE) {
+            m_Valid = false;
+            skipPgn(true);
+            return;
+        }
+
+        m_Board.makeMove(parsed_move);
+        if (++m_Plies == m_TargetPlies) {
+            skipPgn(true);
+        }
+    }
+
+    void endPgn() override {
+        uint64_t number = m_Chunk.Count++;
+        if (!m_Valid || m_Plies < m_TargetPlies) {
+            m_Chunk.Skipped++;
+            return;
+        }
+
+        // makeMove keeps en passant squares which setFen drops when no capture is legal, so the
+        // position is reloaded to write and hash it the same way as an epd line
+        m_Board.setFen(m_Board.getFen(false));
+        m_Chunk.Output += m_Board.getFen(false);
+        m_Chunk.Output += '\n';
+        m_Chunk.Records.push_back({m_Board.hash(), number, m_Chunk.Output.size()});
+    }
+};
+
+static void convert_pgn_chunk(ConvertChunk& chunk, uint64_t target_plies) {
+    PROFILE_FUNCTION();
+    MemoryBuf buffer(chunk.Input);
+    std::istream stream(&buffer);
+
+    EpdVisitor visitor(chunk, target_plies);
+    pgn::StreamParser parser(stream);
+    auto error = parser.readGames(visitor);
+    if (error.hasError()) {
+        chunk.Error = error.message();
+        chunk.ErrorNumber = chunk.Count;
+    }
+}
+
+/// Drops every record but the first of each position from the chunk output, keeping the rest in
+/// order
+static void remove_duplicates(ConvertChunk& chunk, const ConcurrentMinTable& table) {
+    std::string kept;
+    kept.reserve(chunk.Output.size());
+
+    size_t begin = 0;
+    for (size_t i = 0; i < chunk.Records.size(); ++i) {
+        const auto& record = chunk.Records[i];
+        if (table.min_value(record.Key) == chunk.FirstOrdinal + i) {
+            kept.append(chunk.Output, begin, record.End - begin);
+        }
+        begin = record.End;
+    }
+
+    chunk.Output = std::move(kept);
+}
+
+/// Converts every chunk in parallel, then finds the first occurrence of each position through a
+/// table shared by all threads and writes the chunks out in input order
+template <typename ConvertChunkFn>
+static Result<ConvertStats, std::string>
+convert(const std::filesystem::path& input, const std::filesystem::path& output,
+        const ConvertOptions& options, bool by_line, ConvertChunkFn convert_chunk) {
+    PROFILE_FUNCTION();
+    using Res = Result<ConvertStats, std::string>;
+
+    auto opened = MappedFile::open(input);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+
+    auto mapped = opened.unwrap();
+    mapped->advise_sequential();
+    std::string_view text(reinterpret_cast<const char*>(mapped->data()), mapped->size());
+
+    std::vector<ConvertChunk> chunks;
+    for (auto slice : split_records(text, CONVERT_CHUNK_BYTES,
+                                    by_line ? next_line_offset : next_game_offset)) {
+        chunks.emplace_back().Input = slice;
+    }
+
+    uint64_t threads = worker_count(options.Threads);
+    parallel_for_each(std::span(chunks), threads, convert_chunk);
+
+    ConvertStats stats;
+    uint64_t numbers = 0;
+    for (auto& chunk : chunks) {
+        chunk.FirstNumber = numbers;
+        chunk.FirstOrdinal = stats.Records;
+
+        if (!chunk.Error.empty()) {
+            return Res::Err(fmt::interpolate("{}:{}: {}", input.string(),
+                                             chunk.FirstNumber + chunk.ErrorNumber + 1,
+                                             chunk.Error));
+        }
+
+        numbers += chunk.Count;
+        stats.Records += chunk.Records.size();
+        stats.Skipped += chunk.Skipped;
+    }
+
+    ConcurrentMinTable table(stats.Records);
+    parallel_for_each(std::span(chunks), threads, [&](ConvertChunk& chunk) {
+        for (size_t i = 0; i < chunk.Records.size(); ++i) {
+            table.insert(chunk.Records[i].Key, chunk.FirstOrdinal + i);
+        }
+    });
+
+    parallel_for_each(std::span(chunks), threads, [&](ConvertChunk& chunk) {
+        for (size_t i = 0; i < chunk.Records.size(); ++i) {
+            const auto& record = chunk.Records[i];
+            if (table.min_value(record.Key) != chunk.FirstOrdinal + i) {
+                chunk.Duplicates.push_back(chunk.FirstNumber + record.Number + 1);
+            }
+        }
+
+        if (options.Unique && !chunk.Duplicates.empty()) {
+            remove_duplicates(chunk, table);
+        }
+    });
+
+    std::ofstream out(output, std::ios::binary);
+    if (!out) {
+        return Res::Err(fmt::interpolate("Failed to open {}", output.string()));
+    }
+
+    for (const auto& chunk : chunks) {
+        out.write(chunk.Output.data(), static_cast<std::streamsize>(chunk.Output.size()));
+        stats.Duplicates.insert(stats.Duplicates.end(), chunk.Duplicates.begin(),
+                                chunk.Duplicates.end());
+    }
+
+    if (!out) {
+        return Res::Err(fmt::interpolate("Failed to write {}", output.string()));
+    }
+
+    stats.Written = stats.Records - (options.Unique ? stats.Duplicates.size() : 0);
+    return Res(stats);
+}
+
+Result<ConvertStats, std::string> epd_to_pgn(const std::filesystem::path& input,
+                                             const std::filesystem::path& output,
+                                             const ConvertOptions& options) {
+    return convert(input, output, options, true, convert_epd_chunk);
+}
+
+Result<ConvertStats, std::string> pgn_to_epd(const std::filesystem::path& input,
+                                             const std::filesystem::path& output,
+                                             const ConvertOptions& options) {
+    uint64_t target_plies = options.Depth * 2;
+    return convert(input, output, options, false,
+                   [target_plies](ConvertChunk& chunk) { convert_pgn_chunk(chunk, target_plies); });
+}
@@ -0,0 +1,387 @@
+#include <pch.hpp>
+
+#include "tools/corpus.hpp"
+
+#include "core/rng.hpp"
+
+constexpr uint64_t CORPUS_CHUNK_GAMES = 256;
+// How many finished chunks each worker may get ahead of the writer before it waits
+constexpr uint64_t CORPUS_CHUNKS_IN_FLIGHT = 4;
+
+constexpr size_t MOVETEXT_WIDTH = 80;
+
+constexpr int CLOCK_BASE_SECONDS = 180;
+constexpr int CLOCK_INCREMENT_SECONDS = 2;
+constexpr int EVAL_LIMIT_CENTIPAWNS = 1500;
+
+/// Cumulative zipf weights over move ranks, shared read-only by every worker
+class OpeningSkew {
+  private:
+    std::array<double, constants::MAX_MOVES> m_Cumulative;
+
+  public:
+    explicit OpeningSkew(double exponent) {
+        double total = 0.0;
+        for (size_t rank = 0; rank < m_Cumulative.size(); ++rank) {
+            total += std::pow(static_cast<double>(rank + 1), -std::max(exponent, 0.0));
+            m_Cumulative[rank] = total;
+        }
+    }
+
+    size_t pick(SplitMixRng& rng, size_t choices) const {
+        double target = rng.uniform() * m_Cumulative[choices - 1];
+        auto it = std::upper_bound(m_Cumulative.begin(), m_Cumulative.begin() + choices, target);
+        return std::min(static_cast<size_t>(it - m_Cumulative.begin()), choices - 1);
+    }
+};
+
+struct CorpusChunk {
+    std::string Text;
+    uint64_t Games = 0;
+    uint64_t Plies = 0;
+};
+
+static uint64_t sample_plies(SplitMixRng& rng, const CorpusOptions& options) {
+    auto lo = static_cast<double>(options.MinPlies);
+    auto hi = static_cast<double>(std::max(options.MaxPlies, options.MinPlies));
+    if (hi == lo) {
+        return options.MinPlies;
+    }
+
+    // The mode of a triangular distribution is three times its mean minus both bounds
+    double mode = std::clamp(3.0 * static_cast<double>(options.MeanPlies) - lo - hi, lo, hi);
+    double u = rng.uniform();
+    double x = u < (mode - lo) / (hi - lo) ? lo + std::sqrt(u * (hi - lo) * (mode - lo))
+                                           : hi - std::sqrt((1.0 - u) * (hi - lo) * (hi - mode));
+    return static_cast<uint64_t>(std::llround(x));
+}
+
+static void append_clock(std::string& out, int seconds) {
+    out += std::to_string(seconds / 3600);
+    out += ':';
+    out += static_cast<char>('0' + (seconds / 600) % 6);
+    out += static_cast<char>('0' + (seconds / 60) % 10);
+    out += ':';
+    out += static_cast<char>('0' + (seconds % 60) / 10);
+    out += static_cast<char>('0' + seconds % 10);
+}
+
+static void append_eval(std::string& out, int centipawns) {
+    int magnitude = std::abs(centipawns);
+    if (centipawns < 0) {
+        out += '-';
+    }
+    out += std::to_string(magnitude / 100);
+    out += '.';
+    out += static_cast<char>('0' + (magnitude / 10) % 10);
+    out += static_cast<char>('0' + magnitude % 10);
+}
+
+static void append_square(std::string& out, Square square) {
+    out += static_cast<char>('a' + (square.index() & 7));
+    out += static_cast<char>('1' + (square.index() >> 3));
+}
+
+/// Appends the san of a move without its check suffix. This matches uci::moveToSan but reuses
+/// the legal moves already generated for the position instead of copying the board to find them.
+static void append_san(std::string& out, const Board& board, const Movelist& legal, Move move) {
+    constexpr std::string_view piece_symbols = "PNBRQK";
+
+    if (move.typeOf() == Move::CASTLING) {
+        out += move.to() > move.from() ? "O-O" : "O-O-O";
+        return;
+    }
+
+    const auto piece = board.at(move.from()).type();
+    const bool capture = board.at(move.to()) != Piece::NONE || move.typeOf() == Move::ENPASSANT;
+
+    if (piece == PieceType::PAWN) {
+        if (capture) {
+            out += static_cast<char>('a' + (move.from().index() & 7));
+        }
+    } else {
+        out += piece_symbols[static_cast<int>(piece)];
+
+        bool ambiguous = false;
+        bool shares_file = false;
+        bool shares_rank = false;
+        for (const auto& other : legal) {
+            if (other == move || other.to() != move.to() || other.typeOf() == Move::CASTLING ||
+                board.at(other.from()).type() != piece) {
+                continue;
+            }
+
+            ambiguous = true;
+            shares_file |= other.from().file() == move.from().file();
+            shares_rank |= other.from().rank() == move.from().rank();
+        }
+
+        if (ambiguous) {
+            if (!shares_file) {
+                out += static_cast<char>('a' + (move.from().index() & 7));
+            } else if (!shares_rank) {
+                out += static_cast<char>('1' + (move.from().index() >> 3));
+            } else {
+                append_square(out, move.from());
+            }
+        }
+    }
+
+    if (capture) {
+        out += 'x';
+    }
+    append_square(out, move.to());
+
+    if (move.typeOf() == Move::PROMOTION) {
+        out += '=';
+        out += piece_symbols[static_cast<int>(move.promotionType())];
+    }
+}
+
+static void write_headers(std::string& out, SplitMixRng& rng, const CorpusOptions& options,
+                          uint64_t index, uint64_t plies, std::string_view result) {
+    auto eco = std::string(1, static_cast<char>('A' + rng.below(5))) +
+               std::to_string(rng.below(100) + 100).substr(1);
+
+    const std::array<std::pair<std::string_view, std::string>, 16> tags = {{
+        {"Event", "Synthetic"},
+        {"Site", "horizon"},
+        {"Date", "????.??.??"},
+        {"Round", std::to_string(index + 1)},
+        {"White", "Player" + std::to_string(rng.below(100000))},
+        {"Black", "Player" + std::to_string(rng.below(100000))},
+        {"Result", std::string(result)},
+        {"WhiteElo", std::to_string(1200 + rng.below(1600))},
+        {"BlackElo", std::to_string(1200 + rng.below(1600))},
+        {"TimeControl",
+         std::to_string(CLOCK_BASE_SECONDS) + "+" + std::to_string(CLOCK_INCREMENT_SECONDS)},
+        {"ECO", eco},
+        {"Termination", "Normal"},
+        {"UTCDate", "????.??.??"},
+        {"UTCTime", "??:??:??"},
+        {"PlyCount", std::to_string(plies)},
+        {"Annotator", "horizon"},
+    }};
+
+    // The parser needs at least one header to find the start of a game
+    uint64_t count = std::max<uint64_t>(options.Headers, 1);
+    for (uint64_t i = 0; i < count; ++i) {
+        out += '[';
+        if (i < tags.size()) {
+            out += tags[i].first;
+            out += " \"";
+            out += tags[i].second;
+        } else {
+            out += "Extra" + std::to_string(i - tags.size() + 1);
+            out += " \"";
+            out += std::to_string(rng.below(1000000));
+        }
+        out += "\"]\n";
+    }
+    out += '\n';
+}
+
+/// Mixes the corpus seed before adding the index, so game i of one seed is not game i-1 of the next
+static constexpr uint64_t game_seed(uint64_t seed, uint64_t index) {
+    return SplitMixRng(seed).next() ^ (index * 0x9E3779B97F4A7C15);
+}
+
+static_assert(game_seed(DEFAULT_CORPUS_SEED + 1, 0) != game_seed(DEFAULT_CORPUS_SEED, 1));
+static_assert(game_seed(DEFAULT_CORPUS_SEED + 1, 1) != game_seed(DEFAULT_CORPUS_SEED, 2));
+
+/// Plays one game seeded from its index and appends its pgn, returning the number of plies played
+static uint64_t write_game(std::string& out, const CorpusOptions& options, const OpeningSkew& skew,
+                           uint64_t index) {
+    SplitMixRng rng(game_seed(options.Seed, index));
+    uint64_t target_plies = sample_plies(rng, options);
+
+    Board board(constants::STARTPOS);
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+
+    std::string movetext;
+    std::string token;
+    size_t line_start = 0;
+
+    std::array<int, 2> clocks = {CLOCK_BASE_SECONDS, CLOCK_BASE_SECONDS};
+    int eval = 20;
+    bool after_comment = false;
+
+    uint64_t ply = 0;
+    for (; ply < target_plies && !moves.empty(); ++ply) {
+        auto choices = static_cast<size_t>(moves.size());
+        auto move = ply < options.OpeningPlies ? moves[skew.pick(rng, choices)]
+                                               : moves[rng.below(choices)];
+
+        token.clear();
+        if (ply % 2 == 0 || after_comment) {
+            token += std::to_string(ply / 2 + 1);
+            token += ply % 2 == 0 ? ". " : "... ";
+        }
+        append_san(token, board, moves, move);
+
+        // The next position's moves are needed anyway, and they tell check from mate
+        board.makeMove(move);
+        moves.clear();
+        movegen::legalmoves(moves, board);
+        if (board.inCheck()) {
+            token += moves.empty() ? '#' : '+';
+        }
+
+        bool with_eval = rng.chance(options.EvalDensity);
+        bool with_clock = rng.chance(options.ClockDensity);
+        eval = std::clamp(eval + static_cast<int>(rng.below(61)) - 30, -EVAL_LIMIT_CENTIPAWNS,
+                          EVAL_LIMIT_CENTIPAWNS);
+        auto& clock = clocks[ply % 2];
+        clock = std::max(clock - static_cast<int>(rng.below(12)), 0) + CLOCK_INCREMENT_SECONDS;
+
+        after_comment = with_eval || with_clock;
+        if (after_comment) {
+            token += " {";
+            if (with_eval) {
+                token += " [%eval ";
+                append_eval(token, eval);
+                token += ']';
+            }
+            if (with_clock) {
+                token += " [%clk ";
+                append_clock(token, clock);
+                token += ']';
+            }
+            token += " }";
+        }
+
+        if (movetext.size() - line_start + token.size() + 1 > MOVETEXT_WIDTH) {
+            movetext += '\n';
+            line_start = movetext.size();
+        } else if (!movetext.empty()) {
+            movetext += ' ';
+        }
+        movetext += token;
+    }
+
+    // Games cut off at their target length still get a decisive or drawn result, extract skips "*"
+    static constexpr std::array<std::string_view, 3> adjudicated = {"1-0", "0-1", "1/2-1/2"};
+    std::string_view result = adjudicated[rng.below(adjudicated.size())];
+    if (moves.empty()) {
+        if (board.inCheck()) {
+            result = board.sideToMove() == Color::WHITE ? "0-1" : "1-0";
+        } else {
+            result = "1/2-1/2";
+        }
+    }
+
+    write_headers(out, rng, options, index, ply, result);
+    out += movetext;
+    out += movetext.empty() ? "" : " ";
+    out += result;
+    out += "\n\n";
+
+    return ply;
+}
+
+static CorpusChunk generate_chunk(const CorpusOptions& options, const OpeningSkew& skew,
+                                  uint64_t first_game, uint64_t last_game) {
+    CorpusChunk chunk;
+    for (uint64_t game = first_game; game < last_game; ++game) {
+        chunk.Plies += write_game(chunk.Text, options, skew, game);
+        chunk.Games += 1;
+    }
+    return chunk;
+}
+
+Result<CorpusStats, std::string> write_synthetic_corpus(const std::filesystem::path& path,
+                                                        const CorpusOptions& options) {
+    using Res = Result<CorpusStats, std::string>;
+    PROFILE_FUNCTION();
+
+    std::ofstream out(path, std::ios::binary | std::ios::out);
+    if (!out.is_open()) {
+        return Res::Err(fmt::interpolate("Failed to open {}", path.string()));
+    }
+
+    // A size target keeps handing out chunks until the writer has seen enough bytes
+    const uint64_t total_chunks =
+        options.TargetBytes > 0 ? UINT64_MAX
+                                : (options.Games + CORPUS_CHUNK_GAMES - 1) / CORPUS_CHUNK_GAMES;
+    const uint64_t last_game = options.TargetBytes > 0 ? UINT64_MAX : options.Games;
+
+    uint64_t num_threads = options.Threads > 0 ? options.Threads
+                                               : std::max(1u, std::thread::hardware_concurrency());
+    const uint64_t in_flight = num_threads * CORPUS_CHUNKS_IN_FLIGHT;
+    const OpeningSkew skew(options.OpeningSkew);
+
+    std::mutex mutex;
+    std::condition_variable signal;
+    std::unordered_map<uint64_t, CorpusChunk> finished;
+    uint64_t next_chunk = 0;
+    uint64_t next_write = 0;
+    bool done = false;
+
+    // Workers claim chunks in order and may finish them out of order, the writer restores it
+    auto worker = [&]() {
+        while (true) {
+            uint64_t chunk_idx;
+            {
+                std::unique_lock lock(mutex);
+                signal.wait(lock, [&] { return done || next_chunk < next_write + in_flight; });
+                if (done || next_chunk >= total_chunks) {
+                    return;
+                }
+                chunk_idx = next_chunk++;
+            }
+
+            uint64_t first = chunk_idx * CORPUS_CHUNK_GAMES;
+            auto chunk = generate_chunk(options, skew, first,
+                                        std::min(first + CORPUS_CHUNK_GAMES, last_game));
+
+            std::lock_guard lock(mutex);
+            finished.emplace(chunk_idx, std::move(chunk));
+            signal.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (uint64_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    CorpusStats stats;
+    for (uint64_t chunk_idx = 0; chunk_idx < total_chunks; ++chunk_idx) {
+        CorpusChunk chunk;
+        {
+            std::unique_lock lock(mutex);
+            signal.wait(lock, [&] { return finished.contains(chunk_idx); });
+            chunk = std::move(finished.at(chunk_idx));
+            finished.erase(chunk_idx);
+        }
+
+        out.write(chunk.Text.data(), static_cast<std::streamsize>(chunk.Text.size()));
+        stats.Games += chunk.Games;
+        stats.Plies += chunk.Plies;
+        stats.Bytes += chunk.Text.size();
+
+        bool reached_target = options.TargetBytes > 0 && stats.Bytes >= options.TargetBytes;
+        std::lock_guard lock(mutex);
+        next_write = chunk_idx + 1;
+        if (!out.good() || reached_target) {
+            break;
+        }
+        signal.notify_all();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        done = true;
+    }
+    signal.notify_all();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    if (!out.good()) {
+        return Res::Err(fmt::interpolate("Failed to write {}", path.string()));
+    }
+
+    return Res(stats);
+}
@@ -0,0 +1,313 @@
+#include <pch.hpp>
+
+#include "tools/extract.hpp"
+
+#include "builder/stats.hpp"
+#include "core/concurrent.hpp"
+#include "core/membuf.hpp"
+#include "core/mmap.hpp"
+#include "core/packed.hpp"
+#include "core/split.hpp"
+
+constexpr size_t EXTRACT_SLICE_BYTES = 4 * 1024 * 1024;
+constexpr size_t TRAINING_CHUNK_HEADER_BYTES = 8;
+
+static inline void put_le16(unsigned char* out, uint16_t value) {
+    out[0] = static_cast<unsigned char>(value & 0xFF);
+    out[1] = static_cast<unsigned char>(value >> 8);
+}
+
+static inline void put_le32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+/// Parses the %eval command of a lichess style comment into centipawns from white's point of view
+static int16_t parse_eval(std::string_view comment) {
+    constexpr std::string_view command = "[%eval ";
+    auto at = comment.find(command);
+    if (at == std::string_view::npos) {
+        return TRAINING_NO_EVAL;
+    }
+
+    auto text = comment.substr(at + command.size());
+    const char* end = text.data() + text.size();
+
+    if (!text.empty() && text.front() == '#') {
+        int moves = 0;
+        auto parsed = std::from_chars(text.data() + 1, end, moves);
+        if (parsed.ec != std::errc() || moves == 0) {
+            return TRAINING_NO_EVAL;
+        }
+        int distance =
+            std::min(std::abs(moves), static_cast<int>(TRAINING_MATE - TRAINING_EVAL_LIMIT));
+        return static_cast<int16_t>(moves > 0 ? TRAINING_MATE - distance
+                                              : distance - TRAINING_MATE);
+    }
+
+    double pawns = 0.0;
+    auto parsed = std::from_chars(text.data(), end, pawns);
+    if (parsed.ec != std::errc()) {
+        return TRAINING_NO_EVAL;
+    }
+
+    auto centipawns = std::clamp<long>(std::lround(pawns * 100.0), -TRAINING_EVAL_LIMIT,
+                                       TRAINING_EVAL_LIMIT);
+    return static_cast<int16_t>(centipawns);
+}
+
+// ================ OUTPUT ================
+
+/// The output file shared by every thread, which only ever receives whole chunks
+class TrainingSink {
+  private:
+    std::mutex m_Mutex;
+    std::ofstream m_File;
+
+  public:
+    bool open(const std::filesystem::path& path) {
+        m_File.open(path, std::ios::binary);
+        if (!m_File) {
+            return false;
+        }
+
+        unsigned char header[16];
+        std::memcpy(header, TRAINING_MAGIC.data(), TRAINING_MAGIC.size());
+        put_le32(header + 8, TRAINING_VERSION);
+        put_le32(header + 12, sizeof(TrainingRecord));
+        m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+        return static_cast<bool>(m_File);
+    }
+
+    void write(const unsigned char* data, size_t size) {
+        std::lock_guard lock(m_Mutex);
+        m_File.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    bool good() {
+        std::lock_guard lock(m_Mutex);
+        m_File.flush();
+        return static_cast<bool>(m_File);
+    }
+};
+
+/// Serializes records into one thread's chunk, handing it to the sink whenever it fills up
+class TrainingChunkWriter {
+  private:
+    TrainingSink& m_Sink;
+    std::vector<unsigned char> m_Bytes;
+    uint32_t m_Count;
+
+  public:
+    explicit TrainingChunkWriter(TrainingSink& sink)
+        : m_Sink(sink),
+          m_Bytes(TRAINING_CHUNK_HEADER_BYTES + TRAINING_CHUNK_RECORDS * sizeof(TrainingRecord)),
+          m_Count(0) {}
+
+    inline void push(const TrainingRecord& record) {
+        unsigned char* out =
+            m_Bytes.data() + TRAINING_CHUNK_HEADER_BYTES + m_Count * sizeof(TrainingRecord);
+        std::memcpy(out, record.Board.data(), record.Board.size());
+        put_le16(out + 24, static_cast<uint16_t>(record.Eval));
+        put_le16(out + 26, record.Ply);
+        out[28] = static_cast<unsigned char>(record.Result);
+        out[29] = record.Flags;
+        put_le16(out + 30, record.Reserved);
+
+        if (++m_Count == TRAINING_CHUNK_RECORDS) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (m_Count == 0) {
+            return;
+        }
+
+        put_le32(m_Bytes.data(), TRAINING_CHUNK_MAGIC);
+        put_le32(m_Bytes.data() + 4, m_Count);
+        m_Sink.write(m_Bytes.data(),
+                     TRAINING_CHUNK_HEADER_BYTES + m_Count * sizeof(TrainingRecord));
+        m_Count = 0;
+    }
+};
+
+// ================ REPLAY ================
+
+struct ExtractWorker {
+    Ref<BuildCounters> Counters;
+    Scope<TrainingChunkWriter> Writer;
+    uint64_t SkippedGames = 0;
+};
+
+/// Replays games and writes every position reached after a move that passes the filters
+class TrainingVisitor : public pgn::Visitor {
+  private:
+    const ExtractOptions& m_Options;
+    ExtractWorker& m_Worker;
+
+    Board m_Board;
+    int8_t m_Result;
+    bool m_HasResult;
+    bool m_Valid;
+
+  public:
+    TrainingVisitor(const ExtractOptions& options, ExtractWorker& worker)
+        : m_Options(options), m_Worker(worker), m_Result(0), m_HasResult(false), m_Valid(true) {}
+
+    void startPgn() override {
+        m_Board = start_board();
+        m_HasResult = false;
+        m_Valid = true;
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "Result") {
+            m_HasResult = true;
+            if (value == "1-0") {
+                m_Result = 1;
+            } else if (value == "0-1") {
+                m_Result = -1;
+            } else if (value == "1/2-1/2") {
+                m_Result = 0;
+            } else {
+                m_HasResult = false;
+            }
+        } else if (key == "FEN") {
+            m_Valid = m_Board.setFen(value);
+        }
+    }
+
+    void startMoves() override {
+        if (!m_HasResult || !m_Valid) {
+            m_Worker.SkippedGames++;
+            skipPgn(true);
+        }
+    }
+
+    void move(std::string_view move, std::string_view comment) override {
+        // Comments before the first move arrive without one
+        if (move.empty()) {
+            return;
+        }
+
+        Move parsed_move = uci::parseSan(m_Board, move);
+        m_Worker.Counters->SanParsed.add(1);
+        if (parsed_move == Move::NO_MOVE) {
+            m_Worker.Counters->IllegalMoves.add(1);
+            skipPgn(true);
+            return;
+        }
+
+        uint8_t flags = m_Board.isCapture(parsed_move) ? TrainingFlags::Capture : 0;
+        m_Board.makeMove(parsed_move);
+        m_Worker.Counters->LegalMoves.add(1);
+
+        auto ply = static_cast<uint64_t>(m_Board.fullMoveNumber() - 1) * 2 +
+                   (m_Board.sideToMove() == Color::BLACK ? 1 : 0);
+        if (ply < m_Options.MinPly) {
+            return;
+        }
+
+        if (m_Board.inCheck()) {
+            flags |= TrainingFlags::InCheck;
+        }
+        if (m_Options.Quiet && (flags & (TrainingFlags::InCheck | TrainingFlags::Capture))) {
+            return;
+        }
+
+        int16_t eval = comment.empty() ? TRAINING_NO_EVAL : parse_eval(comment);
+        if (eval != TRAINING_NO_EVAL) {
+            flags |= TrainingFlags::HasEval;
+        } else if (m_Options.RequireEval) {
+            return;
+        }
+
+        auto stored_ply = static_cast<uint16_t>(std::min<uint64_t>(ply, UINT16_MAX));
+        TrainingRecord record{{}, eval, stored_ply, m_Result, flags, 0};
+        encode_packed(std::span(&m_Board, 1), std::span(&record.Board, 1));
+        m_Worker.Writer->push(record);
+        m_Worker.Counters->EntriesWritten.add(1);
+    }
+
+    void endPgn() override { m_Worker.Counters->Games.add(1); }
+};
+
+Result<ExtractStats, std::string> extract_training_data(
+    const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output,
+    const ExtractOptions& options) {
+    PROFILE_FUNCTION();
+    using Res = Result<ExtractStats, std::string>;
+
+    // Every file is mapped up front so slices of all of them share one queue
+    std::vector<Ref<MappedFile>> mapped;
+    std::vector<std::string_view> slices;
+    for (const auto& input : inputs) {
+        auto opened = MappedFile::open(input);
+        if (opened.is_err()) {
+            return Res::Err(opened.unwrap_err());
+        }
+
+        auto file = opened.unwrap();
+        file->advise_sequential();
+        std::string_view text(reinterpret_cast<const char*>(file->data()), file->size());
+        for (auto slice : split_records(text, EXTRACT_SLICE_BYTES, next_game_offset)) {
+            slices.push_back(slice);
+        }
+        mapped.push_back(file);
+    }
+
+    TrainingSink sink;
+    if (!sink.open(output)) {
+        return Res::Err(fmt::interpolate("Failed to open {}", output.string()));
+    }
+
+    uint64_t threads = std::min<uint64_t>(worker_count(options.Threads),
+                                          std::max<size_t>(slices.size(), 1));
+    BuildStats stats;
+    std::vector<ExtractWorker> workers(threads);
+    for (auto& worker : workers) {
+        worker.Counters = stats.register_thread();
+        worker.Writer = CreateScope<TrainingChunkWriter>(sink);
+    }
+
+    {
+        ProgressReporter reporter(stats, options.ProgressSeconds);
+        parallel_for_each(std::span(slices), threads, [&](std::string_view slice, size_t index) {
+            auto& worker = workers[index];
+            MemoryBuf buffer(slice);
+            std::istream stream(&buffer);
+
+            TrainingVisitor visitor(options, worker);
+            pgn::StreamParser parser(stream);
+            auto error = parser.readGames(visitor);
+            if (error.hasError()) {
+                fmt::eprintln(error.message());
+            }
+            worker.Counters->BytesRead.add(slice.size());
+        });
+    }
+
+    ExtractStats result;
+    for (auto& worker : workers) {
+        worker.Writer->flush();
+        result.SkippedGames += worker.SkippedGames;
+    }
+
+    if (!sink.good()) {
+        return Res::Err(fmt::interpolate("Failed to write {}", output.string()));
+    }
+
+    auto snapshot = stats.snapshot();
+    result.Games = snapshot.Games;
+    result.Positions = snapshot.LegalMoves;
+    result.Written = snapshot.EntriesWritten;
+    result.Seconds = snapshot.Seconds;
+
+    if (!options.StatsFile.empty() && !stats.write_json(options.StatsFile)) {
+        return Res::Err(fmt::interpolate("Failed to write {}", options.StatsFile.string()));
+    }
+
+    return Res(result);
+}
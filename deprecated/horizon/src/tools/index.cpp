@@ -0,0 +1,785 @@
+#include <pch.hpp>
+
+#include "tools/index.hpp"
+
+#include "core/concurrent.hpp"
+#include "core/games.hpp"
+#include "core/split.hpp"
+
+constexpr size_t INDEX_SLICE_BYTES = 4 * 1024 * 1024;
+// Positions read from a run at once, and posting bytes buffered before they are written
+constexpr size_t INDEX_RUN_PAIRS = 1 << 16;
+constexpr size_t INDEX_WRITE_BYTES = 1 << 20;
+constexpr uint64_t INDEX_MAX_FILES = 1 << (64 - POSITION_INDEX_OFFSET_BITS);
+constexpr uint64_t INDEX_OFFSET_MASK = (1ULL << POSITION_INDEX_OFFSET_BITS) - 1;
+
+static inline void put_le32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+static inline void put_le64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<unsigned char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+static inline uint32_t get_le32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+static inline uint64_t get_le64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+/// A position reached by a game, ordered by key and then game so posting lists come out sorted
+struct KeyGame {
+    uint64_t Key;
+    uint64_t Game;
+
+    auto operator<=>(const KeyGame& other) const = default;
+};
+
+// ================ PARSING ================
+
+/// A slice of one file, holding what its games reach until the batch is spilled to a run
+struct IndexSlice {
+    uint64_t File;
+    // The offset of the slice in its file
+    uint64_t Base;
+    std::string_view Text;
+
+    // The file offset of every game, whose position in this list is its id within the slice
+    std::vector<uint64_t> Offsets;
+    std::vector<KeyGame> Pairs;
+};
+
+/// Records the key of every position a game reaches, up to the indexed depth
+class IndexVisitor : public pgn::Visitor {
+  private:
+    std::vector<KeyGame>& m_Pairs;
+    uint64_t m_MaxPlies;
+    uint64_t m_Game;
+    uint64_t m_Plies;
+
+    Board m_Board;
+    bool m_Valid;
+
+  public:
+    IndexVisitor(std::vector<KeyGame>& pairs, uint64_t max_plies)
+        : m_Pairs(pairs), m_MaxPlies(max_plies), m_Game(0), m_Plies(0), m_Valid(true) {}
+
+    void set_game(uint64_t game) { m_Game = game; }
+
+    void startPgn() override {
+        m_Board = start_board();
+        m_Plies = 0;
+        m_Valid = true;
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "FEN") {
+            m_Valid = m_Board.setFen(value);
+        }
+    }
+
+    void startMoves() override {
+        if (!m_Valid) {
+            skipPgn(true);
+            return;
+        }
+        m_Pairs.push_back({m_Board.hash(), m_Game});
+    }
+
+    void move(std::string_view move, std::string_view) override {
+        // Comments before the first move arrive without one
+        if (move.empty()) {
+            return;
+        }
+
+        Move parsed_move = uci::parseSan(m_Board, move);
+        if (parsed_move == Move::NO_MOVE) {
+            skipPgn(true);
+            return;
+        }
+
+        m_Board.makeMove(parsed_move);
+        m_Pairs.push_back({m_Board.hash(), m_Game});
+        if (m_MaxPlies > 0 && ++m_Plies >= m_MaxPlies) {
+            skipPgn(true);
+        }
+    }
+
+    void endPgn() override {}
+};
+
+static void index_slice(IndexSlice& slice, uint64_t max_plies) {
+    GameParser parser;
+    IndexVisitor visitor(slice.Pairs, max_plies);
+
+    // Each game is parsed on its own so every position it reaches is tied to its offset
+    auto starts = find_game_offsets(slice.Text, 0, slice.Text.size());
+    for (size_t i = 0; i < starts.size(); ++i) {
+        size_t end = i + 1 < starts.size() ? starts[i + 1] : slice.Text.size();
+        visitor.set_game(slice.Offsets.size());
+        slice.Offsets.push_back(slice.Base + starts[i]);
+
+        auto error = parser.parse(slice.Text.substr(starts[i], end - starts[i]), visitor);
+        if (error.hasError()) {
+            fmt::eprintln(error.message());
+        }
+    }
+
+    // Repetitions within a game only need to be listed once
+    std::sort(slice.Pairs.begin(), slice.Pairs.end());
+    slice.Pairs.erase(std::unique(slice.Pairs.begin(), slice.Pairs.end()), slice.Pairs.end());
+}
+
+// ================ RUNS ================
+
+/// Merges the sorted positions of a batch of slices into one run on disk, numbering their games
+/// from the first id of each slice on the way. The slices' positions are released afterwards.
+static bool write_run(std::span<IndexSlice> slices, const std::vector<uint64_t>& first_games,
+                      const std::filesystem::path& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    using Head = std::pair<KeyGame, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    std::vector<size_t> next(slices.size(), 0);
+    for (size_t i = 0; i < slices.size(); ++i) {
+        if (!slices[i].Pairs.empty()) {
+            auto pair = slices[i].Pairs[next[i]++];
+            heads.push({{pair.Key, pair.Game + first_games[i]}, i});
+        }
+    }
+
+    std::vector<KeyGame> buffer;
+    buffer.reserve(INDEX_RUN_PAIRS);
+    auto flush = [&]() {
+        file.write(reinterpret_cast<const char*>(buffer.data()),
+                   static_cast<std::streamsize>(buffer.size() * sizeof(KeyGame)));
+        buffer.clear();
+    };
+
+    while (!heads.empty()) {
+        auto [pair, i] = heads.top();
+        heads.pop();
+        buffer.push_back(pair);
+        if (buffer.size() == INDEX_RUN_PAIRS) {
+            flush();
+        }
+
+        if (next[i] < slices[i].Pairs.size()) {
+            auto following = slices[i].Pairs[next[i]++];
+            heads.push({{following.Key, following.Game + first_games[i]}, i});
+        }
+    }
+    flush();
+
+    for (auto& slice : slices) {
+        slice.Pairs = {};
+    }
+    return static_cast<bool>(file.flush());
+}
+
+/// A sorted stream of positions, read from a spilled run or an existing index
+class PairSource {
+  public:
+    virtual ~PairSource() = default;
+    virtual bool next(KeyGame& out) = 0;
+};
+
+class RunSource : public PairSource {
+  private:
+    std::ifstream m_File;
+    std::vector<KeyGame> m_Buffer;
+    size_t m_Next;
+
+  public:
+    explicit RunSource(const std::filesystem::path& path)
+        : m_File(path, std::ios::binary), m_Next(0) {}
+
+    bool good() const { return static_cast<bool>(m_File); }
+
+    bool next(KeyGame& out) override {
+        if (m_Next == m_Buffer.size()) {
+            m_Buffer.resize(INDEX_RUN_PAIRS);
+            m_File.read(reinterpret_cast<char*>(m_Buffer.data()),
+                        static_cast<std::streamsize>(m_Buffer.size() * sizeof(KeyGame)));
+            m_Buffer.resize(static_cast<size_t>(m_File.gcount()) / sizeof(KeyGame));
+            m_Next = 0;
+            if (m_Buffer.empty()) {
+                return false;
+            }
+        }
+        out = m_Buffer[m_Next++];
+        return true;
+    }
+};
+
+class IndexSource : public PairSource {
+  private:
+    const PositionIndex& m_Index;
+    uint64_t m_Slot;
+    uint64_t m_Key;
+    std::vector<uint64_t> m_Games;
+    size_t m_Next;
+
+  public:
+    explicit IndexSource(const PositionIndex& index)
+        : m_Index(index), m_Slot(0), m_Key(0), m_Next(0) {}
+
+    bool next(KeyGame& out) override {
+        while (m_Next == m_Games.size()) {
+            if (m_Slot == m_Index.key_count()) {
+                return false;
+            }
+            m_Key = m_Index.key_at(m_Slot);
+            m_Games = m_Index.games_at(m_Slot++);
+            m_Next = 0;
+        }
+        out = {m_Key, m_Games[m_Next++]};
+        return true;
+    }
+};
+
+// ================ OUTPUT ================
+
+/// Streams sorted positions into posting lists. Key table entries go to a side file until the
+/// lists end, then are copied in after them along with the game and file tables.
+class IndexWriter {
+  private:
+    std::ofstream m_File;
+    std::ofstream m_Keys;
+    std::filesystem::path m_KeysPath;
+
+    std::vector<unsigned char> m_Buffer;
+    uint64_t m_Offset;
+    uint64_t m_KeyCount;
+    uint64_t m_Key;
+    uint64_t m_LastGame;
+
+  private:
+    void put_varint(uint64_t value) {
+        while (value >= 0x80) {
+            m_Buffer.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        m_Buffer.push_back(static_cast<unsigned char>(value));
+    }
+
+    void flush() {
+        m_File.write(reinterpret_cast<const char*>(m_Buffer.data()),
+                     static_cast<std::streamsize>(m_Buffer.size()));
+        m_Offset += m_Buffer.size();
+        m_Buffer.clear();
+    }
+
+  public:
+    IndexWriter() : m_Offset(0), m_KeyCount(0), m_Key(0), m_LastGame(0) {}
+
+    bool open(const std::filesystem::path& path, const std::filesystem::path& keys_path) {
+        m_File.open(path, std::ios::binary);
+        m_Keys.open(keys_path, std::ios::binary);
+        m_KeysPath = keys_path;
+
+        // The header is filled in once the sections are known
+        m_Buffer.assign(POSITION_INDEX_HEADER_BYTES, 0);
+        flush();
+        m_Buffer.reserve(INDEX_WRITE_BYTES + 16);
+        return m_File && m_Keys;
+    }
+
+    uint64_t key_count() const { return m_KeyCount; }
+
+    void add(const KeyGame& pair) {
+        if (m_KeyCount == 0 || pair.Key != m_Key) {
+            unsigned char entry[POSITION_INDEX_KEY_BYTES];
+            put_le64(entry, pair.Key);
+            put_le64(entry + 8, m_Offset + m_Buffer.size());
+            m_Keys.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+            m_KeyCount++;
+
+            m_Key = pair.Key;
+            m_LastGame = 0;
+        } else if (pair.Game == m_LastGame) {
+            return;
+        }
+
+        put_varint(pair.Game - m_LastGame);
+        m_LastGame = pair.Game;
+        if (m_Buffer.size() >= INDEX_WRITE_BYTES) {
+            flush();
+        }
+    }
+
+    bool finish(uint32_t depth, const std::vector<uint64_t>& games,
+                const std::vector<std::filesystem::path>& paths,
+                const std::vector<uint64_t>& sizes) {
+        flush();
+        uint64_t keys_offset = m_Offset;
+        m_Keys.close();
+        {
+            std::ifstream keys(m_KeysPath, std::ios::binary);
+            if (m_KeyCount > 0) {
+                m_File << keys.rdbuf();
+            }
+        }
+        std::error_code ec;
+        std::filesystem::remove(m_KeysPath, ec);
+        m_Offset += m_KeyCount * POSITION_INDEX_KEY_BYTES;
+
+        uint64_t games_offset = m_Offset;
+        for (auto game : games) {
+            m_Buffer.resize(m_Buffer.size() + 8);
+            put_le64(m_Buffer.data() + m_Buffer.size() - 8, game);
+            if (m_Buffer.size() >= INDEX_WRITE_BYTES) {
+                flush();
+            }
+        }
+        flush();
+
+        uint64_t files_offset = m_Offset;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            auto path = paths[i].string();
+            m_Buffer.resize(16);
+            put_le64(m_Buffer.data(), sizes[i]);
+            put_le64(m_Buffer.data() + 8, path.size());
+            m_Buffer.insert(m_Buffer.end(), path.begin(), path.end());
+            flush();
+        }
+
+        unsigned char header[POSITION_INDEX_HEADER_BYTES];
+        std::memcpy(header, POSITION_INDEX_MAGIC.data(), POSITION_INDEX_MAGIC.size());
+        put_le32(header + 8, POSITION_INDEX_VERSION);
+        put_le32(header + 12, depth);
+        put_le64(header + 16, POSITION_INDEX_HEADER_BYTES);
+        put_le64(header + 24, keys_offset);
+        put_le64(header + 32, m_KeyCount);
+        put_le64(header + 40, games_offset);
+        put_le64(header + 48, games.size());
+        put_le64(header + 56, files_offset);
+        put_le64(header + 64, paths.size());
+        m_File.seekp(0);
+        m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+        return static_cast<bool>(m_File.flush());
+    }
+};
+
+// ================ BUILD ================
+
+Result<IndexBuildStats, std::string> build_position_index(
+    const std::vector<std::filesystem::path>& inputs, const std::filesystem::path& output,
+    const IndexOptions& options) {
+    PROFILE_FUNCTION();
+    using Res = Result<IndexBuildStats, std::string>;
+    auto started = std::chrono::steady_clock::now();
+
+    if (options.Depth > UINT32_MAX) {
+        return Res::Err(fmt::interpolate("A depth of {} full moves is too deep", options.Depth));
+    }
+
+    // Appending keeps every indexed game and only parses what the files gained since
+    Ref<PositionIndex> previous;
+    std::vector<std::filesystem::path> paths;
+    std::vector<uint64_t> sizes;
+    std::vector<uint64_t> games;
+    if (options.Append && std::filesystem::exists(output)) {
+        auto opened = PositionIndex::open(output);
+        if (opened.is_err()) {
+            return Res::Err(opened.unwrap_err());
+        }
+
+        previous = opened.unwrap();
+        if (previous->depth() != options.Depth) {
+            return Res::Err(fmt::interpolate("{} indexes {} full moves of every game, append to it "
+                                             "with the same depth",
+                                             output.string(), previous->depth()));
+        }
+        for (size_t file = 0; file < previous->file_count(); ++file) {
+            paths.push_back(previous->file_path(file));
+            sizes.push_back(previous->indexed_bytes(file));
+        }
+        games.reserve(previous->game_count());
+        for (uint64_t id = 0; id < previous->game_count(); ++id) {
+            games.push_back(previous->game_entry(id));
+        }
+    }
+
+    IndexBuildStats stats;
+    std::vector<Ref<MappedFile>> mapped;
+    std::vector<IndexSlice> slices;
+    for (const auto& input : inputs) {
+        auto path = std::filesystem::absolute(input).lexically_normal();
+        auto known = std::find(paths.begin(), paths.end(), path);
+        size_t file = known - paths.begin();
+        if (known == paths.end()) {
+            if (paths.size() == INDEX_MAX_FILES) {
+                return Res::Err(
+                    fmt::interpolate("An index holds at most {} files", INDEX_MAX_FILES));
+            }
+            paths.push_back(path);
+            sizes.push_back(0);
+        }
+
+        auto opened = MappedFile::open(path);
+        if (opened.is_err()) {
+            return Res::Err(opened.unwrap_err());
+        }
+
+        auto mapped_file = opened.unwrap();
+        uint64_t from = sizes[file];
+        if (mapped_file->size() < from) {
+            return Res::Err(fmt::interpolate("{} shrank since it was indexed, rebuild the index "
+                                             "without appending",
+                                             path.string()));
+        } else if (mapped_file->size() > INDEX_OFFSET_MASK) {
+            return Res::Err(fmt::interpolate("{} is too large to index", path.string()));
+        } else if (mapped_file->size() == from) {
+            continue;
+        }
+
+        mapped_file->advise_sequential();
+        std::string_view text(reinterpret_cast<const char*>(mapped_file->data()),
+                              mapped_file->size());
+        auto added = text.substr(from);
+        for (auto slice : split_records(added, INDEX_SLICE_BYTES, next_game_offset)) {
+            uint64_t base = from + static_cast<uint64_t>(slice.data() - added.data());
+            slices.push_back({file, base, slice, {}, {}});
+        }
+
+        stats.NewBytes += added.size();
+        sizes[file] = mapped_file->size();
+        mapped.push_back(mapped_file);
+    }
+
+    stats.Files = paths.size();
+    uint64_t previous_games = games.size();
+    if (previous && slices.empty()) {
+        stats.Games = games.size();
+        stats.Keys = previous->key_count();
+        stats.IndexBytes = std::filesystem::file_size(output);
+        return Res(stats);
+    }
+
+    // Batches are parsed in parallel and spilled as sorted runs, bounding memory by the batch size
+    std::vector<std::filesystem::path> runs;
+    auto remove_runs = [&]() {
+        std::error_code ec;
+        for (const auto& run : runs) {
+            std::filesystem::remove(run, ec);
+        }
+    };
+
+    uint64_t threads = worker_count(options.Threads);
+    uint64_t max_plies = options.Depth * 2;
+    for (size_t begin = 0; begin < slices.size();) {
+        size_t end = begin;
+        uint64_t bytes = 0;
+        while (end < slices.size() &&
+               (end == begin || bytes + slices[end].Text.size() <= options.BatchBytes)) {
+            bytes += slices[end++].Text.size();
+        }
+
+        auto batch = std::span(slices).subspan(begin, end - begin);
+        parallel_for_each(batch, threads,
+                          [&](IndexSlice& slice) { index_slice(slice, max_plies); });
+
+        std::vector<uint64_t> first_games;
+        for (auto& slice : batch) {
+            first_games.push_back(games.size());
+            for (auto offset : slice.Offsets) {
+                games.push_back(slice.File << POSITION_INDEX_OFFSET_BITS | offset);
+            }
+            slice.Offsets = {};
+        }
+
+        std::filesystem::path run = output;
+        run += fmt::interpolate(".run{}", runs.size());
+        runs.push_back(run);
+        if (!write_run(batch, first_games, run)) {
+            remove_runs();
+            return Res::Err(fmt::interpolate("Failed to write {}", run.string()));
+        }
+        begin = end;
+    }
+    mapped.clear();
+
+    std::vector<Scope<PairSource>> sources;
+    if (previous) {
+        sources.push_back(CreateScope<IndexSource>(*previous));
+    }
+    for (const auto& run : runs) {
+        auto source = CreateScope<RunSource>(run);
+        if (!source->good()) {
+            remove_runs();
+            return Res::Err(fmt::interpolate("Failed to read {}", run.string()));
+        }
+        sources.push_back(std::move(source));
+    }
+
+    std::filesystem::path temporary = output;
+    temporary += ".tmp";
+    std::filesystem::path keys = output;
+    keys += ".keys";
+
+    IndexWriter writer;
+    if (!writer.open(temporary, keys)) {
+        remove_runs();
+        return Res::Err(fmt::interpolate("Failed to open {}", temporary.string()));
+    }
+
+    using Head = std::pair<KeyGame, size_t>;
+    std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        KeyGame pair;
+        if (sources[i]->next(pair)) {
+            heads.push({pair, i});
+        }
+    }
+
+    while (!heads.empty()) {
+        auto [pair, i] = heads.top();
+        heads.pop();
+        writer.add(pair);
+
+        KeyGame following;
+        if (sources[i]->next(following)) {
+            heads.push({following, i});
+        }
+    }
+
+    bool written = writer.finish(static_cast<uint32_t>(options.Depth), games, paths, sizes);
+    sources.clear();
+    previous.reset();
+    remove_runs();
+    if (!written) {
+        return Res::Err(fmt::interpolate("Failed to write {}", temporary.string()));
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, output, ec);
+    if (ec) {
+        return Res::Err(
+            fmt::interpolate("Failed to replace {}: {}", output.string(), ec.message()));
+    }
+
+    stats.NewGames = games.size() - previous_games;
+    stats.Games = games.size();
+    stats.Keys = writer.key_count();
+    stats.IndexBytes = std::filesystem::file_size(output);
+    stats.Seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return Res(stats);
+}
+
+// ================ LOOKUP ================
+
+Result<Ref<PositionIndex>, std::string> PositionIndex::open(const std::filesystem::path& path) {
+    using Res = Result<Ref<PositionIndex>, std::string>;
+    auto opened = MappedFile::open(path);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+
+    auto file = opened.unwrap();
+    const unsigned char* data = file->data();
+    if (file->size() < POSITION_INDEX_HEADER_BYTES ||
+        std::memcmp(data, POSITION_INDEX_MAGIC.data(), POSITION_INDEX_MAGIC.size()) != 0) {
+        return Res::Err(fmt::interpolate("{} is not a position index", path.string()));
+    }
+
+    uint32_t version = get_le32(data + 8);
+    if (version != POSITION_INDEX_VERSION) {
+        return Res::Err(fmt::interpolate("{} has index version {}, expected {}", path.string(),
+                                         version, POSITION_INDEX_VERSION));
+    }
+
+    Ref<PositionIndex> index(new PositionIndex());
+    index->m_Depth = get_le32(data + 12);
+    index->m_PostingsOffset = get_le64(data + 16);
+    index->m_KeysOffset = get_le64(data + 24);
+    index->m_KeyCount = get_le64(data + 32);
+    index->m_GamesOffset = get_le64(data + 40);
+    index->m_GameCount = get_le64(data + 48);
+    uint64_t files_offset = get_le64(data + 56);
+    uint64_t file_count = get_le64(data + 64);
+
+    // Every section has to lie in order within the file before any of it is trusted
+    uint64_t size = file->size();
+    bool valid = index->m_PostingsOffset <= index->m_KeysOffset &&
+                 index->m_KeyCount <= (size - index->m_KeysOffset) / POSITION_INDEX_KEY_BYTES &&
+                 index->m_KeysOffset + index->m_KeyCount * POSITION_INDEX_KEY_BYTES <=
+                     index->m_GamesOffset &&
+                 index->m_GamesOffset <= size &&
+                 index->m_GameCount <= (size - index->m_GamesOffset) / 8 &&
+                 index->m_GamesOffset + index->m_GameCount * 8 <= files_offset &&
+                 files_offset <= size;
+
+    for (uint64_t i = 0, at = files_offset; valid && i < file_count; ++i) {
+        valid = size - at >= 16 && get_le64(data + at + 8) <= size - at - 16;
+        if (valid) {
+            uint64_t length = get_le64(data + at + 8);
+            index->m_IndexedBytes.push_back(get_le64(data + at));
+            index->m_Paths.emplace_back(
+                std::string(reinterpret_cast<const char*>(data + at + 16), length));
+            at += 16 + length;
+        }
+    }
+
+    if (!valid) {
+        return Res::Err(fmt::interpolate("{} is truncated or corrupt", path.string()));
+    }
+
+    index->m_File = file;
+    return Res(index);
+}
+
+uint64_t PositionIndex::key_at(uint64_t slot) const {
+    return get_le64(m_File->data() + m_KeysOffset + slot * POSITION_INDEX_KEY_BYTES);
+}
+
+std::vector<uint64_t> PositionIndex::games_at(uint64_t slot) const {
+    const unsigned char* data = m_File->data();
+    auto postings_at = [&](uint64_t at) {
+        return get_le64(data + m_KeysOffset + at * POSITION_INDEX_KEY_BYTES + 8);
+    };
+
+    uint64_t at = postings_at(slot);
+    uint64_t end = slot + 1 < m_KeyCount ? postings_at(slot + 1) : m_KeysOffset;
+
+    std::vector<uint64_t> games;
+    uint64_t game = 0;
+    while (at < end) {
+        uint64_t delta = 0;
+        for (int shift = 0; at < end && shift < 64; shift += 7) {
+            unsigned char byte = data[at++];
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        game += delta;
+        games.push_back(game);
+    }
+    return games;
+}
+
+std::vector<uint64_t> PositionIndex::games(uint64_t key) const {
+    uint64_t low = 0, high = m_KeyCount;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (key_at(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == m_KeyCount || key_at(low) != key) {
+        return {};
+    }
+    return games_at(low);
+}
+
+uint64_t PositionIndex::game_entry(uint64_t id) const {
+    return get_le64(m_File->data() + m_GamesOffset + id * 8);
+}
+
+IndexedGame PositionIndex::game(uint64_t id) const {
+    uint64_t entry = game_entry(id);
+    return {m_Paths[entry >> POSITION_INDEX_OFFSET_BITS], entry & INDEX_OFFSET_MASK};
+}
+
+int query_position_index(const QueryOptions& options) {
+    PROFILE_FUNCTION();
+    auto opened = PositionIndex::open(options.Index);
+    if (opened.is_err()) {
+        fmt::eprintln(opened.unwrap_err());
+        return 1;
+    }
+    auto index = opened.unwrap();
+
+    Board board;
+    if (!options.Fen.empty() && !board.setFen(options.Fen)) {
+        fmt::eprintln("Invalid fen: {}", options.Fen);
+        return 1;
+    }
+
+    uint64_t plies = 0;
+    std::istringstream moves(options.Moves);
+    for (std::string token; moves >> token;) {
+        if (token.find_first_not_of("0123456789.") == std::string::npos) {
+            continue;
+        }
+
+        Move move = uci::parseSan(board, token);
+        if (move == Move::NO_MOVE) {
+            fmt::eprintln("Illegal move {} in {}", token, board.getFen());
+            return 1;
+        }
+        board.makeMove(move);
+        plies++;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto games = index->games(board.hash());
+    double milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started)
+            .count();
+
+    fmt::println("{} of {} games reach {} ({} ms)", games.size(), index->game_count(),
+                 board.getFen(), milliseconds);
+    if (index->depth() > 0 && options.Fen.empty() && plies > index->depth() * 2ULL) {
+        fmt::println("The index only holds the first {} full moves of every game",
+                     index->depth());
+    }
+
+    size_t count = options.Limit > 0 ? std::min<size_t>(games.size(), options.Limit) : games.size();
+    std::unordered_map<std::string, Ref<MappedFile>> files;
+    for (size_t i = 0; i < count; ++i) {
+        auto game = index->game(games[i]);
+        if (!options.PrintGames) {
+            fmt::println("{}:{}", game.File.string(), game.Offset);
+            continue;
+        }
+
+        auto& file = files[game.File.string()];
+        if (!file) {
+            auto mapped = MappedFile::open(game.File);
+            if (mapped.is_err()) {
+                fmt::eprintln(mapped.unwrap_err());
+                return 1;
+            }
+            file = mapped.unwrap();
+        }
+
+        std::string_view text(reinterpret_cast<const char*>(file->data()), file->size());
+        if (game.Offset >= text.size()) {
+            fmt::eprintln("{} no longer holds game {}", game.File.string(), games[i]);
+            return 1;
+        }
+        auto body = game_text(text, game.Offset);
+        while (!body.empty() && std::isspace(static_cast<unsigned char>(body.back()))) {
+            body.remove_suffix(1);
+        }
+        fmt::println("{}\n", std::string(body));
+    }
+
+    if (count < games.size()) {
+        fmt::println("... {} more", games.size() - count);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <pch.hpp>
+
+#include "tools/merge.hpp"
+
+#include "core/bookio.hpp"
+#include "core/bulkio.hpp"
+
+struct MergeCursor {
+    Scope<PolyReader> Reader;
+    PolyEntry Head;
+    float WeightScale;
+    std::string Name;
+};
+
+struct MergedMove {
+    uint16_t Move;
+    double Weight;
+    // Summed as the signed net scores BookLearner keeps, so learned results survive a merge
+    int Learn;
+};
+
+static void accumulate(std::vector<MergedMove>& moves, const PolyEntry& entry, float scale) {
+    double weight = static_cast<double>(entry.weight) * scale;
+    int learn = static_cast<int16_t>(entry.learn);
+    for (auto& m : moves) {
+        if (m.Move == entry.move) {
+            m.Weight += weight;
+            m.Learn += learn;
+            return;
+        }
+    }
+    moves.push_back({entry.move, weight, learn});
+}
+
+/// Prunes, ranks and rescales the moves of one position into the pending entries, returning the
+/// number kept
+static uint64_t emit(std::vector<PolyEntry>& pending, uint64_t key, std::vector<MergedMove>& moves,
+                     const MergeOptions& options) {
+    for (auto& m : moves) {
+        m.Weight = std::round(m.Weight);
+    }
+
+    std::erase_if(moves, [&](const MergedMove& m) {
+        return m.Weight < static_cast<double>(std::max<uint64_t>(options.MinWeight, 1));
+    });
+    if (moves.empty()) {
+        return 0;
+    }
+
+    std::sort(moves.begin(), moves.end(), [](const MergedMove& a, const MergedMove& b) {
+        return a.Weight != b.Weight ? a.Weight > b.Weight : a.Move < b.Move;
+    });
+
+    if (options.TopK > 0 && moves.size() > options.TopK) {
+        moves.resize(options.TopK);
+    }
+
+    // Weights only have 16 bits, so keep the ratios of heavy positions instead of clamping them
+    double max_weight = moves.front().Weight;
+    for (const auto& m : moves) {
+        double weight = m.Weight;
+        if (max_weight > UINT16_MAX) {
+            weight = std::max(1.0, std::floor(weight * UINT16_MAX / max_weight));
+        }
+        auto learn = static_cast<int16_t>(std::clamp(m.Learn, -32768, 32767));
+        pending.push_back(
+            {key, m.Move, static_cast<uint16_t>(weight), static_cast<uint16_t>(learn)});
+    }
+
+    return moves.size();
+}
+
+int merge_books(const std::vector<MergeInput>& inputs, const MergeOptions& options,
+                const std::string& output_file) {
+    PROFILE_FUNCTION();
+    if (inputs.empty()) {
+        fmt::eprintln("No input books to merge");
+        return 1;
+    }
+
+    std::vector<MergeCursor> cursors;
+    cursors.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        if (std::filesystem::exists(output_file) &&
+            std::filesystem::equivalent(input.Path, output_file)) {
+            fmt::eprintln("Refusing to overwrite input {}", input.Path.string());
+            return 1;
+        }
+
+        auto reader = CreateScope<PolyReader>(input.Path);
+        if (!reader->is_open()) {
+            fmt::eprintln("Failed to open {}", input.Path.string());
+            return 1;
+        }
+        cursors.push_back({std::move(reader), {}, input.WeightScale, input.Path.string()});
+    }
+
+    auto opened = BulkBookWriter::open(output_file, {BULK_IO_BLOCK_BYTES, false});
+    if (opened.is_err()) {
+        fmt::eprintln("Failed to open output file {}", output_file);
+        return 1;
+    }
+    auto writer = opened.unwrap();
+
+    // Min-heap of (head key, cursor index), each input contributes at most one element
+    using HeapItem = std::pair<uint64_t, size_t>;
+    std::priority_queue<HeapItem, std::vector<HeapItem>, std::greater<HeapItem>> heap;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        if (cursors[i].Reader->next(cursors[i].Head)) {
+            heap.push({cursors[i].Head.key, i});
+        }
+    }
+
+    uint64_t entries_read = 0;
+    uint64_t positions = 0;
+    uint64_t pruned_positions = 0;
+    uint64_t entries_written = 0;
+    std::vector<MergedMove> moves;
+    // Positions are handed to the writer a block of entries at a time
+    std::vector<PolyEntry> pending;
+    pending.reserve(BOOK_IO_BLOCK_ENTRIES);
+
+    while (!heap.empty()) {
+        uint64_t key = heap.top().first;
+        moves.clear();
+
+        while (!heap.empty() && heap.top().first == key) {
+            size_t idx = heap.top().second;
+            auto& cursor = cursors[idx];
+            heap.pop();
+
+            bool live = true;
+            while (live && cursor.Head.key == key) {
+                accumulate(moves, cursor.Head, cursor.WeightScale);
+                entries_read += 1;
+
+                live = cursor.Reader->next(cursor.Head);
+                if (live && cursor.Head.key < key) {
+                    fmt::eprintln("{} is not sorted by key, aborting merge", cursor.Name);
+                    writer->discard();
+                    return 1;
+                }
+            }
+
+            if (live) {
+                heap.push({cursor.Head.key, idx});
+            }
+        }
+
+        if (emit(pending, key, moves, options) > 0) {
+            positions += 1;
+        } else {
+            pruned_positions += 1;
+        }
+
+        if (pending.size() >= BOOK_IO_BLOCK_ENTRIES || heap.empty()) {
+            writer->write(pending);
+            entries_written += pending.size();
+            pending.clear();
+        }
+    }
+
+    if (!writer->finish()) {
+        fmt::eprintln("Failed to write output file {}", output_file);
+        return 1;
+    }
+    fmt::println("Merged {} entries from {} books", entries_read, cursors.size());
+    fmt::println("\tKept {} positions", positions);
+    fmt::println("\tPruned {} positions", pruned_positions);
+    fmt::println("Compiled {} moves into {}", entries_written, output_file);
+
+    return 0;
+}
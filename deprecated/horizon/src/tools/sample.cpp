@@ -0,0 +1,140 @@
+#include <pch.hpp>
+
+#include "tools/sample.hpp"
+
+#include "core/games.hpp"
+#include "core/rng.hpp"
+
+/// Replays a game to check that every move is legal, without recording anything
+class LegalityVisitor : public pgn::Visitor {
+  private:
+    Board m_Board;
+    uint64_t m_Games;
+    bool m_Legal;
+
+  public:
+    LegalityVisitor() : m_Games(0), m_Legal(true) {}
+
+    void reset() {
+        m_Games = 0;
+        m_Legal = true;
+    }
+
+    /// Whether the parsed text held a game and all of it replayed
+    bool legal() const { return m_Games > 0 && m_Legal; }
+
+    void startPgn() override {
+        m_Board = start_board();
+        m_Games++;
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "FEN" && !m_Board.setFen(value)) {
+            m_Legal = false;
+        }
+    }
+
+    void startMoves() override {
+        if (!m_Legal) {
+            skipPgn(true);
+        }
+    }
+
+    void move(std::string_view move, std::string_view) override {
+        // Comments before the first move arrive without one
+        if (move.empty()) {
+            return;
+        }
+
+        Move parsed_move = uci::parseSan(m_Board, move);
+        if (parsed_move == Move::NO_MOVE) {
+            m_Legal = false;
+            skipPgn(true);
+            return;
+        }
+        m_Board.makeMove(parsed_move);
+    }
+
+    void endPgn() override {}
+};
+
+Result<SampleStats, std::string> sample_games(const std::filesystem::path& input,
+                                              const std::filesystem::path& output,
+                                              const SampleOptions& options) {
+    PROFILE_FUNCTION();
+    using Res = Result<SampleStats, std::string>;
+
+    auto opened = MappedFile::open(input);
+    if (opened.is_err()) {
+        return Res::Err(opened.unwrap_err());
+    }
+    auto file = opened.unwrap();
+    std::string_view text(reinterpret_cast<const char*>(file->data()), file->size());
+
+    SampleStats stats;
+    std::vector<GameEntry> games;
+    if (!options.Rescan) {
+        auto loaded = load_game_offsets(input, text);
+        stats.Scanned = loaded.is_err();
+        if (!stats.Scanned) {
+            games = loaded.unwrap();
+        }
+    }
+
+    if (options.Rescan || stats.Scanned) {
+        auto started = std::chrono::steady_clock::now();
+        file->advise_sequential();
+        games = scan_games(text, options.Threads);
+        stats.Scanned = true;
+        stats.ScanSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        if (!save_game_offsets(input, games)) {
+            fmt::eprintln("Failed to write {}, the next sample will scan again",
+                          game_offsets_path(input).string());
+        }
+    }
+    stats.Games = games.size();
+
+    // A lazy Fisher-Yates shuffle draws games without replacement, only parsing those it draws
+    SplitMixRng rng(options.Seed);
+    GameParser parser;
+    LegalityVisitor visitor;
+    std::vector<uint64_t> order(games.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<uint64_t> chosen;
+    for (size_t i = 0; i < order.size() && chosen.size() < options.Count; ++i) {
+        std::swap(order[i], order[i + rng.below(order.size() - i)]);
+        if (options.Legal) {
+            visitor.reset();
+            parser.parse(game_text(text, games[order[i]].Offset), visitor);
+            if (!visitor.legal()) {
+                stats.Rejected++;
+                continue;
+            }
+        }
+        chosen.push_back(order[i]);
+    }
+    std::sort(chosen.begin(), chosen.end());
+
+    std::ofstream out(output, std::ios::binary);
+    if (!out) {
+        return Res::Err(fmt::interpolate("Failed to open {}", output.string()));
+    }
+
+    for (auto id : chosen) {
+        auto game = game_text(text, games[id].Offset);
+        while (!game.empty() && std::isspace(static_cast<unsigned char>(game.back()))) {
+            game.remove_suffix(1);
+        }
+        out.write(game.data(), static_cast<std::streamsize>(game.size()));
+        out.write("\n\n", 2);
+    }
+
+    if (!out.flush()) {
+        return Res::Err(fmt::interpolate("Failed to write {}", output.string()));
+    }
+
+    stats.Sampled = chosen.size();
+    return Res(stats);
+}
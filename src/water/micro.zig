@@ -0,0 +1,413 @@
+const std = @import("std");
+const water = @import("water");
+
+const bench = @import("bench.zig");
+
+/// Timed passes over the whole corpus for the warm numbers.
+const warm_passes: usize = 20;
+
+/// Positions timed one by one after evicting the caches for the cold numbers.
+const cold_positions: usize = 64;
+
+/// Bytes streamed through to evict the caches, twice a large last level cache.
+const evict_bytes: usize = 64 * 1024 * 1024;
+
+const CorpusPosition = struct {
+    fen: []const u8,
+    frc: bool,
+};
+
+/// Everything a component needs prepared ahead of timing, so only the component itself is timed.
+const Prepared = struct {
+    fen: []const u8,
+    board: *water.Board,
+    /// Takes the fens `setFen` is timed with.
+    scratch: *water.Board,
+    moves: water.movegen.Movelist,
+    ucis: [][]const u8,
+};
+
+/// Runs once on a position, returning how many operations that took.
+///
+/// Results go into the sink so the compiler cannot drop the work.
+const Component = struct {
+    name: []const u8,
+    run: *const fn (p: *Prepared, sink: *u64) anyerror!usize,
+};
+
+// ================ COMPONENTS ================
+
+fn legalAll(p: *Prepared, sink: *u64) anyerror!usize {
+    var moves = water.movegen.Movelist{};
+    water.movegen.legalmoves(p.board, &moves, .{});
+    sink.* +%= moves.size;
+    return 1;
+}
+
+fn legalCaptures(p: *Prepared, sink: *u64) anyerror!usize {
+    var moves = water.movegen.Movelist{};
+    water.movegen.legalmoves(p.board, &moves, .{ .gen_type = .capture });
+    sink.* +%= moves.size;
+    return 1;
+}
+
+fn legalQuiets(p: *Prepared, sink: *u64) anyerror!usize {
+    var moves = water.movegen.Movelist{};
+    water.movegen.legalmoves(p.board, &moves, .{ .gen_type = .quiet });
+    sink.* +%= moves.size;
+    return 1;
+}
+
+fn makeUnmake(p: *Prepared, sink: *u64) anyerror!usize {
+    for (p.moves.items()) |move| {
+        p.board.makeMove(move, .{ .exact = true });
+        sink.* +%= p.board.key;
+        p.board.unmakeMove(move);
+    }
+    return p.moves.size;
+}
+
+fn isAttacked(p: *Prepared, sink: *u64) anyerror!usize {
+    for (0..64) |i| {
+        const square = water.Square.fromInt(usize, i);
+        sink.* +%= @intFromBool(water.attacks.isAttacked(p.board, .white, square));
+        sink.* +%= @intFromBool(water.attacks.isAttacked(p.board, .black, square));
+    }
+    return 128;
+}
+
+fn givesCheck(p: *Prepared, sink: *u64) anyerror!usize {
+    for (p.moves.items()) |move| {
+        sink.* +%= @intFromBool(p.board.givesCheck(move).check());
+    }
+    return p.moves.size;
+}
+
+fn incrementalKey(p: *Prepared, sink: *u64) anyerror!usize {
+    sink.* +%= p.board.key;
+    return 1;
+}
+
+fn recomputedKey(p: *Prepared, sink: *u64) anyerror!usize {
+    sink.* +%= water.Zobrist.fromBoard(p.board);
+    return 1;
+}
+
+fn getFen(p: *Prepared, sink: *u64) anyerror!usize {
+    const fen = try p.board.getFen(true);
+    defer p.board.allocator.free(fen);
+    sink.* +%= fen.len;
+    return 1;
+}
+
+fn setFen(p: *Prepared, sink: *u64) anyerror!usize {
+    sink.* +%= @intFromBool(try p.scratch.setFen(p.fen, false));
+    return 1;
+}
+
+fn uciToMove(p: *Prepared, sink: *u64) anyerror!usize {
+    for (p.ucis) |uci| {
+        sink.* +%= water.uci.uciToMove(p.board, uci).move;
+    }
+    return p.ucis.len;
+}
+
+fn printMoveUci(p: *Prepared, sink: *u64) anyerror!usize {
+    var buffer: [8]u8 = undefined;
+    for (p.moves.items()) |move| {
+        var writer = std.Io.Writer.fixed(&buffer);
+        try water.uci.printMoveUci(move, p.board.fischer_random, &writer);
+        sink.* +%= writer.buffered().len;
+    }
+    return p.moves.size;
+}
+
+/// The counterparts of the chess-library harness's `--micro` components.
+///
+/// Water has no SAN support, so its UCI conversions stand in for `parseSan` and `moveToSan`.
+const components: []const Component = &.{
+    .{ .name = "legalmoves(all)", .run = &legalAll },
+    .{ .name = "legalmoves(capture)", .run = &legalCaptures },
+    .{ .name = "legalmoves(quiet)", .run = &legalQuiets },
+    .{ .name = "makeMove/unmakeMove", .run = &makeUnmake },
+    .{ .name = "isAttacked", .run = &isAttacked },
+    .{ .name = "givesCheck", .run = &givesCheck },
+    .{ .name = "key", .run = &incrementalKey },
+    .{ .name = "Zobrist.fromBoard", .run = &recomputedKey },
+    .{ .name = "getFen", .run = &getFen },
+    .{ .name = "setFen", .run = &setFen },
+    .{ .name = "uciToMove", .run = &uciToMove },
+    .{ .name = "printMoveUci", .run = &printMoveUci },
+};
+
+// ================ CORPUS ================
+
+fn addPosition(
+    allocator: std.mem.Allocator,
+    board: *const water.Board,
+    corpus: *std.ArrayList(CorpusPosition),
+    seen: *std.StringHashMap(void),
+) !void {
+    const fen = try board.getFen(true);
+    const entry = try seen.getOrPut(fen);
+    if (entry.found_existing) {
+        board.allocator.free(fen);
+        return;
+    }
+    try corpus.append(allocator, .{ .fen = fen, .frc = board.fischer_random });
+}
+
+/// Collects positions from inside real trees: every position passed on a number of seeded random walks
+/// of up to `max_plies` moves from each of the bench positions, without duplicates.
+fn randomWalkCorpus(allocator: std.mem.Allocator, seed: u64, walks: usize, max_plies: usize) !std.ArrayList(CorpusPosition) {
+    var corpus: std.ArrayList(CorpusPosition) = .empty;
+    var seen = std.StringHashMap(void).init(allocator);
+    defer seen.deinit();
+
+    var prng = std.Random.DefaultPrng.init(seed);
+    const random = prng.random();
+
+    var roots: std.ArrayList(CorpusPosition) = .empty;
+    defer roots.deinit(allocator);
+    for (bench.classical_positions) |tc| try roots.append(allocator, .{ .fen = tc.fen, .frc = false });
+    for (bench.frc_positions) |tc| try roots.append(allocator, .{ .fen = tc.fen, .frc = true });
+
+    for (roots.items) |root| {
+        const board = try water.Board.init(allocator, .{ .fischer_random = root.frc });
+        defer board.deinit();
+
+        for (0..walks) |_| {
+            if (!try board.setFen(root.fen, false)) return error.InvalidFen;
+            try addPosition(allocator, board, &corpus, &seen);
+
+            for (0..max_plies) |_| {
+                var moves = water.movegen.Movelist{};
+                water.movegen.legalmoves(board, &moves, .{});
+                if (moves.empty()) break;
+
+                board.makeMove(moves.at(random.uintLessThan(usize, moves.size)), .{});
+                try addPosition(allocator, board, &corpus, &seen);
+            }
+        }
+    }
+
+    return corpus;
+}
+
+/// Reads one position per line of an epd file, such as one written by the chess-library harness with `--write-epd`.
+fn epdCorpus(allocator: std.mem.Allocator, path: []const u8, frc: bool) !std.ArrayList(CorpusPosition) {
+    var input_file = try std.fs.cwd().openFile(path, .{ .mode = .read_only });
+    defer input_file.close();
+
+    const file_contents = try input_file.readToEndAlloc(allocator, std.math.maxInt(usize));
+    defer allocator.free(file_contents);
+
+    var corpus: std.ArrayList(CorpusPosition) = .empty;
+    var lines = std.mem.tokenizeAny(u8, file_contents, "\n\r");
+    while (lines.next()) |line| {
+        var components_iter = std.mem.tokenizeScalar(u8, line, ';');
+        const fen = std.mem.trim(u8, components_iter.next() orelse continue, " ");
+        if (fen.len == 0) continue;
+
+        // Cases of one fen at several depths are one position here
+        const items = corpus.items;
+        if (items.len > 0 and std.mem.eql(u8, items[items.len - 1].fen, fen)) continue;
+
+        try corpus.append(allocator, .{ .fen = try allocator.dupe(u8, fen), .frc = frc });
+    }
+
+    return corpus;
+}
+
+// ================ TIMING ================
+
+const Summary = struct {
+    median: f64,
+    /// Half the 95% confidence interval of the mean, relative to the mean.
+    relative_ci: f64,
+};
+
+/// Summarizes the samples, sorting them in place.
+fn summarize(samples: []f64) Summary {
+    if (samples.len == 0) return .{ .median = 0, .relative_ci = 0 };
+
+    const n: f64 = @floatFromInt(samples.len);
+    var sum: f64 = 0;
+    for (samples) |sample| sum += sample;
+    const mean = sum / n;
+
+    var squares: f64 = 0;
+    for (samples) |sample| squares += (sample - mean) * (sample - mean);
+    const stddev: f64 = if (samples.len > 1) @sqrt(squares / (n - 1)) else 0;
+
+    std.mem.sort(f64, samples, {}, std.sort.asc(f64));
+    return .{
+        .median = samples[samples.len / 2],
+        .relative_ci = if (mean > 0) 1.96 * stddev / @sqrt(n) / mean else 0,
+    };
+}
+
+/// Writing a buffer larger than the caches pushes out the tables, boards and code of earlier work.
+fn evictCaches(buffer: []u64, sink: *u64) void {
+    var i: usize = 0;
+    while (i < buffer.len) : (i += 8) {
+        buffer[i] +%= sink.*;
+        sink.* ^= buffer[i];
+    }
+}
+
+/// What reading the clock twice costs, taken off every cold timing.
+fn clockOverheadNs() f64 {
+    var samples: [1001]f64 = undefined;
+    for (&samples) |*sample| {
+        const start = std.time.nanoTimestamp();
+        const end = std.time.nanoTimestamp();
+        sample.* = @floatFromInt(end - start);
+    }
+    return summarize(&samples).median;
+}
+
+/// Times the components of Water that perft and search lean on, one by one over a corpus of positions.
+///
+/// Usage: `zig build micro --release -- [--frc] [epd]`
+///
+/// Without an epd file, the corpus is random walks from the bench positions. Given the epd the chess-library
+/// harness writes for its own `--micro` run, both libraries are timed on the exact same positions.
+pub fn main() !void {
+    const allocator = std.heap.smp_allocator;
+
+    var stdout_buffer: [1024]u8 = undefined;
+    var stdout_writer = std.fs.File.stdout().writer(&stdout_buffer);
+    const stdout = &stdout_writer.interface;
+    errdefer stdout.flush() catch {};
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var frc = false;
+    var epd_path: ?[]const u8 = null;
+    for (args[1..]) |arg| {
+        if (std.mem.eql(u8, arg, "--frc")) {
+            frc = true;
+        } else if (epd_path == null) {
+            epd_path = arg;
+        } else return error.InvalidArguments;
+    }
+
+    var corpus = if (epd_path) |path|
+        try epdCorpus(allocator, path, frc)
+    else
+        try randomWalkCorpus(allocator, 1, 8, 12);
+    defer {
+        for (corpus.items) |position| allocator.free(position.fen);
+        corpus.deinit(allocator);
+    }
+
+    var prepared: std.ArrayList(Prepared) = .empty;
+    defer {
+        for (prepared.items) |p| {
+            for (p.ucis) |uci| allocator.free(uci);
+            allocator.free(p.ucis);
+            p.board.deinit();
+            p.scratch.deinit();
+        }
+        prepared.deinit(allocator);
+    }
+
+    var total_moves: usize = 0;
+    for (corpus.items) |position| {
+        const board = try water.Board.init(allocator, .{ .fischer_random = position.frc });
+        const scratch = try water.Board.init(allocator, .{ .fischer_random = position.frc });
+        if (!try board.setFen(position.fen, false)) {
+            board.deinit();
+            scratch.deinit();
+            continue;
+        }
+
+        var moves = water.movegen.Movelist{};
+        water.movegen.legalmoves(board, &moves, .{});
+        const ucis = try allocator.alloc([]const u8, moves.size);
+        for (moves.items(), ucis) |move, *uci| {
+            uci.* = try water.uci.moveToUci(allocator, move, position.frc);
+        }
+
+        total_moves += moves.size;
+        try prepared.append(allocator, .{
+            .fen = position.fen,
+            .board = board,
+            .scratch = scratch,
+            .moves = moves,
+            .ucis = ucis,
+        });
+    }
+
+    if (prepared.items.len == 0) {
+        std.log.err("The corpus holds no positions", .{});
+        return error.EmptyCorpus;
+    }
+
+    const evict_buffer = try allocator.alloc(u64, evict_bytes / @sizeOf(u64));
+    defer allocator.free(evict_buffer);
+    @memset(evict_buffer, 1);
+
+    const cold_count = @min(cold_positions, prepared.items.len);
+    const overhead_ns = clockOverheadNs();
+    var sink: u64 = 0;
+
+    try stdout.print("Microbenchmarks over {d} positions ({d} legal moves)\n", .{ prepared.items.len, total_moves });
+    try stdout.print("warm: median of {d} passes over every position, ci of the mean\n", .{warm_passes});
+    try stdout.print(
+        "cold: median over {d} positions, each after evicting {d} MB, less {d:.1}ns of clock overhead\n\n",
+        .{ cold_count, evict_bytes / (1024 * 1024), overhead_ns },
+    );
+    try stdout.print("{s:<22}{s:>10}{s:>14}{s:>8}{s:>14}{s:>10}\n", .{ "component", "ops/pass", "warm ns/op", "ci", "cold ns/op", "cold/warm" });
+
+    var warm: [warm_passes]f64 = undefined;
+    var cold: [cold_positions]f64 = undefined;
+    for (components) |component| {
+        // One untimed pass settles the caches and the branch predictors
+        var ops: usize = 0;
+        for (prepared.items) |*p| ops += try component.run(p, &sink);
+        const ops_float: f64 = @floatFromInt(@max(ops, 1));
+
+        for (&warm) |*sample| {
+            const start = std.time.nanoTimestamp();
+            for (prepared.items) |*p| _ = try component.run(p, &sink);
+            const end = std.time.nanoTimestamp();
+            sample.* = @as(f64, @floatFromInt(end - start)) / ops_float;
+        }
+
+        // Positions without moves do no work for some components and are left out of the cold run
+        var cold_timed: usize = 0;
+        for (prepared.items) |*p| {
+            if (cold_timed == cold_count) break;
+
+            evictCaches(evict_buffer, &sink);
+            const start = std.time.nanoTimestamp();
+            const position_ops = try component.run(p, &sink);
+            const end = std.time.nanoTimestamp();
+            if (position_ops == 0) continue;
+
+            const ns: f64 = @floatFromInt(end - start);
+            cold[cold_timed] = @max(0.0, ns - overhead_ns) / @as(f64, @floatFromInt(position_ops));
+            cold_timed += 1;
+        }
+
+        const warm_summary = summarize(&warm);
+        const cold_summary = summarize(cold[0..cold_timed]);
+        const ratio = if (warm_summary.median > 0) cold_summary.median / warm_summary.median else 0.0;
+        try stdout.print("{s:<22}{d:>10}{d:>14.2}{d:>7.1}%{d:>14.2}{d:>9.1}x\n", .{
+            component.name,
+            ops,
+            warm_summary.median,
+            warm_summary.relative_ci * 100.0,
+            cold_summary.median,
+            ratio,
+        });
+        try stdout.flush();
+    }
+
+    // Printed so the sink, and with it every result, counts as used
+    try stdout.print("\n(checksum {x})\n", .{sink});
+    try stdout.flush();
+}
@@ -1,14 +1,23 @@
 const std = @import("std");
 const water = @import("water");
 
-const fischer: []const u8 = "benchmarks/perft/epd/fischer.epd";
-const marcel: []const u8 = "benchmarks/perft/epd/marcel.epd";
-const medium: []const u8 = "benchmarks/perft/epd/medium.epd";
-const reduced: []const u8 = "benchmarks/perft/epd/reduced.epd";
-const standard: []const u8 = "benchmarks/perft/epd/standard.epd";
-const terje: []const u8 = "benchmarks/perft/epd/terje_frc.epd";
+const default_epd_dir: []const u8 = "benchmarks/perft/epd";
+const result_filename: []const u8 = "results.txt";
 
-const result_filename: []const u8 = "benchmarks/perft/epd/results.txt";
+const Suite = struct {
+    filename: []const u8,
+    frc: bool,
+};
+
+/// The suites run in order, each looked up by name in the epd directory.
+const suites: []const Suite = &.{
+    .{ .filename = "fischer.epd", .frc = true },
+    .{ .filename = "marcel.epd", .frc = false },
+    .{ .filename = "medium.epd", .frc = false },
+    .{ .filename = "reduced.epd", .frc = false },
+    .{ .filename = "standard.epd", .frc = false },
+    .{ .filename = "terje_frc.epd", .frc = true },
+};
 
 const TestCase = struct {
     fen: []const u8,
@@ -150,23 +159,64 @@ fn dispatch(allocator: std.mem.Allocator, case_filename: []const u8, frc: bool,
     try writer.flush();
 }
 
+/// Resolves the path of every suite to run, in the order of `suites`.
+///
+/// The default directory must hold every suite. A directory given on the command line, such as one
+/// written by the chess-library harness with `--write-epd`, only needs the suites it selected.
+fn collect(allocator: std.mem.Allocator, epd_dir: []const u8, required: bool) !std.ArrayList(Suite) {
+    var selected: std.ArrayList(Suite) = .empty;
+    errdefer {
+        for (selected.items) |suite| allocator.free(suite.filename);
+        selected.deinit(allocator);
+    }
+
+    for (suites) |suite| {
+        const path = try std.fs.path.join(allocator, &.{ epd_dir, suite.filename });
+        if (!required) {
+            std.fs.cwd().access(path, .{}) catch {
+                allocator.free(path);
+                continue;
+            };
+        }
+        try selected.append(allocator, .{ .filename = path, .frc = suite.frc });
+    }
+
+    return selected;
+}
+
 pub fn main() !void {
     const allocator = std.heap.page_allocator;
-    var output_file = try std.fs.cwd().createFile(result_filename, .{});
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    // Usage: perft [epd directory]
+    const epd_dir: []const u8 = if (args.len > 1) args[1] else default_epd_dir;
+    var selected = try collect(allocator, epd_dir, args.len <= 1);
+    defer {
+        for (selected.items) |suite| allocator.free(suite.filename);
+        selected.deinit(allocator);
+    }
+    if (selected.items.len == 0) {
+        std.log.err("No suites found in '{s}'", .{epd_dir});
+        return error.NoSuites;
+    }
+
+    var paths: std.ArrayList([]const u8) = .empty;
+    defer paths.deinit(allocator);
+    for (selected.items) |suite| try paths.append(allocator, suite.filename);
+
+    const result_path = try std.fs.path.join(allocator, &.{ epd_dir, result_filename });
+    defer allocator.free(result_path);
+
+    var output_file = try std.fs.cwd().createFile(result_path, .{});
     defer output_file.close();
 
     var buf: [0x2000]u8 = undefined;
     var file_writer = output_file.writer(&buf);
     const writer = &file_writer.interface;
 
-    const total_tests = try accumulate(allocator, &.{
-        fischer,
-        marcel,
-        medium,
-        reduced,
-        standard,
-        terje,
-    });
+    const total_tests = try accumulate(allocator, paths.items);
 
     var progress = std.Progress.start(.{
         .estimated_total_items = total_tests,
@@ -176,12 +226,9 @@ pub fn main() !void {
 
     // Dispatch the tests synchronously
     const start = std.time.nanoTimestamp();
-    try dispatch(allocator, fischer, true, writer, &progress);
-    try dispatch(allocator, marcel, false, writer, &progress);
-    try dispatch(allocator, medium, false, writer, &progress);
-    try dispatch(allocator, reduced, false, writer, &progress);
-    try dispatch(allocator, standard, false, writer, &progress);
-    try dispatch(allocator, terje, true, writer, &progress);
+    for (selected.items) |suite| {
+        try dispatch(allocator, suite.filename, suite.frc, writer, &progress);
+    }
     const end = std.time.nanoTimestamp();
 
     try writer.flush();